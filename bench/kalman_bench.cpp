@@ -0,0 +1,1221 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file kalman_bench.cpp
+ *  @brief Host benchmark of the Kalman filter's measurement update.
+ *
+ *  Compares three ways of applying a measurement to the covariance:
+ *
+ *  - inverse: invert H*P*H' + R, then P - K*H*P, then even out the
+ *    asymmetry. This is how the filter used to do it.
+ *  - joseph: invert as above, then (I-K*H)*P*(I-K*H)' + K*R*K'.
+ *  - sequential: one scalar at a time in Joseph form. This is
+ *    kalman_correct() from kalman.hpp, what src/kalman.cpp runs.
+ *
+ *  The prediction is always kalman_predict(). It counts the flops each one
+ *  takes, then runs a long synthetic run at the AHRS and DVL rates in float
+ *  and measures how far each drifts from the filter's own code in double,
+ *  and whether the covariance stays positive definite. The stiff run makes
+ *  the sensors far more precise than the model, which is where float
+ *  covariance updates break down. The real Kalman struct is run alongside
+ *  on the same measurements and steps, which it should match bit for bit.
+ *  Last, it cruises the real filter for hours across several wraps of
+ *  micros() to check the 64 bit timebase and how much position is lost to
+ *  float, with and without the whole meters kept apart, and exits nonzero
+ *  if the timebase or the split position fails. Then it runs the real
+ *  filter with and without the gain tables of STEADY_GAINS on the same
+ *  data, DVL outages and all, for how far each is from the truth and how
+ *  long each takes. Last, it times the prediction as the filter does
+ *  it, shearing the covariance kept as its upper triangle, against the
+ *  dense products of matrix.hpp and the raw array functions before them.
+ *  And it runs ldl() in float over a set of badly conditioned and broken
+ *  matrices, against Gauss-Jordan, and counts and times both. The filter
+ *  runs in the Q16.16 of fixed.hpp as well, against double, which shows why
+ *  it stays in float. Last, it runs the control tick of control.hpp in
+ *  double, float and Q16.16 for how far each strays from double, and counts
+ *  its operations for a rough idea of the cycles each takes on the AVR.
+ *  The link's console and binary modes are compared in link_bench.cpp.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <Arduino.h>
+#include "config.h"
+#include "ahrs/ahrs.h"
+#include "dvl/dvl.h"
+#include "kalman.hpp"
+#include "matrix.hpp"
+#include "control.hpp"
+#include "fixed.hpp"
+#include "util.hpp"
+#include "rotation.h"
+#include "sim.h"
+
+enum form { INVERSE, JOSEPH, SEQUENTIAL, NUM_FORMS };
+static const char *FORM_NAMES[NUM_FORMS] = { "inverse", "joseph", "sequential" };
+
+// What the real filter reads from the AHRS and DVL drivers.
+static float accel_g[NUM_ACCEL_AXES];
+static int32_t dvl_fwd, dvl_stb;
+
+float ahrs_accel(enum accel_axis dir)
+{
+	return accel_g[dir];
+}
+
+int32_t dvl_get_forward_vel()
+{
+	return dvl_fwd;
+}
+
+int32_t dvl_get_starboard_vel()
+{
+	return dvl_stb;
+}
+
+// A double that counts the arithmetic done with it. count takes in the
+// multiplies and divides too, but not the comparisons or trig.
+struct Flop
+{
+	double v;
+	static long count, multiplies, divides, compares, trig;
+	Flop() : v(0.) {}
+	Flop(double x) : v(x) {}
+	Flop operator+(Flop o) const { count++; return v + o.v; }
+	Flop operator-(Flop o) const { count++; return v - o.v; }
+	Flop operator*(Flop o) const { count++; multiplies++; return v * o.v; }
+	Flop operator/(Flop o) const { count++; divides++; return v / o.v; }
+	Flop operator-() const { return -v; }
+	Flop &operator+=(Flop o) { count++; v += o.v; return *this; }
+	Flop &operator-=(Flop o) { count++; v -= o.v; return *this; }
+	Flop &operator*=(Flop o) { count++; multiplies++; v *= o.v; return *this; }
+	bool operator==(Flop o) const { compares++; return v == o.v; }
+	bool operator>(Flop o) const { compares++; return v > o.v; }
+	bool operator<(Flop o) const { compares++; return v < o.v; }
+};
+long Flop::count = 0, Flop::multiplies = 0, Flop::divides = 0;
+long Flop::compares = 0, Flop::trig = 0;
+static bool isfinite(Flop x) { return isfinite(x.v); }
+static Flop sin_deg(Flop a) { Flop::trig++; return sin_deg(a.v); }
+static Flop cos_deg(Flop a) { Flop::trig++; return cos_deg(a.v); }
+
+static double value(double x) { return x; }
+static double value(Fixed x) { return (double)x; }
+
+// C = A*B skipping zeros in A, like the product in include/matrix.hpp and
+// multiply() in src/matrix.cpp before it.
+template <class T>
+static void mul(const T *A, const T *B, int m, int p, int n, T *C)
+{
+	for (int r = 0; r < m; r++)
+	{
+		for (int c = 0; c < n; c++)
+			C[n*r+c] = 0.;
+		for (int k = 0; k < p; k++)
+		{
+			if (A[p*r+k] == T(0.))
+				continue;
+			for (int c = 0; c < n; c++)
+				C[n*r+c] += A[p*r+k] * B[n*k+c];
+		}
+	}
+}
+
+// Gauss-Jordan like invert() in the old src/matrix.cpp.
+template <class T>
+static int inv(T *A, int n, T *B)
+{
+	for (int r = 0; r < n; r++)
+		for (int c = 0; c < n; c++)
+			B[r*n+c] = r == c ? 1. : 0.;
+	for (int i = 0; i < n; i++)
+	{
+		T k = A[i*n+i];
+		if (k == T(0.))
+			return -1;
+		for (int c = 0; c < n; c++)
+		{
+			A[i*n+c] = A[i*n+c] / k;
+			B[i*n+c] = B[i*n+c] / k;
+		}
+		for (int r = 0; r < n; r++)
+		{
+			if (r == i)
+				continue;
+			k = A[r*n+i];
+			for (int c = 0; c < n; c++)
+			{
+				A[r*n+c] -= k*A[i*n+c];
+				B[r*n+c] -= k*B[i*n+c];
+			}
+		}
+	}
+	return 0;
+}
+
+// A state and its covariance, kept as its upper triangle, in scalar T.
+template <class T>
+struct Estimate
+{
+	T x[N], P[N*(N+1)/2];
+
+	Estimate()
+	{
+		for (int i = 0; i < N; i++)
+			x[i] = 0.;
+		for (int i = 0, n = 0; i < N; i++)
+			for (int j = i; j < N; j++)
+				P[n++] = i == j ? 1. : 0.;
+	}
+};
+
+// The forms the filter used before the sequential one, on the covariance in
+// full.
+template <class T>
+static void dense(T *x, T *P, const T *H, const T *R, const T *z, bool joseph)
+{
+	T HP[M*N], PHt[N*M], S[M*M], Si[M*M], K[N*M], d1[M], d2[N];
+	mul(H, P, M, N, N, HP);
+	for (int r = 0; r < M; r++)
+		for (int c = 0; c < N; c++)
+			PHt[c*M+r] = HP[r*N+c];
+	mul(H, PHt, M, N, M, S);
+	for (int i = 0; i < M*M; i++)
+		S[i] += R[i];
+	if (inv(S, M, Si) != 0)
+		return;
+	mul(PHt, Si, N, M, M, K);
+
+	mul(H, x, M, N, 1, d1);
+	for (int i = 0; i < M; i++)
+		d1[i] = z[i] - d1[i];
+	mul(K, d1, N, M, 1, d2);
+	for (int i = 0; i < N; i++)
+		x[i] += d2[i];
+
+	if (!joseph)
+	{
+		T KHP[N*N];
+		mul(K, HP, N, M, N, KHP);
+		for (int i = 0; i < N*N; i++)
+			P[i] -= KHP[i];
+		for (int r = 0; r < N; r++)
+			for (int c = r+1; c < N; c++)
+				P[r*N+c] = P[c*N+r] = (P[r*N+c] + P[c*N+r])/T(2.);
+		return;
+	}
+
+	// (I-K*H)*P*(I-K*H)' + K*R*K'
+	T A[N*N], AP[N*N], At[N*N], KR[N*M], Kt[M*N], KRK[N*N];
+	mul(K, H, N, M, N, A);
+	for (int r = 0; r < N; r++)
+		for (int c = 0; c < N; c++)
+			A[r*N+c] = (r == c ? T(1.) : T(0.)) - A[r*N+c];
+	mul(A, P, N, N, N, AP);
+	for (int r = 0; r < N; r++)
+		for (int c = 0; c < N; c++)
+			At[c*N+r] = A[r*N+c];
+	mul(AP, At, N, N, N, P);
+	mul(K, R, N, M, M, KR);
+	for (int r = 0; r < N; r++)
+		for (int c = 0; c < M; c++)
+			Kt[c*N+r] = K[r*M+c];
+	mul(KR, Kt, N, M, N, KRK);
+	for (int i = 0; i < N*N; i++)
+		P[i] += KRK[i];
+}
+
+// Applies a measurement in float to e in form f, with R scaled by rscale.
+// The sequential form is kalman_correct() itself. The others work on the
+// covariance in full, and keep the upper triangle of what they get.
+template <class T>
+static void update(Estimate<T> &e, const float *Hf, const float *Rf,
+		const float *zf, form f, float rscale)
+{
+	T H[M*N], R[M*M], z[M], y[M], s[M];
+	for (int i = 0; i < M*N; i++)
+		H[i] = Hf[i];
+	for (int i = 0; i < M*M; i++)
+		R[i] = Rf[i]*rscale;
+	for (int i = 0; i < M; i++)
+		z[i] = zf[i];
+	if (f == SEQUENTIAL)
+	{
+		kalman_correct(e.x, e.P, H, R, z, y, s);
+		return;
+	}
+	T P[N*N];
+	for (int i = 0; i < N*N; i++)
+		P[i] = e.P[sym_index(i/N, i%N, N)];
+	dense(e.x, P, H, R, z, f == JOSEPH);
+	for (int i = 0, n = 0; i < N; i++)
+		for (int j = i; j < N; j++)
+			e.P[n++] = P[i*N+j];
+}
+
+template <class T>
+static void predict(Estimate<T> &e, float dt)
+{
+	kalman_predict(e.x, e.P, T(dt));
+}
+
+// Smallest pivot of a Cholesky factorization of P, kept as its upper
+// triangle, which is negative or NaN if P isn't positive definite.
+template <class T>
+static double min_pivot(const T *P)
+{
+	double L[N*N];
+	double worst = INFINITY;
+	memset(L, 0, sizeof(L));
+	for (int j = 0; j < N; j++)
+	{
+		double d = value(P[sym_index(j, j, N)]);
+		for (int k = 0; k < j; k++)
+			d -= L[j*N+k]*L[j*N+k];
+		if (!(d > 0.))
+			return d;
+		worst = fmin(worst, d);
+		L[j*N+j] = sqrt(d);
+		for (int i = j+1; i < N; i++)
+		{
+			double e = value(P[sym_index(i, j, N)]);
+			for (int k = 0; k < j; k++)
+				e -= L[i*N+k]*L[j*N+k];
+			L[i*N+j] = e/L[j*N+j];
+		}
+	}
+	return worst;
+}
+
+static double noise(double sd)
+{
+	// Box-Muller with the C library generator, so runs repeat.
+	double u1 = (rand() + 1.)/(RAND_MAX + 2.);
+	double u2 = (rand() + 1.)/(RAND_MAX + 2.);
+	return sd*sqrt(-2.*log(u1))*cos(2.*M_PI*u2);
+}
+
+// Sets a covariance kept as its upper triangle to the identity.
+static void identity(float *covar)
+{
+	for (int i = 0, n = 0; i < N; i++)
+		for (int j = i; j < N; j++)
+			covar[n++] = i == j ? 1. : 0.;
+}
+
+// Rows of Ha and Hk as the firmware uses them, with the DVL lag folded in.
+static void dvl_rows(float lag, float *H)
+{
+	memcpy(H, Hk, sizeof(float)*M*N);
+	H[2] = -lag;
+	H[N+5] = -lag;
+}
+
+static void count_flops()
+{
+	float Hv[M*N], Ht[M*N], z[M] = { 0.1, 0.2 };
+	dvl_rows(0.06, Hv);
+	memcpy(Ht, Ha, sizeof(Ht));
+	bias_rows(30., Ht);
+	printf("flops per update (one AHRS and one DVL correction):\n");
+	for (int f = 0; f < NUM_FORMS; f++)
+	{
+		Estimate<Flop> e;
+		predict(e, 0.03);
+		Flop::count = 0;
+		update(e, Ht, Ra, z, (form)f, 1.);
+		long a = Flop::count;
+		Flop::count = 0;
+		update(e, Hv, Rk, z, (form)f, 1.);
+		printf("  %-10s  ahrs %4ld  dvl %4ld\n", FORM_NAMES[f], a, Flop::count);
+	}
+	Estimate<Flop> e;
+	Flop::count = 0;
+	predict(e, 0.03);
+	printf("  predict     %4ld\n", Flop::count);
+}
+
+// Runs the filters over seconds of synthetic driving with sensors at their
+// real rates, and reports the float forms against double.
+static void drift(const char *name, float rscale, double seconds, bool real)
+{
+	const double AHRS_DT = 1./30., DVL_DT = 1./8.;
+	Estimate<double> ref;
+	Estimate<Fixed> fixed;
+	Estimate<float> f[NUM_FORMS];
+	Kalman kalman;
+	float state[N] = { 0. }, covar[N*(N+1)/2];
+	identity(covar);
+	kalman.restart(0);
+
+	double worst_x[NUM_FORMS] = { 0. }, worst_p[NUM_FORMS] = { 0. };
+	double pivot[NUM_FORMS], real_x = 0., real_p = 0.;
+	double fixed_x = 0., fixed_p = 0., fixed_pivot = INFINITY;
+	for (int i = 0; i < NUM_FORMS; i++)
+		pivot[i] = INFINITY;
+
+	srand(1);
+	double next_dvl = DVL_DT;
+	uint32_t last = 0;
+	for (double t = AHRS_DT; t < seconds; t += AHRS_DT)
+	{
+		// Swerving about while slowly turning.
+		double yaw = fmod(t*3., 360.);
+		double ax = 0.2*cos(t/3.), ay = 0.15*sin(t/4.);
+		double vx = 0.6*sin(t/3.), vy = -0.6*cos(t/4.);
+		float angles[3] = { (float)yaw, 0., 0. };
+		double c = cos(yaw*M_PI/180.), s = sin(yaw*M_PI/180.);
+
+		// AHRS sample, in g and in the body frame.
+		accel_g[SURGE] = (c*ax + s*ay)/GRAVITY + noise(0.01);
+		accel_g[SWAY] = (-s*ax + c*ay)/GRAVITY + noise(0.01);
+		accel_g[HEAVE] = -1. + noise(0.01);
+
+		// The measurement as Kalman::accel() forms it, level, so the filters
+		// here see the same numbers as the real one.
+		float body[3] = { (float)(accel_g[SURGE]*GRAVITY),
+				(float)(accel_g[SWAY]*GRAVITY), 0. }, za[3];
+		body_to_inertial(body, angles, za);
+		float Ht[M*N];
+		memcpy(Ht, Ha, sizeof(Ht));
+		bias_rows(angles[0], Ht);
+
+		// Steps from whole microseconds, as the filter gets them.
+		uint32_t us = (uint32_t)(t*1e6 + 0.5);
+		float dt = (us - last)/1000000.;
+		last = us;
+		for (int i = 0; i < NUM_FORMS; i++)
+		{
+			predict(f[i], dt);
+			update(f[i], Ht, Ra, za, (form)i, rscale);
+		}
+		predict(ref, dt);
+		update(ref, Ht, Ra, za, SEQUENTIAL, rscale);
+		predict(fixed, dt);
+		update(fixed, Ht, Ra, za, SEQUENTIAL, rscale);
+		if (real)
+		{
+			kalman.predict(state, covar, us);
+			kalman.accel(state, covar, angles);
+		}
+
+		// DVL ping, as the DVL reports it: um/s, turned 45 degrees.
+		if (t >= next_dvl)
+		{
+			next_dvl += DVL_DT;
+			double u = c*vx + s*vy + noise(0.005), v = -s*vx + c*vy + noise(0.005);
+			double k = cos(M_PI/4.);
+			dvl_fwd = (int32_t)((k*u + k*v)*100000.);
+			dvl_stb = (int32_t)((-k*u + k*v)*100000.);
+			// And read back as Kalman::velocity() does.
+			float t1 = dvl_fwd/100000., t2 = dvl_stb/100000.;
+			float uv[3] = { (float)(cos(45.*D2R)*t1 - sin(45.*D2R)*t2),
+					(float)(sin(45.*D2R)*t1 + cos(45.*D2R)*t2), 0. }, zv[3];
+			body_to_inertial(uv, angles, zv);
+			float Hv[M*N];
+			dvl_rows(0., Hv);
+			for (int i = 0; i < NUM_FORMS; i++)
+				update(f[i], Hv, Rk, zv, (form)i, rscale);
+			update(ref, Hv, Rk, zv, SEQUENTIAL, rscale);
+			update(fixed, Hv, Rk, zv, SEQUENTIAL, rscale);
+			if (real)
+				kalman.velocity(state, covar, angles, 0.);
+		}
+
+		// Covariance differences relative to the reference's sd products.
+		double scale[N*(N+1)/2];
+		for (int i = 0, n = 0; i < N; i++)
+			for (int j = i; j < N; j++)
+				scale[n++] = sqrt(fabs(ref.P[sym_index(i, i, N)]*
+						ref.P[sym_index(j, j, N)])) + 1e-12;
+		for (int i = 0; i < NUM_FORMS; i++)
+		{
+			for (int j = 0; j < N; j++)
+				worst_x[i] = fmax(worst_x[i], fabs(f[i].x[j] - ref.x[j]));
+			for (int j = 0; j < N*(N+1)/2; j++)
+				worst_p[i] = fmax(worst_p[i], fabs(f[i].P[j] - ref.P[j])/scale[j]);
+			pivot[i] = fmin(pivot[i], min_pivot(f[i].P));
+			if (isnan(f[i].P[0]))
+				pivot[i] = NAN;
+		}
+		for (int j = 0; j < N; j++)
+			fixed_x = fmax(fixed_x, fabs(value(fixed.x[j]) - ref.x[j]));
+		for (int j = 0; j < N*(N+1)/2; j++)
+			fixed_p = fmax(fixed_p, fabs(value(fixed.P[j]) - ref.P[j])/scale[j]);
+		fixed_pivot = fmin(fixed_pivot, min_pivot(fixed.P));
+		if (real)
+		{
+			for (int j = 0; j < N; j++)
+				real_x = fmax(real_x, fabs(state[j] - f[SEQUENTIAL].x[j]));
+			for (int j = 0; j < N*(N+1)/2; j++)
+				real_p = fmax(real_p, fabs(covar[j] - f[SEQUENTIAL].P[j]));
+		}
+	}
+
+	printf("%s run, %.0f s, float against double:\n", name, seconds);
+	for (int i = 0; i < NUM_FORMS; i++)
+		printf("  %-10s  state %.2e  covariance %.2e  smallest pivot %.2e%s\n",
+				FORM_NAMES[i], worst_x[i], worst_p[i], pivot[i],
+				pivot[i] > 0. ? "" : "  NOT POSITIVE DEFINITE");
+	printf("  Q16.16 sequential state %.2e  covariance %.2e  smallest pivot %.2e%s\n",
+			fixed_x, fixed_p, fixed_pivot,
+			fixed_pivot > 0. ? "" : "  NOT POSITIVE DEFINITE");
+	if (real)
+		printf("  src/kalman.cpp against sequential: state %.2e  covariance %.2e%s\n",
+				real_x, real_p, real_x || real_p ? "" : " (bit for bit)");
+}
+
+// Cruises the real filter straight north at a steady speed for hours, with
+// the clock starting just short of where micros() wraps and a DVL outage
+// longer than half the wrap. One copy keeps its whole meters apart as
+// Navigation does, the other keeps all of its position in the float state.
+// Fails unless the first stays within MAX_ERROR of the truth, and every
+// stamp is widened right and the whole outage is taken as a dropout.
+static bool cruise(double hours)
+{
+	const uint32_t AHRS_US = 33333, DVL_US = 125000, LATENCY = 5000;
+	const double SPEED = 0.5, OUT_FROM = 3600.*3., OUT_TO = 3600.*3.75;
+	const double MAX_ERROR = 0.1;
+	Kalman kalman[2];
+	float state[2][N] = { { 0. } }, covar[2][N*(N+1)/2];
+	int32_t origin[2] = { 0, 0 };
+	sim_clock_set((1ULL << 32) - 60000000ULL);
+	uint64_t start = micros64(), next_dvl = start + DVL_US;
+	for (int f = 0; f < 2; f++)
+	{
+		identity(covar[f]);
+		kalman[f].restart(start);
+	}
+
+	long stamps = 0, bad_stamps = 0, outage = 0, bad_outage = 0;
+	double worst[2] = { 0., 0. }, last[2] = { 0., 0. };
+	for (;;)
+	{
+		delayMicroseconds(AHRS_US);
+		uint64_t now = micros64();
+		double t = (now - start)/1e6;
+		if (t > hours*3600.)
+			break;
+
+		// The stamp an interrupt took a little earlier, widened as the
+		// firmware does.
+		uint32_t stamp = micros() - LATENCY;
+		stamps++;
+		if (widen(stamp, now) != now - LATENCY)
+			bad_stamps++;
+
+		float angles[3] = { 0., 0., 0. };
+		accel_g[SURGE] = 0.;
+		accel_g[SWAY] = 0.;
+		accel_g[HEAVE] = -1.;
+		bool ping = now >= next_dvl;
+		if (ping)
+		{
+			next_dvl += DVL_US;
+			double k = cos(M_PI/4.);
+			dvl_fwd = (int32_t)(k*SPEED*100000.);
+			dvl_stb = (int32_t)(-k*SPEED*100000.);
+		}
+		bool out = t >= OUT_FROM && t < OUT_TO;
+		for (int f = 0; f < 2; f++)
+		{
+			kalman[f].predict(state[f], covar[f], now - LATENCY);
+			kalman[f].accel(state[f], covar[f], angles);
+			if (ping && !out)
+				kalman[f].velocity(state[f], covar[f], angles, 0.);
+			if (f == 1)
+			{
+				for (int k = 0; k < 2; k++)
+				{
+					float whole = floor(state[f][3*k] + 0.5);
+					origin[k] += (int32_t)whole;
+					state[f][3*k] -= whole;
+				}
+			}
+		}
+		if (out && t > OUT_FROM + DROPOUT_TIME/1e6 + 1.)
+		{
+			outage++;
+			if (!kalman[1].dropout())
+				bad_outage++;
+		}
+
+		// The sensors have no noise, so until the outage the error is the
+		// float's, less 0.05 m from the DVL rounding to 10 um/s.
+		if (t < OUT_FROM)
+		{
+			double north = SPEED*t;
+			last[0] = fabs(state[0][0] - north);
+			last[1] = fabs(origin[0] + (double)state[1][0] - north);
+			for (int f = 0; f < 2; f++)
+				worst[f] = fmax(worst[f], last[f]);
+		}
+	}
+
+	printf("cruise, %.0f h at %.1f m/s from %.0f s before micros() wraps:\n",
+			hours, SPEED, 60.);
+	printf("  position error at %.1f km  float %.3f m (worst %.3f)  "
+			"with origin %.3f m (worst %.3f)\n",
+			SPEED*OUT_FROM/1000., last[0], worst[0], last[1], worst[1]);
+	printf("  stamps widened wrong %ld of %ld, dropout missed %ld of %ld ticks "
+			"of a %.0f min outage\n", bad_stamps, stamps, bad_outage, outage,
+			(OUT_TO - OUT_FROM)/60.);
+	bool ok = worst[1] <= MAX_ERROR && bad_stamps == 0 && outage > 0 &&
+		bad_outage == 0;
+	if (!ok)
+		printf("  FAILED: with origin must stay within %.2f m, and no stamp or "
+				"dropout be missed\n", MAX_ERROR);
+	return ok;
+}
+
+// Runs the real filter over seconds of the swerving from drift(), with the DVL
+// out for a few seconds every minute, once working out the covariance every
+// sample and once on the gain tables. Reports each against the truth, and how
+// much host time a second of data takes.
+static void steady(double seconds)
+{
+	const double AHRS_DT = 1./30., DVL_DT = 1./8., SKIP = 10.;
+	const int STEPS = (int)(seconds/AHRS_DT);
+	struct sample { float accel[3], yaw; int32_t fwd, stb; bool ping; double x[4]; };
+	sample *run = new sample[STEPS];
+
+	srand(2);
+	double next_dvl = DVL_DT;
+	for (int i = 0; i < STEPS; i++)
+	{
+		double t = (i + 1)*AHRS_DT;
+		double yaw = fmod(t*3., 360.);
+		double ax = 0.2*cos(t/3.), ay = 0.15*sin(t/4.);
+		double vx = 0.6*sin(t/3.), vy = -0.6*cos(t/4.);
+		double c = cos(yaw*M_PI/180.), s = sin(yaw*M_PI/180.);
+		sample &r = run[i];
+		r.yaw = yaw;
+		r.accel[SURGE] = (c*ax + s*ay)/GRAVITY + noise(0.01);
+		r.accel[SWAY] = (-s*ax + c*ay)/GRAVITY + noise(0.01);
+		r.accel[HEAVE] = -1. + noise(0.01);
+		r.x[0] = 1.8*(1. - cos(t/3.));
+		r.x[1] = vx;
+		r.x[2] = -2.4*sin(t/4.);
+		r.x[3] = vy;
+		r.ping = t >= next_dvl;
+		if (r.ping)
+		{
+			next_dvl += DVL_DT;
+			double u = c*vx + s*vy + noise(0.005), v = -s*vx + c*vy + noise(0.005);
+			double k = cos(M_PI/4.);
+			r.fwd = (int32_t)((k*u + k*v)*100000.);
+			r.stb = (int32_t)((-k*u + k*v)*100000.);
+			if (fmod(t, 60.) > 55.)
+				r.ping = false;
+		}
+	}
+
+	// Position and velocity along X and Y from each, every sample.
+	float *est = new float[2*STEPS*4];
+	double took[2];
+	long fast = 0, count = 0;
+	for (int f = 0; f < 2; f++)
+	{
+		Kalman kalman;
+		kalman.steady = f == 1;
+		float state[N] = { 0. }, covar[N*(N+1)/2];
+		identity(covar);
+		kalman.restart(0);
+		clock_t began = clock();
+		for (int i = 0; i < STEPS; i++)
+		{
+			const sample &r = run[i];
+			float angles[3] = { r.yaw, 0., 0. };
+			memcpy(accel_g, r.accel, sizeof(accel_g));
+			kalman.predict(state, covar, (uint32_t)((i + 1)*AHRS_DT*1e6 + 0.5));
+			kalman.accel(state, covar, angles);
+			if (r.ping)
+			{
+				dvl_fwd = r.fwd;
+				dvl_stb = r.stb;
+				kalman.velocity(state, covar, angles, 0.);
+			}
+			float *x = est + (f*STEPS + i)*4;
+			x[0] = state[0];
+			x[1] = state[1];
+			x[2] = state[3];
+			x[3] = state[4];
+			if (f == 1)
+			{
+				count++;
+				fast += kalman.fast();
+			}
+		}
+		took[f] = (double)(clock() - began)/CLOCKS_PER_SEC;
+	}
+
+	double sum_x[2] = { 0., 0. }, sum_v[2] = { 0., 0. }, apart = 0.;
+	long used = 0;
+	for (int i = (int)(SKIP/AHRS_DT); i < STEPS; i++, used++)
+	{
+		for (int f = 0; f < 2; f++)
+		{
+			const float *x = est + (f*STEPS + i)*4;
+			sum_x[f] += pow(x[0] - run[i].x[0], 2) + pow(x[2] - run[i].x[2], 2);
+			sum_v[f] += pow(x[1] - run[i].x[1], 2) + pow(x[3] - run[i].x[3], 2);
+		}
+		const float *a = est + i*4, *b = est + (STEPS + i)*4;
+		apart = fmax(apart, fmax(fabs(a[1] - b[1]), fabs(a[3] - b[3])));
+	}
+
+	printf("steady gains, %.0f s with the DVL out 5 s a minute:\n", seconds);
+	for (int f = 0; f < 2; f++)
+		printf("  %-10s  velocity rms %.4f m/s  position rms %.3f m  "
+				"%.1f us per second of data\n", f ? "tables" : "full",
+				sqrt(sum_v[f]/used), sqrt(sum_x[f]/used), took[f]/seconds*1e6);
+	printf("  on the tables %.0f%% of samples, velocity at most %.4f m/s from "
+			"the full filter\n", 100.*fast/count, apart);
+	delete[] run;
+	delete[] est;
+}
+
+// The prediction as src/kalman.cpp did it with multiply() and transpose() on
+// raw arrays, and with the products of matrix.hpp.
+static void predict_arrays(float *x, float *P, float dt)
+{
+	float a1[N*N], a2[N*N], d1[N];
+	float F[N*N] = {
+		1, dt, dt*dt/2, 0, 0, 0, 0, 0,
+		0, 1, dt, 0, 0, 0, 0, 0,
+		0, 0, 1, 0, 0, 0, 0, 0,
+		0, 0, 0, 1, dt, dt*dt/2, 0, 0,
+		0, 0, 0, 0, 1, dt, 0, 0,
+		0, 0, 0, 0, 0, 1, 0, 0,
+		0, 0, 0, 0, 0, 0, 1, 0,
+		0, 0, 0, 0, 0, 0, 0, 1
+	};
+	mul(F, x, N, N, 1, d1);
+	memcpy(x, d1, sizeof(float)*N);
+	mul(F, P, N, N, N, a1);
+	for (int r = 0; r < N; r++)
+		for (int c = 0; c < N; c++)
+			a2[c*N+r] = a1[r*N+c];
+	mul(F, a2, N, N, N, P);
+	for (int i = 0; i < N*N; i++)
+		P[i] += Qk[i]*dt;
+}
+
+static void predict_matrix(float *x, float *P, float dt, bool direct)
+{
+	Matrix<N, N> F = Matrix<N, N>::identity();
+	for (int k = 0; k < 6; k += 3)
+	{
+		F(k, k+1) = F(k+1, k+2) = dt;
+		F(k, k+2) = dt*dt/2;
+	}
+	Ref<N, N> Pr(P), Q(Qk);
+	Ref<N, 1> X(x);
+	X = F*X;
+	if (direct)
+		Pr = F*Pr*transpose(F) + Q*dt;
+	else
+		Pr = F*transpose(F*Pr) + Q*dt;
+}
+
+// Times each form of the prediction over many steps from the same start,
+// and checks how far they end up from the raw array one. The last is
+// Kalman::predict itself, on the covariance kept as its upper triangle.
+static void matrices(long steps)
+{
+	const uint32_t DT_US = 33333;
+	const float DT = DT_US/1000000.;
+	const char *names[4] = { "arrays", "matrix.hpp", "F*P*F'", "packed" };
+	float x[4][N], P[4][N*N];
+	double took[4];
+	for (int f = 0; f < 4; f++)
+	{
+		for (int i = 0; i < N; i++)
+			x[f][i] = 0.1*i;
+		for (int i = 0; i < N*N; i++)
+			P[f][i] = i % (N+1) == 0 ? 1. : 0.;
+		Kalman kalman;
+		kalman.restart(0);
+		float covar[N*(N+1)/2];
+		identity(covar);
+		clock_t began = clock();
+		for (long i = 0; i < steps; i++)
+		{
+			if (f == 0)
+				predict_arrays(x[f], P[f], DT);
+			else if (f < 3)
+				predict_matrix(x[f], P[f], DT, f == 2);
+			else
+				kalman.predict(x[f], covar, (i + 1)*DT_US);
+		}
+		took[f] = (double)(clock() - began)/CLOCKS_PER_SEC;
+		if (f == 3)
+			for (int j = 0; j < N*N; j++)
+				P[f][j] = covar[sym_index(j/N, j%N, N)];
+	}
+
+	printf("prediction, %ld steps:\n", steps);
+	for (int f = 0; f < 4; f++)
+	{
+		double worst = 0.;
+		for (int i = 0; i < N*N; i++)
+			worst = fmax(worst, fabs(P[f][i] - P[0][i])/fabs(P[0][i] + 1e-30));
+		for (int i = 0; i < N; i++)
+			worst = fmax(worst, fabs(x[f][i] - x[0][i])/fabs(x[0][i] + 1e-30));
+		printf("  %-10s  %.3f us each  largest relative difference %.1e%s\n",
+				names[f], took[f]/steps*1e6, worst,
+				memcmp(P[f], P[0], sizeof(P[0])) || memcmp(x[f], x[0], sizeof(x[0])) ?
+				"" : " (bit for bit)");
+	}
+	printf("  covariance kept in %d bytes, against %d in full\n",
+			(int)sizeof(float)*N*(N+1)/2, (int)sizeof(float)*N*N);
+}
+
+// A case for the solvers: an n by n matrix in double, made by fill().
+struct SolveCase
+{
+	const char *name;
+	void (*fill)(int n, double *A);
+};
+
+static void spd(int n, double *A)
+{
+	// B*B' + I, with B from a fixed seed.
+	double B[N*N];
+	srand(5);
+	for (int i = 0; i < n*n; i++)
+		B[i] = rand()/(double)RAND_MAX - 0.5;
+	for (int i = 0; i < n; i++)
+		for (int j = 0; j < n; j++)
+		{
+			A[i*n+j] = i == j ? 1. : 0.;
+			for (int k = 0; k < n; k++)
+				A[i*n+j] += B[i*n+k]*B[j*n+k];
+		}
+}
+
+static void hilbert(int n, double *A)
+{
+	for (int i = 0; i < n; i++)
+		for (int j = 0; j < n; j++)
+			A[i*n+j] = 1./(i + j + 1);
+}
+
+static void scaled(int n, double *A)
+{
+	// Well conditioned but for variances from 1e-6 to 1e6, like metres
+	// against a bias.
+	spd(n, A);
+	for (int i = 0; i < n; i++)
+		for (int j = 0; j < n; j++)
+			A[i*n+j] *= pow(10., 12.*i/(n - 1) - 6.)*pow(10., 12.*j/(n - 1) - 6.);
+}
+
+static void near_singular(int n, double *A)
+{
+	// The last row is the sum of the others, plus a little.
+	spd(n, A);
+	for (int j = 0; j < n; j++)
+	{
+		A[(n-1)*n+j] = 0.;
+		for (int i = 0; i < n-1; i++)
+			A[(n-1)*n+j] += A[i*n+j];
+		A[j*n+n-1] = A[(n-1)*n+j];
+	}
+	A[(n-1)*n+n-1] = 0.;
+	for (int i = 0; i < n-1; i++)
+		A[(n-1)*n+n-1] += A[(n-1)*n+i];
+	A[(n-1)*n+n-1] *= 1. + 1e-7;
+}
+
+static void singular(int n, double *A)
+{
+	// The first two rows and columns the same.
+	spd(n, A);
+	for (int j = 0; j < n; j++)
+		A[n+j] = A[j*n+1] = A[j];
+	A[n+1] = A[0];
+}
+
+static void indefinite(int n, double *A)
+{
+	spd(n, A);
+	A[(n/2)*n+n/2] = -A[(n/2)*n+n/2];
+}
+
+static void zero_pivot(int n, double *A)
+{
+	// A zero variance, which Gauss-Jordan can't pivot on either.
+	spd(n, A);
+	A[0] = 0.;
+}
+
+static void not_finite(int n, double *A)
+{
+	spd(n, A);
+	A[1] = A[n] = NAN;
+}
+
+static void stiff(int n, double *A)
+{
+	// An innovation covariance H*P*H' + R from the stiff run, where the
+	// sensors are far more precise than the state: the state's part is all
+	// but singular and R is what keeps it positive definite.
+	for (int i = 0; i < n; i++)
+		for (int j = 0; j < n; j++)
+			A[i*n+j] = 1. + (i == j ? 1e-6 : 0.);
+}
+
+static const SolveCase SOLVE_CASES[] = {
+	{ "spd", spd },
+	{ "scaled", scaled },
+	{ "stiff", stiff },
+	{ "hilbert", hilbert },
+	{ "near singular", near_singular },
+	{ "singular", singular },
+	{ "indefinite", indefinite },
+	{ "zero diagonal", zero_pivot },
+	{ "NaN", not_finite },
+};
+
+static const char *LDL_NAMES[] = { "ok", "deficient", "not finite" };
+
+// Relative residual |A*x - b|/|b| in double.
+static double residual(int n, const double *A, const float *x, const double *b)
+{
+	double r = 0., bb = 0.;
+	for (int i = 0; i < n; i++)
+	{
+		double e = -b[i];
+		for (int j = 0; j < n; j++)
+			e += A[i*n+j]*x[j];
+		r += e*e;
+		bb += b[i]*b[i];
+	}
+	return isnan(r) ? NAN : sqrt(r/bb);
+}
+
+// Solves one case in float with ldl() and with Gauss-Jordan.
+template <int n>
+static void solve_case(const SolveCase &c)
+{
+	double A[n*n], b[n];
+	c.fill(n, A);
+	for (int i = 0; i < n; i++)
+	{
+		b[i] = 0.;
+		for (int j = 0; j < n; j++)
+			b[i] += A[i*n+j]*(j + 1.);
+	}
+
+	float L[n*(n+1)/2], x[n];
+	for (int i = 0, k = 0; i < n; i++)
+		for (int j = i; j < n; j++)
+			L[k++] = A[i*n+j];
+	for (int i = 0; i < n; i++)
+		x[i] = b[i];
+	SymRef<n> LD(L);
+	int code = ldl(LD, (float)SOLVE_TOL);
+	if (code != LDL_NOT_FINITE)
+		ldl_solve(LD, Ref<n, 1>(x));
+	double rl = code == LDL_NOT_FINITE ? NAN : residual(n, A, x, b);
+
+	float G[n*n], Gi[n*n], y[n];
+	for (int i = 0; i < n*n; i++)
+		G[i] = A[i];
+	int gj = inv(G, n, Gi);
+	for (int i = 0; i < n; i++)
+	{
+		y[i] = 0.;
+		for (int j = 0; j < n; j++)
+			y[i] += Gi[i*n+j]*b[j];
+	}
+	double rg = residual(n, A, y, b);
+	printf("  %d  %-14s ldl %-10s residual %8.1e   gauss-jordan %-8s residual %8.1e\n",
+			n, c.name, LDL_NAMES[code], rl, gj ? "singular" : "ok", rg);
+}
+
+// Flops and divides of factoring and solving for one right hand side, and
+// of inverting by Gauss-Jordan and multiplying.
+template <int n>
+static void solve_cost(long reps)
+{
+	double A[n*n];
+	spd(n, A);
+	Flop Lf[n*(n+1)/2], xf[n], Gf[n*n], Gi[n*n];
+	for (int i = 0, k = 0; i < n; i++)
+		for (int j = i; j < n; j++)
+			Lf[k++] = A[i*n+j];
+	Flop::count = Flop::divides = 0;
+	ldl(SymRef<n, Flop>(Lf), Flop(SOLVE_TOL));
+	ldl_solve(SymRef<n, Flop>(Lf), Ref<n, 1, Flop>(xf));
+	long lc = Flop::count, ld = Flop::divides;
+	for (int i = 0; i < n*n; i++)
+		Gf[i] = A[i];
+	Flop::count = Flop::divides = 0;
+	inv(Gf, n, Gi);
+	mul(Gi, xf, n, n, 1, Lf);
+	long gc = Flop::count, gd = Flop::divides;
+
+	float L[n*(n+1)/2], x[n], G[n*n], Gv[n*n], y[n];
+	clock_t began = clock();
+	for (long r = 0; r < reps; r++)
+	{
+		for (int i = 0, k = 0; i < n; i++)
+			for (int j = i; j < n; j++)
+				L[k++] = A[i*n+j] + r*1e-9;
+		for (int i = 0; i < n; i++)
+			x[i] = 1.;
+		ldl(SymRef<n>(L), (float)SOLVE_TOL);
+		ldl_solve(SymRef<n>(L), Ref<n, 1>(x));
+	}
+	double tl = (double)(clock() - began)/CLOCKS_PER_SEC;
+	began = clock();
+	for (long r = 0; r < reps; r++)
+	{
+		for (int i = 0; i < n*n; i++)
+			G[i] = A[i] + r*1e-9;
+		for (int i = 0; i < n; i++)
+			x[i] = 1.;
+		inv(G, n, Gv);
+		mul(Gv, x, n, n, 1, y);
+	}
+	double tg = (double)(clock() - began)/CLOCKS_PER_SEC;
+	double apart = 0.;
+	for (int i = 0; i < n; i++)
+		x[i] = 1.;
+	ldl_solve(SymRef<n>(L), Ref<n, 1>(x));
+	for (int i = 0; i < n; i++)
+		apart = fmax(apart, fabs(x[i] - y[i])/fabs(y[i]));
+	printf("  %d  ldl %4ld flops %2ld divides %.3f us   "
+			"gauss-jordan %4ld flops %3ld divides %.3f us   apart %.1e\n", n,
+			lc, ld, tl/reps*1e6, gc, gd, tg/reps*1e6, apart);
+}
+
+static void solvers()
+{
+	printf("solvers in float, residual of A*x = b:\n");
+	for (size_t i = 0; i < sizeof(SOLVE_CASES)/sizeof(SOLVE_CASES[0]); i++)
+		solve_case<N>(SOLVE_CASES[i]);
+	for (size_t i = 0; i < sizeof(SOLVE_CASES)/sizeof(SOLVE_CASES[0]); i++)
+		solve_case<M>(SOLVE_CASES[i]);
+	printf("  cost of a solve, one right hand side:\n");
+	solve_cost<M>(2000000);
+	solve_cost<N>(200000);
+}
+
+// Inputs of one control tick, in double.
+struct TickInput
+{
+	double dstate[DOF], daltitude, angles[3];
+};
+
+// Synthetic control ticks: errors swinging about in every axis, with the
+// sub turning all the way round and holding altitude every other 5 minutes.
+static TickInput tick_input(double t)
+{
+	TickInput in;
+	in.dstate[F] = 3.*sin(t/7.);
+	in.dstate[H] = 2.*cos(t/5.);
+	in.dstate[V] = 0.5*sin(t/3.);
+	in.dstate[Y] = angle_difference(fmod(t*7., 360.) - 180.,
+			fmod(t*7. + 20.*sin(t/3.) + 360., 360.) - 180.);
+	in.dstate[P] = 4.*sin(t/2.);
+	in.dstate[R] = 3.*cos(t/2.5);
+	in.daltitude = fmod(t, 600.) < 300. ? -9999. : 0.5*sin(t/5.);
+	in.angles[0] = fmod(t*5., 360.) - 180.;
+	in.angles[1] = 8.*sin(t/2.);
+	in.angles[2] = 5.*cos(t/3.);
+	return in;
+}
+
+// Control in scalar T, with ORIENTATION in T for it to point at.
+template <class T>
+struct Controller
+{
+	T orientation[NUM_MOTORS][DOF+1];
+	Control<T> *control;
+
+	Controller()
+	{
+		for (int i = 0; i < NUM_MOTORS; i++)
+			for (int j = 0; j <= DOF; j++)
+				orientation[i][j] = ORIENTATION[i][j];
+		control = new Control<T>(orientation);
+	}
+
+	~Controller() { delete control; }
+
+	// Inputs go through float first, as they come from the rest of the
+	// firmware.
+	void tick(const TickInput &in, double dt, double p)
+	{
+		T dstate[DOF], angles[3];
+		for (int i = 0; i < DOF; i++)
+			dstate[i] = (float)in.dstate[i];
+		for (int i = 0; i < 3; i++)
+			angles[i] = (float)in.angles[i];
+		control->tick(dstate, T((float)in.daltitude), angles, T((float)dt),
+				T((float)p));
+	}
+};
+
+// Rough cycles a scalar operation takes on the ATmega2560: float from the
+// avr-libc benchmarks, Fixed for the 64 bit intermediates and 32 bit modulo
+// avr-gcc makes of it, and converting to and from the float the rest of the
+// firmware works in. Estimates only; the 'k' profiler's PROF_PID line
+// measures a tick on the board.
+struct OpCycles
+{
+	const char *name;
+	double add, multiply, divide, compare, trig, convert;
+};
+
+static const OpCycles OP_CYCLES[] = {
+	{ "float", 110., 140., 480., 50., 1700., 0. },
+	{ "Q16.16", 40., 200., 1500., 10., 800., 100. },
+};
+
+// Conversions a tick would take in a scalar other than float: dstate,
+// daltitude, the angles, dt and p in, and the thrusts and forces out.
+static const int CONVERSIONS = DOF + 6 + NUM_MOTORS + BODY_DOF;
+
+// Runs the control tick in float and in Q16.16 against double, then counts
+// what one tick does and estimates its cycles on the AVR.
+static void backends(double seconds)
+{
+	const double DT = 1./50., POWER = 0.8;
+	Controller<double> ref;
+	Controller<float> fl;
+	Controller<Fixed> fx;
+	long ticks = (long)(seconds/DT);
+	TickInput *in = new TickInput[ticks];
+	for (long i = 0; i < ticks; i++)
+		in[i] = tick_input((i + 1)*DT);
+
+	// A PID output within the minimum of zero is pushed out to it on the
+	// side of its sign, so rounding can flip it across, in any scalar. The
+	// ticks where that happens are counted apart.
+	double worst_thrust[2] = { 0., 0. }, worst_force[2] = { 0., 0. };
+	long flipped[2] = { 0, 0 };
+	for (long i = 0; i < ticks; i++)
+	{
+		ref.tick(in[i], DT, POWER);
+		fl.tick(in[i], DT, POWER);
+		fx.tick(in[i], DT, POWER);
+		double apart[2] = { 0., 0. };
+		for (int m = 0; m < NUM_MOTORS; m++)
+		{
+			double r = ref.control->thrust[m];
+			apart[0] = fmax(apart[0], fabs(fl.control->thrust[m] - r));
+			apart[1] = fmax(apart[1], fabs(value(fx.control->thrust[m]) - r));
+		}
+		for (int b = 0; b < 2; b++)
+		{
+			if (apart[b] > 0.01)
+			{
+				flipped[b]++;
+				continue;
+			}
+			worst_thrust[b] = fmax(worst_thrust[b], apart[b]);
+		}
+		if (apart[0] > 0.01 || apart[1] > 0.01)
+			continue;
+		for (int j = 0; j < BODY_DOF; j++)
+		{
+			double r = ref.control->forces[j];
+			worst_force[0] = fmax(worst_force[0],
+					fabs(fl.control->forces[j] - r));
+			worst_force[1] = fmax(worst_force[1],
+					fabs(value(fx.control->forces[j]) - r));
+		}
+	}
+
+	// Host time, each scalar on its own.
+	double took[3];
+	for (int b = 0; b < 3; b++)
+	{
+		Controller<double> d;
+		Controller<float> f;
+		Controller<Fixed> x;
+		clock_t began = clock();
+		for (long i = 0; i < ticks; i++)
+		{
+			if (b == 0)
+				d.tick(in[i], DT, POWER);
+			else if (b == 1)
+				f.tick(in[i], DT, POWER);
+			else
+				x.tick(in[i], DT, POWER);
+		}
+		took[b] = (double)(clock() - began)/CLOCKS_PER_SEC;
+	}
+
+	Controller<Flop> counted;
+	Flop::count = Flop::multiplies = Flop::divides = 0;
+	Flop::compares = Flop::trig = 0;
+	for (long i = 0; i < ticks; i++)
+		counted.tick(in[i], DT, POWER);
+	double adds = (double)(Flop::count - Flop::multiplies - Flop::divides)/ticks;
+	double muls = (double)Flop::multiplies/ticks;
+	double divs = (double)Flop::divides/ticks;
+	double cmps = (double)Flop::compares/ticks;
+	double trig = (double)Flop::trig/ticks;
+
+	printf("control tick at 50 Hz, %.0f s, against double:\n", seconds);
+	printf("  double      %.3f us each\n", took[0]/ticks*1e6);
+	printf("  float       %.3f us each  thrust %.1e  force %.1e  flipped %ld\n",
+			took[1]/ticks*1e6, worst_thrust[0], worst_force[0], flipped[0]);
+	printf("  Q16.16      %.3f us each  thrust %.1e  force %.1e  flipped %ld\n",
+			took[2]/ticks*1e6, worst_thrust[1], worst_force[1], flipped[1]);
+	printf("  per tick %.0f adds %.0f multiplies %.0f divides %.0f compares "
+			"%.0f sines and cosines\n", adds, muls, divs, cmps, trig);
+	for (size_t b = 0; b < sizeof(OP_CYCLES)/sizeof(OP_CYCLES[0]); b++)
+	{
+		const OpCycles &c = OP_CYCLES[b];
+		double cycles = adds*c.add + muls*c.multiply + divs*c.divide +
+			cmps*c.compare + trig*c.trig + CONVERSIONS*c.convert;
+		printf("  %-10s  about %.0f cycles a tick on the AVR, %.2f ms at 16 MHz\n",
+				c.name, cycles, cycles/16e3);
+	}
+	delete[] in;
+}
+
+// In link_bench.cpp.
+void link_bench();
+
+int main()
+{
+	count_flops();
+	drift("nominal", 1., 3600., true);
+	drift("stiff", 1e-6, 3600., false);
+	bool ok = cruise(8.);
+	steady(3600.);
+	matrices(200000);
+	solvers();
+	backends(3600.);
+	link_bench();
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,244 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+
+/** @file link_bench.cpp
+ *  @brief Host benchmark of the topside link in console and binary mode.
+ *
+ *  Puts the common messages through the real Link, CommandLexer,
+ *  ProtoDecoder and Telemetry code on a port that keeps what is written to
+ *  it, in both modes. For each it reports the bytes on the wire, how long
+ *  that takes at 9600 and 115200 baud, the round trip of a query, how many
+ *  records a second the link can carry, and the host time the sub's side
+ *  takes. Replies read back from console mode are checked against the
+ *  floats that were sent, which binary mode carries exactly.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <Arduino.h>
+#include "link.hpp"
+#include "telemetry.hpp"
+#include "protocol.hpp"
+
+// A serial port that keeps what is written to it, and reads back what it was
+// loaded with.
+struct Wire : public HardwareSerial
+{
+	uint8_t out[2048];
+	size_t sent;
+	const uint8_t *in;
+	size_t len, pos;
+
+	Wire() : sent(0), in(NULL), len(0), pos(0) {}
+	size_t write(uint8_t c)
+	{
+		if (sent < sizeof(out))
+			out[sent] = c;
+		sent++;
+		return 1;
+	}
+	using Print::write;
+	int availableForWrite() { return sizeof(out) - sent; }
+	int available() { return len - pos; }
+	int read() { return pos < len ? in[pos++] : -1; }
+	int peek() { return pos < len ? in[pos] : -1; }
+
+	void load(const uint8_t *bytes, size_t n)
+	{
+		in = bytes;
+		len = n;
+		pos = 0;
+		sent = 0;
+	}
+};
+
+// A query as topside would send it in each mode.
+struct Query
+{
+	uint8_t text[64], frame[PROTO_MAX_FRAME];
+	size_t text_len, frame_len;
+};
+
+static void query(Query &q, char op, const float *args, int n)
+{
+	char *t = (char *)q.text;
+	size_t k = sprintf(t, "%c", op);
+	for (int i = 0; i < n; i++)
+		k += sprintf(t + k, " %g", args[i]);
+	t[k++] = '\n';
+	q.text_len = k;
+
+	uint8_t payload[4*CMD_MAX_ARGS];
+	for (int i = 0; i < n; i++)
+		proto_put_float(payload + 4*i, args[i]);
+	q.frame_len = proto_encode(op, 7, payload, 4*n, q.frame);
+}
+
+// Milliseconds n bytes take on the wire, at 10 bits a byte.
+static double wire_ms(size_t n, double baud)
+{
+	return n*10e3/baud;
+}
+
+// Runs a query through the sub's side of the link: poll() and, if v is
+// given, the reply. Returns the bytes sent back.
+static size_t serve(Link &link, Wire &wire, const Query &q, const float *v,
+		int n)
+{
+	if (link.binary)
+		wire.load(q.frame, q.frame_len);
+	else
+		wire.load(q.text, q.text_len);
+	Command cmd;
+	while (link.poll(cmd))
+		if (v)
+			link.reply(cmd.op, v, n, 6);
+	return wire.sent;
+}
+
+// Host microseconds one serve() takes, over many.
+static double serve_us(Link &link, Wire &wire, const Query &q, const float *v,
+		int n, long times)
+{
+	clock_t began = clock();
+	for (long i = 0; i < times; i++)
+		serve(link, wire, q, v, n);
+	return (double)(clock() - began)/CLOCKS_PER_SEC/times*1e6;
+}
+
+// Largest difference between v and the values of a console mode reply.
+static double text_error(const Wire &wire, const float *v, int n)
+{
+	char line[sizeof(wire.out) + 1];
+	memcpy(line, wire.out, wire.sent);
+	line[wire.sent] = '\0';
+	double worst = 0.;
+	char *p = line;
+	for (int i = 0; i < n; i++)
+		worst = fmax(worst, fabs(strtod(p, &p) - v[i]));
+	return worst;
+}
+
+static void queries()
+{
+	Wire wire;
+	Link text(wire), binary(wire);
+	binary.binary = true;
+
+	// A state of the sort 'c' answers with, and a setpoint.
+	const float state[DOF] = { 12.345678, -3.217, 1.503, 271.33, -2.125, 0.4 };
+	const float target[DOF] = { 12.5, -3.25, 1.5, 271.3, 0., 0. };
+	Query c, s;
+	query(c, 'c', NULL, 0);
+	query(s, 's', target, DOF);
+
+	size_t c_text = c.text_len + serve(text, wire, c, state, DOF);
+	double err = text_error(wire, state, DOF);
+	size_t c_binary = c.frame_len + serve(binary, wire, c, state, DOF);
+	const uint8_t *reply = wire.out;
+	ProtoDecoder decoder;
+	bool exact = false;
+	for (size_t i = 0; i < wire.sent; i++)
+	{
+		if (!decoder.feed(reply[i]))
+			continue;
+		exact = decoder.size == 4*DOF;
+		for (int j = 0; exact && j < DOF; j++)
+			exact = proto_get_float(decoder.payload + 4*j) == state[j];
+	}
+
+	const long TIMES = 200000;
+	printf("link, query and reply:\n");
+	printf("  %-22s %5s %9s %9s %11s\n", "", "bytes", "9600 ms",
+			"115200 ms", "host us");
+	printf("  %-22s %5zu %9.1f %9.2f %11.3f\n", "c and reply, console",
+			c_text, wire_ms(c_text, 9600), wire_ms(c_text, 115200),
+			serve_us(text, wire, c, state, DOF, TIMES));
+	printf("  %-22s %5zu %9.1f %9.2f %11.3f\n", "c and reply, binary",
+			c_binary, wire_ms(c_binary, 9600), wire_ms(c_binary, 115200),
+			serve_us(binary, wire, c, state, DOF, TIMES));
+	printf("  %-22s %5zu %9.1f %9.2f %11.3f\n", "s, console", s.text_len,
+			wire_ms(s.text_len, 9600), wire_ms(s.text_len, 115200),
+			serve_us(text, wire, s, NULL, 0, TIMES));
+	printf("  %-22s %5zu %9.1f %9.2f %11.3f\n", "s, binary", s.frame_len,
+			wire_ms(s.frame_len, 9600), wire_ms(s.frame_len, 115200),
+			serve_us(binary, wire, s, NULL, 0, TIMES));
+	printf("  console reply off by up to %.1e, binary reply %s\n", err,
+			exact ? "exact" : "NOT EXACT");
+}
+
+// Bytes a telemetry record of n values takes on the wire, and the host time
+// the sub takes to queue and send it.
+static size_t record(Link &link, Wire &wire, int n, double *us)
+{
+	float v[TLM_MAX_VALUES];
+	for (int i = 0; i < n; i++)
+		v[i] = 100.*sin(i + 0.5);
+
+	const long TIMES = 100000;
+	Telemetry *t = new Telemetry();
+	clock_t began = clock();
+	for (long i = 0; i < TIMES; i++)
+	{
+		wire.load(NULL, 0);
+		t->values('l', 123456 + i, 1, v, n, link);
+		t->flush(link);
+	}
+	*us = (double)(clock() - began)/CLOCKS_PER_SEC/TIMES*1e6;
+	delete t;
+	return wire.sent;
+}
+
+static void records()
+{
+	Wire wire;
+	Link text(wire), binary(wire);
+	binary.binary = true;
+
+	printf("link, telemetry records:\n");
+	printf("  %-22s %5s %9s %9s %11s\n", "", "bytes", "9600 Hz",
+			"115200 Hz", "host us");
+	static const int SIZES[] = { DOF, 3*DOF + NUM_MOTORS, TLM_MAX_VALUES };
+	for (size_t i = 0; i < sizeof(SIZES)/sizeof(SIZES[0]); i++)
+	{
+		for (int b = 0; b < 2; b++)
+		{
+			double us;
+			size_t n = record(b ? binary : text, wire, SIZES[i], &us);
+			char name[32];
+			sprintf(name, "%d values, %s", SIZES[i], b ? "binary" : "console");
+			printf("  %-22s %5zu %9.1f %9.1f %11.3f\n", name, n,
+					9600/10./n, 115200/10./n, us);
+		}
+	}
+}
+
+void link_bench()
+{
+	queries();
+	records();
+}
@@ -0,0 +1,82 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file adc.hpp
+ *  @brief Filtered analog inputs scanned in the background.
+ *
+ *  The ADC interrupt sums a power of two conversions of each input into one
+ *  sample, which gains a bit of resolution for every factor of four and
+ *  averages out noise, and runs the samples through a first order low pass.
+ *  Reading an input only copies the newest filtered value, so it costs nothing
+ *  like the blocking analogRead() calls it replaces.
+ */
+#ifndef ADC_HPP
+#define ADC_HPP
+
+#include <Arduino.h>
+
+/** @brief Inputs in the order of the rows of ADC_INPUTS.
+ */
+enum adc_input
+{
+	ADC_DEPTH,
+	ADC_BATTERY,
+	NUM_ADC_INPUTS
+};
+
+/** @brief Starts scanning the inputs in ADC_INPUTS.
+ */
+void adc_start();
+
+/** @brief Reads the newest filtered value of an input.
+ *
+ *  Safe to call with interrupts enabled. Returns 0 until the first sample is
+ *  in.
+ *
+ *  @param input Input to read.
+ *
+ *  @return The value on the scale of analogRead(), 0 to 1023, with fractions.
+ */
+float adc_read(enum adc_input input);
+
+/** @brief Finds when the newest value of an input was true.
+ *
+ *  Stamped by the interrupt when the value is published, less the delay of
+ *  the sum, half its length, and of the low pass.
+ *
+ *  @param input Input to look at.
+ *
+ *  @return The time in micros().
+ */
+uint32_t adc_time(enum adc_input input);
+
+/** @brief Counts the filtered samples of an input so far.
+ *
+ *  @param input Input to count.
+ *
+ *  @return Number of samples, wrapping at 65536.
+ */
+uint16_t adc_count(enum adc_input input);
+
+#endif
@@ -35,6 +35,7 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
 
 enum {COMPONENT_MIN, COMPONENT_MAX};
 
@@ -76,6 +77,15 @@ float ahrs_att(enum att_axis dir);
  */
 float ahrs_accel(enum accel_axis dir);
 
+/** @brief Finds when the current data arrived.
+ *
+ *  Stamped by the receive interrupt when the last byte of the datagram
+ *  arrived, and kept with the data in the triple buffer.
+ *
+ *  @return micros() when the datagram was completed.
+ */
+uint32_t ahrs_time();
+
 /** @brief Tells AHRS to return accuracy of current data.
  *
  *  Values:
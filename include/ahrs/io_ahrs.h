@@ -36,6 +36,7 @@ extern "C" {
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /** @brief Prepare AHRS to receive data.
  * 
@@ -72,6 +73,16 @@ int io_ahrs_recv_start(int (*handler)());
  */
 void io_ahrs_recv_stop();
 
+/** @brief Finds when the byte being handled arrived.
+ *
+ *  Captured by the Receive Complete Interrupt before it calls the receive
+ *  handler, so it does not depend on how long anything else held up the
+ *  handler. Only meaningful from within the handler.
+ *
+ *  @return micros() when the byte arrived.
+ */
+uint32_t io_ahrs_recv_time();
+
 /** @brief Handles IO to AHRS using file streams.
  *
  *  IO with this is blocking, so one might use normal stdio functions directly
@@ -0,0 +1,131 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file command.hpp
+ *  @brief Non-blocking lexer for serial console commands.
+ *
+ *  A command is a single letter followed by a fixed number of numeric
+ *  arguments, eg "s 1. 0. 0. 90. 0. 0.\n". Any character that can't be part of
+ *  a number separates arguments, so the last argument needs a terminator
+ *  (normally the newline). Bytes are fed in one at a time, so a command can
+ *  arrive split across any number of loop iterations without ever waiting on
+ *  the serial port.
+ */
+#ifndef COMMAND_HPP
+#define COMMAND_HPP
+
+#include <Arduino.h>
+
+/** Most arguments any command takes.
+ */
+#define CMD_MAX_ARGS 10
+
+/** Longest number that will be parsed, not including the terminator.
+ */
+#define CMD_MAX_TOKEN 15
+
+/** @brief A complete command and its arguments.
+ */
+struct Command
+{
+	/** Command letter. */
+	char op;
+
+	/** Number of arguments. */
+	uint8_t argc;
+
+	/** Arguments, in the order they were received. */
+	float args[CMD_MAX_ARGS];
+};
+
+/** @brief Finds how many arguments a command takes.
+ *
+ *  @param op The command letter.
+ *  @return The number of arguments, or -1 if op isn't a command.
+ */
+int command_args(char op);
+
+/** @brief Assembles commands one byte at a time.
+ */
+struct CommandLexer
+{
+	/** The command being assembled. Only valid right after feed() returns
+	 *  true. */
+	Command cmd;
+
+	/** Characters of the argument currently being read. */
+	char token[CMD_MAX_TOKEN+1];
+	uint8_t len;
+
+	/** Number of arguments the current command needs. */
+	uint8_t want;
+
+	/** True while arguments are still expected for cmd.op. */
+	bool busy;
+
+	/** Number of partial commands thrown away. */
+	uint16_t dropped;
+
+	/** A byte that arrived but hasn't been lexed yet, if holding. This is a
+	 *  command letter that also ended the last argument of the command
+	 *  before it. */
+	char held;
+	bool holding;
+
+	CommandLexer();
+
+	/** @brief Feeds the next received byte to the lexer.
+	 *
+	 *  A command letter that arrives before the previous command has all of
+	 *  its arguments replaces it, so a garbled command is dropped instead of
+	 *  being run with the wrong arguments.
+	 *
+	 *  A command letter straight after the last argument of a command, as in
+	 *  "p 0.5c", both finishes that command and starts its own. It is held
+	 *  and lexed before the next byte, or by flush().
+	 *
+	 *  @param c The received byte.
+	 *  @return True when cmd holds a complete command.
+	 */
+	bool feed(char c);
+
+	/** @brief Lexes a byte held back by feed(), if any.
+	 *
+	 *  Call once no more input is waiting, so a command letter held back
+	 *  isn't left until the next byte arrives.
+	 *
+	 *  @return True when cmd holds a complete command.
+	 */
+	bool flush();
+
+	/** @brief Throws away any partially received command.
+	 */
+	void reset();
+
+private:
+	bool lex(char c);
+	void clear();
+};
+
+#endif
@@ -62,6 +62,42 @@ static const bool FAR = true;
  *  M5 motors (:P).
  */
 static const bool SIM = false;
+
+/** Set to false to have setpoint changes go straight to the PIDs as steps
+ *  rather than along the profiles limited by TRAJECTORY.
+ */
+static const bool SHAPE_SETPOINTS = true;
+
+/** Set to true to have the Kalman filter use the gain tables in
+ *  kalman_gains.h while the DVL is steady, instead of working out the
+ *  covariance every sample. See kalman.hpp.
+ */
+static const bool STEADY_GAINS = false;
+///@}
+
+/*! @name Sensor latencies.
+ */
+///@{
+/** Microseconds from when a sample was true to when the last byte of its
+ *  datagram arrives, which is mostly the time to send it: 38 bytes at 38400
+ *  baud for the AHRS and 34 at 9600 for the DVL. The DVL also averages over
+ *  its ping, which the filter accounts for separately.
+ */
+static const unsigned long AHRS_LATENCY = 10000;
+static const unsigned long DVL_LATENCY = 35000;
+///@}
+
+/*! @name Sensor screening.
+ */
+///@{
+/** How far in meters a range to the bottom or a depth can be from the median
+ *  of the last few before the median replaces it. See screen.hpp. The median
+ *  is a couple of samples old, so these have to be more than the sub can
+ *  move in that time: a quarter second for the range, a few tens of
+ *  milliseconds for the depth. The range also changes with the bottom.
+ */
+static const float RANGE_SCREEN = 0.5;
+static const float DEPTH_SCREEN = 0.1;
 ///@}
 
 /*! @name Constants for degrees of freedom with North-East-Down coordinates. 
@@ -175,11 +211,59 @@ static const float GAINS[7][3] =
 	{ 0.85, 0.00, 0.10 }
 };
 
+/*! @name Setpoint trajectory configuration.
+ */
+/** Rows correspond to F, H, V, Y, P, and R while columns are the largest speed
+ *  and acceleration the desired state changes with, in m/s and m/s^2 or
+ *  degrees/s and degrees/s^2. A row of zeros makes that setpoint a step. With
+ *  the current gains only depth changes settle faster when shaped, since the
+ *  horizontal controllers lag a moving setpoint and overshoot more after it.
+ */
+static const float TRAJECTORY[6][2] = 
+{
+	{ 0.00, 0.00 },
+	{ 0.00, 0.00 },
+	{ 0.30, 0.20 },
+	{ 0.00, 0.00 },
+	{ 0.00, 0.00 },
+	{ 0.00, 0.00 }
+};
+
+/*! @name Motion model configuration.
+ */
+/** Rows are surge and sway while columns are the force of one thruster at
+ *  full power in N, the mass including added mass in kg, and the linear and
+ *  quadratic drag in N s/m and N s^2/m^2. The Kalman filter uses these to
+ *  dead reckon while the DVL is out. They are the simulator's vehicle, and
+ *  want measuring on the sub, eg by coasting down from full speed.
+ */
+static const float MOTION_MODEL[2][4] = 
+{
+	{ 40., 45., 10., 40. },
+	{ 40., 55., 15., 60. }
+};
+
+/*! @name Analog input configuration.
+ */
+/** Rows correspond to the adc_input entries while columns are the ADC channel,
+ *  the log2 of how many conversions are summed into one sample, and the shift
+ *  of the low pass filter run on those samples, 0 for none. Conversions are
+ *  shared round robin between the rows, so each row gets IO_ADC_HZ divided by
+ *  the number of rows. Depth goes unfiltered past the sum since the depth
+ *  controller settles slower with any more lag.
+ */
+static const int ADC_INPUTS[2][3] = 
+{
+	{ 0, 3, 0 },
+	{ 1, 6, 3 }
+};
+
 /*! @name Conversions.
  */
 ///@{
 #define D2R 3.1415/180.
 #define R2D 180./3.1415
+#define GRAVITY 9.81
 ///@}
 
 #endif 
@@ -0,0 +1,137 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+
+/** @file control.hpp
+ *  @brief Arithmetic of one control tick, generic over the scalar.
+ *
+ *  Motors runs it in float and sends the thrusts to the M5s. The bench runs
+ *  it in double as a reference and in the Fixed of fixed.hpp, to see what
+ *  each would cost and how far it strays.
+ */
+#ifndef CONTROL_HPP
+#define CONTROL_HPP 
+
+#include "config.h"
+#include "pid.hpp"
+#include "rotation.h"
+#include "util.hpp"
+
+/** @brief PID controllers and the thrusts and forces they come to.
+ */
+template <class T>
+struct Control
+{
+	/** PID controllers for each degree of freedom. */
+	BasicPID<T> controllers[DOF+1];
+
+	/** Current thrust values for each of the motors. */
+	T thrust[NUM_MOTORS];
+
+	/** Theoretical forces along north, east, and down, in units of one motor
+	 *  at full power. The rest are 0. */
+	T forces[DOF];
+
+	/** Computed PID values from each controller. */
+	T pid[DOF];
+
+	/** ORIENTATION in T, which the float one can share rather than take up
+	 *  RAM with a copy. */
+	const T (*orientation)[DOF+1];
+
+	Control(const T (*o)[DOF+1]) : orientation(o)
+	{
+		for (int i = 0; i <= DOF; i++)
+			this->controllers[i].init(GAINS[i][0], GAINS[i][1], GAINS[i][2]);
+		for (int i = 0; i < NUM_MOTORS; i++)
+			this->thrust[i] = 0.;
+		for (int i = 0; i < DOF; i++)
+			this->forces[i] = 0.;
+		for (int i = 0; i < DOF; i++)
+			this->pid[i] = 0.;
+	}
+
+	/** @brief Works out the thrusts and forces for one tick.
+	 *
+	 *  @param dstate Difference between desired and current state.
+	 *  @param daltitude Difference between distances from bottom, below
+	 *                   -999 to hold depth instead.
+	 *  @param angles Current euler angles.
+	 *  @param dt Time since the last tick in seconds. Must not be 0.
+	 *  @param p Current submarine power.
+	 */
+	void tick(const T *dstate, T daltitude, const T *angles, T dt, T p)
+	{
+		// Calculate PID values. Third argument is minimum PID value, which
+		// allows changes for small values, though it doesn't seem to affect
+		// the code for now.
+		pid[F] = controllers[F].calculate(dstate[F], dt, T(0.20));
+		pid[H] = controllers[H].calculate(dstate[H], dt, T(0.20));
+		for (int i = BODY_DOF; i < GYRO_DOF; i++)
+			pid[i] = controllers[i].calculate(dstate[i], dt, T(0.0));
+
+		// Choose between depth from bottom or depth sensor. 
+		if (daltitude < T(-999.))
+			pid[V] = controllers[V].calculate(dstate[V], dt, T(0.00));
+		else 
+			pid[V] = -controllers[D].calculate(daltitude, dt, T(0.00));
+
+		// Default motor thrusts are 0. Add 0.15 to vertical thrusts so the
+		// sub remains at the same depth.
+		for (int i = 0; i < NUM_MOTORS; i++)
+			thrust[i] = 0.;
+		if (p > T(0.01))
+		{
+			thrust[0] += T(0.15);
+			thrust[1] -= T(0.15);
+			thrust[2] -= T(0.15);
+			thrust[3] += T(0.15);
+		}
+
+		// Compute final thrust given to each motor based on orientation
+		// matrix and PID values.
+		for (int i = 0; i < NUM_MOTORS; i++)
+			for (int j = 0; j < DOF; j++) 
+				thrust[i] += p*pid[j]*orientation[i][j];
+
+		// Compute forces from motors, in units of one motor at full power.
+		// The Kalman filter dead reckons with them while the DVL is out. The
+		// M5s saturate at full power, and ORIENTATION says how much each
+		// pushes along each direction.
+		T bforces[BODY_DOF];
+		for (int j = 0; j < BODY_DOF; j++)
+		{
+			bforces[j] = 0.;
+			for (int i = 0; i < NUM_MOTORS; i++)
+				bforces[j] += limit(thrust[i], T(-1.), T(1.))*orientation[i][j];
+		}
+		T iforces[BODY_DOF];
+		body_to_inertial(bforces, angles, iforces);
+		forces[F] = iforces[F];
+		forces[H] = iforces[H];
+		forces[V] = iforces[V]; 
+	}
+};
+
+#endif
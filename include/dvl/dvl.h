@@ -36,6 +36,7 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /** @brief Configures proper DVL data components.
  */
@@ -81,6 +82,13 @@ int32_t dvl_get_upward_vel();
  */
 int32_t dvl_get_range_to_bottom();
 
+/** @brief Finds when the current data arrived.
+ *
+ *  @return micros() when the receive interrupt got the last byte of the
+ *          datagram.
+ */
+uint32_t dvl_get_time();
+
 /** @brief Parses and processes received data.
  *
  *  @return True when a complete datagram has been parsed.
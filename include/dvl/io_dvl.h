@@ -39,6 +39,7 @@ extern "C" {
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /** @brief Prepare DVL to receive data.
  *
@@ -58,6 +59,14 @@ void io_dvl_recv_begin();
  */
 void io_dvl_recv_end();
 
+/** @brief Finds when the byte being handled arrived.
+ *
+ *  See io_ahrs_recv_time.
+ *
+ *  @return micros() when the byte arrived.
+ */
+uint32_t io_dvl_recv_time();
+
 /** @brief Handles communication to DVL using file stream format.
  */
 extern FILE *io_dvl;
@@ -0,0 +1,116 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+
+/** @file fixed.hpp
+ *  @brief Q16.16 fixed point scalar for the control math.
+ *
+ *  The ATmega2560 has no FPU, so every float add is a library call of around
+ *  a hundred cycles. Fixed keeps a value as a 32 bit integer in units of
+ *  2^-16, which covers +-32768 to within 1.5e-5, and adds in a few
+ *  instructions. Everything saturates at the ends of that range rather than
+ *  wrapping around, and dividing by zero gives the end with the sign of the
+ *  dividend, so a controller that runs away pins its output instead of
+ *  flipping it.
+ *
+ *  The templates in pid.hpp, rotation.h, util.hpp and control.hpp take it
+ *  in place of float or double. Those in kalman.hpp take it too, but only
+ *  so the bench can show it is no good for the Kalman filter, whose
+ *  variances go far below its resolution.
+ */
+#ifndef FIXED_HPP
+#define FIXED_HPP
+
+#include <stdint.h>
+
+/** Largest raw value, and the negative of the smallest.
+ */
+#define FIXED_MAX ((int32_t)0x7fffffff)
+
+/** @brief A Q16.16 number that saturates.
+ */
+struct Fixed
+{
+	/** The value times 2^16. */
+	int32_t v;
+
+	Fixed() {}
+	Fixed(double x) : v(x >= FIXED_MAX/65536. ? FIXED_MAX :
+			x <= -FIXED_MAX/65536. ? -FIXED_MAX :
+			x == x ? (int32_t)(x*65536. + (x < 0. ? -0.5 : 0.5)) : 0) {}
+
+	/** @brief A Fixed from its raw value, clamped to the range.
+	 */
+	static Fixed raw(int64_t r)
+	{
+		Fixed f;
+		f.v = r > FIXED_MAX ? FIXED_MAX : r < -FIXED_MAX ? -FIXED_MAX :
+			(int32_t)r;
+		return f;
+	}
+
+	explicit operator double() const { return v/65536.; }
+
+	Fixed operator+(Fixed o) const { return raw((int64_t)v + o.v); }
+	Fixed operator-(Fixed o) const { return raw((int64_t)v - o.v); }
+	Fixed operator-() const { return raw(-(int64_t)v); }
+	Fixed operator*(Fixed o) const
+	{
+		return raw(((int64_t)v*o.v + 0x8000) >> 16);
+	}
+	Fixed operator/(Fixed o) const
+	{
+		if (o.v == 0)
+			return raw(v < 0 ? -FIXED_MAX : FIXED_MAX);
+		return raw(((int64_t)v << 16)/o.v);
+	}
+	Fixed &operator+=(Fixed o) { return *this = *this + o; }
+	Fixed &operator-=(Fixed o) { return *this = *this - o; }
+	Fixed &operator*=(Fixed o) { return *this = *this*o; }
+
+	bool operator==(Fixed o) const { return v == o.v; }
+	bool operator!=(Fixed o) const { return v != o.v; }
+	bool operator<(Fixed o) const { return v < o.v; }
+	bool operator>(Fixed o) const { return v > o.v; }
+	bool operator<=(Fixed o) const { return v <= o.v; }
+	bool operator>=(Fixed o) const { return v >= o.v; }
+};
+
+inline Fixed fabs(Fixed x)
+{
+	return x.v < 0 ? -x : x;
+}
+
+/** @brief Sine of an angle in degrees.
+ *
+ *  Interpolated from a table of whole degrees, to within 4e-5, without
+ *  going through float.
+ */
+Fixed sin_deg(Fixed a);
+
+/** @brief Cosine of an angle in degrees, like sin_deg().
+ */
+Fixed cos_deg(Fixed a);
+
+#endif
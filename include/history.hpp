@@ -0,0 +1,86 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file history.hpp
+ *  @brief Recent attitude samples, to look up the attitude at an earlier time.
+ *
+ *  A sensor measures in the body frame, so its sample has to be rotated with
+ *  the attitude at the time it was measured. The DVL averages over a ping and
+ *  its datagram takes tens of milliseconds to send, so by the time it arrives
+ *  the sub may have turned since. This keeps the last few AHRS samples with
+ *  their times and interpolates between them.
+ */
+#ifndef HISTORY_HPP
+#define HISTORY_HPP
+
+#include <Arduino.h>
+
+/** Number of samples kept. At 30 Hz this covers a quarter of a second. */
+#define HISTORY_LEN 8
+
+struct History
+{
+	/** Ring buffer of yaw, pitch, and roll in degrees within [-180, 180]. */
+	float angles[HISTORY_LEN][3];
+
+	/** micros() when each sample was true. */
+	uint32_t time[HISTORY_LEN];
+
+	/** Index of the newest sample and number of samples kept. */
+	uint8_t head, num;
+
+	History();
+
+	/** @brief Forgets every sample.
+	 */
+	void clear();
+
+	/** @brief Adds a sample, dropping the oldest if full.
+	 *
+	 *  @param t Time the sample was true, no earlier than the newest.
+	 *  @param a Yaw, pitch, and roll.
+	 */
+	void record(uint32_t t, const float *a);
+
+	/** @brief Finds the attitude at some time.
+	 *
+	 *  Interpolates between the samples on either side, the short way around.
+	 *  Times outside the samples get the nearest one.
+	 *
+	 *  @param t Time wanted.
+	 *  @param a Yaw, pitch, and roll, set.
+	 *
+	 *  @return False if there are no samples, in which case a is unchanged.
+	 */
+	bool at(uint32_t t, float *a) const;
+
+	/** @brief Finds how fast the attitude is changing.
+	 *
+	 *  @param r Yaw, pitch, and roll rates in degrees per second between the
+	 *           two newest samples, set to 0 without two samples.
+	 */
+	void rate(float *r) const;
+};
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file io_adc.h
+ *  @brief Low-level function definitions for the interrupt driven ADC scan.
+ */
+#ifndef IO_ADC_H
+#define IO_ADC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/** Conversions per second across all channels. One conversion is started on
+ *  every timer 0 overflow, ie every 1024 us at 16 MHz.
+ */
+#define IO_ADC_HZ 976.5625
+
+/** @brief Starts scanning channels from the ADC complete interrupt.
+ *
+ *  Conversions are auto triggered by timer 0 overflowing, which millis()
+ *  already keeps running, so no timer is taken and the rate is fixed. The
+ *  channels are converted round robin. analogRead() must not be used while
+ *  the scan runs, since it would change the multiplexer under it.
+ *
+ *  @param channels ADC channels to scan, 0 to 15 for A0 to A15.
+ *  @param n Number of channels.
+ *  @param handler Called from the interrupt with the position of the channel
+ *                 in channels and the 10 bit result.
+ */
+void io_adc_start(uint8_t const *channels, uint8_t n,
+		void (*handler)(uint8_t idx, uint16_t val));
+
+/** @brief Stops the scan.
+ */
+void io_adc_stop();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,53 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file io_sched.h
+ *  @brief Low-level timer function definitions for the scheduler tick.
+ */
+#ifndef IO_SCHED_H
+#define IO_SCHED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Starts the timer interrupt that drives the scheduler.
+ *
+ *  Uses 16 bit timer NTIMER in CTC mode, which must not be shared with anything
+ *  else (timer 2 is used by the servos and timer 3 by the M5s).
+ *
+ *  @param hz Frequency of the interrupt.
+ *  @param handler Function called from the interrupt on every tick.
+ */
+void io_sched_start(unsigned int hz, void (*handler)());
+
+/** @brief Stops the scheduler timer interrupt.
+ */
+void io_sched_stop();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -26,74 +26,431 @@
  *  @brief Kalman filter struct and constant definitions.
  *
  *  The state of the Kalman filter can be described by the following vector: 
- *  [X VX AX Y VY AY]
+ *  [X VX AX Y VY AY BU BV]
  *
- *  The main measurement instrument used for this Kalman filter is a DVL, which
- *  returns VX and VY. The exact variances of the DVL are on the spreadsheet.
+ *  BU and BV are the bias of the accelerometer along surge and sway, in
+ *  m/s^2. They are modeled as constant apart from a slow random walk for
+ *  temperature drift, so they are estimated all the time rather than in a
+ *  calibration before the run. The accelerometer alone can't tell a bias from
+ *  an acceleration. The DVL can, since an acceleration changes the velocity
+ *  and a bias doesn't, and turning helps, since a bias turns with the sub.
+ *
+ *  The covariance of the state is symmetric, so it is kept as its upper
+ *  triangle by rows, N*(N+1)/2 floats, and read through SymRef in
+ *  matrix.hpp.
+ *
+ *  The state is predicted forward every time the AHRS sends a sample, and
+ *  corrected with its accelerometer, which gives AX and AY once gravity is
+ *  removed and the accelerations are rotated into the inertial frame. The DVL
+ *  returns VX and VY a few times a second and corrects the velocities in
+ *  between.
+ *
+ *  Without DVL velocities, the accelerometer alone lets the velocity wander
+ *  off as a random walk. When none have come for DROPOUT_TIME, whether from
+ *  errors, being too close to the bottom, or the DVL being off, the filter
+ *  also corrects with a motion model: the thrust the motors are commanded to
+ *  push with, less the drag at the estimated velocity, over the mass. Drag
+ *  ties the velocity to the acceleration, so it can't wander far. Once the
+ *  DVL is back, its first few samples are weighted less so the estimate eases
+ *  back onto it instead of jumping.
+ *
+ *  A DVL velocity that is too far from the prediction to be believed is
+ *  thrown out before any of it is applied: the normalized innovation squared
+ *  of the whole sample is chi-square with M degrees of freedom, and one above
+ *  DVL_GATE is counted and dropped. A filter that has gone wrong would gate
+ *  out every sample, so the gate is off while the DVL is eased back in, and a
+ *  run of rejects long enough to drop out lets the next sample in.
+ *
+ *  Angles are taken to be exact, like everywhere else, which leaves the model
+ *  linear. An error state EKF over this state is then the same filter.
+ *
+ *  While the DVL is steady, the covariance and so the gains settle into the
+ *  same pattern whatever the state is, and working them out every sample is
+ *  most of what the filter costs on the AVR. With STEADY_GAINS, once the DVL
+ *  has been steady for STEADY_SETTLE samples, the filter stops working out the
+ *  covariance and takes its gains from the tables in kalman_gains.h, by the
+ *  time since the last DVL correction, turned to the heading. Only the
+ *  variance of the position, which never settles, is kept up. At a dropout
+ *  the covariance is taken from the tables too and the full filter takes
+ *  over again, for the motion model.
+ *
+ *  The model and the correction are templates over the scalar, like the
+ *  control math, so the bench can run the filter's own arithmetic in double
+ *  and Q16.16 against the float it runs in here.
+ *
+ *  Every correction keeps its innovations, how far each measurement was from
+ *  what the state predicted, next to the variance the filter expected them to
+ *  have. When Qk and the R matrices are right, the normalized innovation
+ *  squared averages M. The 'i' command sends them topside, and
+ *  "tuning/noise.py" fits new Qk and R values from a log of them.
  *  
  *  @author David Zhang
  */
 #ifndef KALMAN_HPP
 #define KALMAN_HPP
 
+#include <Arduino.h>
+#include "matrix.hpp"
+
 /** N represents the number of elements in the state, while M represents the
  *  number of sensors. 
  */
-static const int N = 6;
+static const int N = 8;
 static const int M = 2;
 
-/** Qk describes how accurate the model is. The variance of each element of the
- *  should be along the main diagonal of the matrix.
+/** Qk describes how accurate the model is. The variance each element of the
+ *  state gains per second should be along the main diagonal of the matrix,
+ *  since the filter is predicted at whatever rate the AHRS runs. The bias
+ *  drifts by about 0.1 m/s^2 over a half hour run. Only the main diagonal
+ *  is used.
  */
 static float Qk[N*N] = {
-	0.005, 0.000, 0.000, 0.000, 0.000, 0.000,
-	0.000, 0.005, 0.000, 0.000, 0.000, 0.000,
-	0.000, 0.000, 0.005, 0.000, 0.000, 0.000,
-	0.000, 0.000, 0.000, 0.005, 0.000, 0.000,
-	0.000, 0.000, 0.000, 0.000, 0.005, 0.000,
-	0.000, 0.000, 0.000, 0.000, 0.000, 0.005
+	0.000, 0.000, 0.000, 0.000, 0.000, 0.000, 0.000, 0.000,
+	0.000, 0.010, 0.000, 0.000, 0.000, 0.000, 0.000, 0.000,
+	0.000, 0.000, 0.500, 0.000, 0.000, 0.000, 0.000, 0.000,
+	0.000, 0.000, 0.000, 0.000, 0.000, 0.000, 0.000, 0.000,
+	0.000, 0.000, 0.000, 0.000, 0.010, 0.000, 0.000, 0.000,
+	0.000, 0.000, 0.000, 0.000, 0.000, 0.500, 0.000, 0.000,
+	0.000, 0.000, 0.000, 0.000, 0.000, 0.000, 1e-5,  0.000,
+	0.000, 0.000, 0.000, 0.000, 0.000, 0.000, 0.000, 1e-5
 };
 
-/** Hk maps the predicted state to measurements. 
+/** Hk maps the predicted state to DVL measurements. 
  */
 static float Hk[M*N] = {
- 	0.000, 1.000, 0.000, 0.000, 0.000, 0.000,
-	0.000, 0.000, 0.000, 0.000, 1.000, 0.000
+ 	0.000, 1.000, 0.000, 0.000, 0.000, 0.000, 0.000, 0.000,
+	0.000, 0.000, 0.000, 0.000, 1.000, 0.000, 0.000, 0.000
 };
 
-/** Rk describes the precision of each measurement.
+/** Rk describes the precision of each DVL measurement. It is looser than the
+ *  DVL's own spec to cover bottom tracking in a small pool. Only the main
+ *  diagonal is used, since measurements are applied one at a time.
  */
 static float Rk[M*M] = {
-	5.000, 0.000,
-	0.000, 5.000
+	0.010, 0.000,
+	0.000, 0.010
+};
+
+/** Ha maps the predicted state to accelerometer measurements. The bias
+ *  columns depend on the heading and are filled in by bias_rows().
+ */
+static float Ha[M*N] = {
+ 	0.000, 0.000, 1.000, 0.000, 0.000, 0.000, 0.000, 0.000,
+	0.000, 0.000, 0.000, 0.000, 0.000, 1.000, 0.000, 0.000
+};
+
+/** Rm describes how far off the acceleration the motion model predicts may
+ *  be, along surge and sway. Only the main diagonal is used.
+ */
+static float Rm[M*M] = {
+	3.000, 0.000,
+	0.000, 3.000
+};
+
+/** Microseconds without a DVL velocity before the motion model takes over.
+ */
+#define DROPOUT_TIME 500000UL
+
+/** Number of DVL samples after a dropout that are weighted less. The first
+ *  has its variance multiplied by (DVL_BLEND + 1)^2, then DVL_BLEND^2, and so
+ *  on.
+ */
+#define DVL_BLEND 4
+
+/** Number of DVL samples in a row the full filter takes before the gain tables
+ *  take over, with STEADY_GAINS.
+ */
+#define STEADY_SETTLE 40
+
+/** Normalized innovation squared above which a DVL velocity is thrown out.
+ *  Chi-square with M = 2 degrees of freedom is above it 0.1% of the time.
+ *  One that comes out NaN or infinite, from a state or covariance that has
+ *  gone bad, is thrown out too.
+ */
+#define DVL_GATE 13.8
+
+/** Fraction of its variance an innovation has to have left, once the rows
+ *  before it are taken out, to be counted in the normalized innovation
+ *  squared. Below it, what is left is float rounding. See ldl().
+ */
+#define SOLVE_TOL 1e-5
+
+/** Ra describes the precision of each accelerometer measurement, including
+ *  gravity that leaks in through errors in pitch and roll. Only the main
+ *  diagonal is used.
+ */
+static float Ra[M*M] = {
+	0.200, 0.000,
+	0.000, 0.200
+};
+
+/** @brief Kinds of measurement the state is corrected with.
+ */
+enum innov_kind
+{
+	INNOV_ACCEL, // Ra
+	INNOV_DVL,   // Rk
+	INNOV_MODEL, // Rm
+	NUM_INNOV
+};
+
+/** @brief The innovations of the latest correction of one kind.
+ */
+struct Innovation
+{
+	/** Number of corrections of this kind so far, wrapping. */
+	uint16_t count;
+
+	/** Each measurement less what the state predicted it to be, in the order
+	 *  they were applied. */
+	float y[M];
+
+	/** Variance each was expected to have, that of the state plus r. */
+	float s[M];
+
+	/** Variance of the measurement itself. */
+	float r[M];
+
+	/** Normalized innovation squared, the sum of y^2/s, which is chi-square
+	 *  with M degrees of freedom when the filter is right. */
+	float nis;
 };
 
+/** @brief Fills in the bias columns of accelerometer rows.
+ *
+ *  @param yaw Heading of the sub in degrees.
+ *  @param H Rows mapping the state to inertial accelerations, as in Ha.
+ */
+void bias_rows(float yaw, float *H);
+
+/** @brief Predicts a state and its covariance forward.
+ *
+ *  X, VX, AX, Y, VY, AY, BU, BV. The model F is the identity but for the
+ *  chains X, VX, AX and Y, VY, AY, which each go [1 dt dt^2/2; 0 1 dt;
+ *  0 0 1]. Qk is per second, and only its diagonal is used.
+ *
+ *  @param state The state, predicted in place.
+ *  @param covar Its covariance as an upper triangle, predicted in place, or
+ *               NULL to predict only the state.
+ *  @param dt Time to predict forward in seconds.
+ */
+template <class T>
+void kalman_predict(T *state, T *covar, T dt)
+{
+	for (int k = 0; k < 6; k += 3)
+	{
+		state[k] += (state[k+1] + state[k+2]*dt/T(2))*dt;
+		state[k+1] += state[k+2]*dt;
+	}
+	if (!covar)
+		return;
+
+	// Each chain of F is a product of three shears, so F*P*F' is worked out
+	// in place by applying them in turn, the rightmost first: dt^2/2 of AX
+	// added to X, dt of VX to X, then dt of AX to VX. That only touches the
+	// rows of the chains, and needs neither F nor any temporaries.
+	SymRef<N, T> P(covar);
+	for (int k = 0; k < 6; k += 3)
+	{
+		shear(P, k, k+2, dt*dt/T(2));
+		shear(P, k, k+1, dt);
+		shear(P, k+1, k+2, dt);
+	}
+	for (int i = 0; i < N; i++)
+		P(i, i) += T(Qk[i*N+i])*dt;
+}
+
+/** @brief Corrects a state with a measurement of M values.
+ *
+ *  The measurement z is H times the state give or take R. The noise on each
+ *  value must be independent of the others, ie R diagonal, which lets them
+ *  be applied one at a time as scalars and leaves nothing to invert. Each is
+ *  applied in Joseph form, so the covariance stays positive definite in
+ *  float even when the measurement is far more precise than the state. All
+ *  the working space is sized by N at compile time and lives on the stack.
+ *
+ *  @param state The state, corrected in place.
+ *  @param covar Its covariance as an upper triangle, corrected in place.
+ *  @param H Rows mapping the state to the measurement, M by N.
+ *  @param R Variance of the measurement, M by M, of which only the diagonal
+ *           is used.
+ *  @param z The measurement.
+ *  @param y Where the innovation of each value is written, in the order
+ *           they are applied.
+ *  @param s Where the variance each innovation was expected to have is
+ *           written. A value whose s isn't positive is left out.
+ *  @return The normalized innovation squared, the sum of y^2/s.
+ */
+template <class T>
+T kalman_correct(T *state, T *covar, const T *H, const T *R, const T *z,
+		T *y, T *s)
+{
+	SymRef<N, T> P(covar);
+	T nis = T(0);
+	for (int m = 0; m < M; m++)
+	{
+		const T *h = &H[m*N];
+		T b[N], K[N], g[N];
+
+		// b = P*h' is what the covariance of the state has in common with
+		// the measurement, and s is the variance of the innovation y.
+		T r = R[m*M+m];
+		s[m] = r;
+		y[m] = z[m];
+		for (int i = 0; i < N; i++)
+			b[i] = T(0);
+		for (int j = 0; j < N; j++)
+		{
+			if (h[j] == T(0))
+				continue;
+			for (int i = 0; i < N; i++)
+				b[i] += P(i, j)*h[j];
+			y[m] -= h[j]*state[j];
+		}
+		for (int j = 0; j < N; j++)
+			s[m] += h[j]*b[j];
+		if (!(s[m] > T(0)))
+			continue;
+		nis += y[m]*y[m]/s[m];
+
+		// Update state using the measurement and Kalman gain.
+		T si = T(1)/s[m];
+		for (int i = 0; i < N; i++)
+		{
+			K[i] = b[i]*si;
+			state[i] += K[i]*y[m];
+		}
+
+		// Update error covariance in Joseph form, (I-K*h)*P*(I-K*h)' +
+		// K*r*K'. With W = (I-K*h)*P = P - K*b' and g = W*h' = b - K*(h*b),
+		// this is P - K*b' - g*K' + r*K*K'. Unlike P - K*b', rounding in K
+		// only shows up squared. It is symmetric, so only the upper
+		// triangle is worked out, which is all that is kept.
+		T hb = s[m] - r;
+		for (int i = 0; i < N; i++)
+			g[i] = b[i] - K[i]*hb;
+		for (int i = 0, n = 0; i < N; i++)
+			for (int j = i; j < N; j++, n++)
+				covar[n] = covar[n] - K[i]*b[j] - g[i]*K[j] + r*K[i]*K[j];
+	}
+	return nis;
+}
+
 /** @brief Struct to make using the Kalman filter easier.
  */
 struct Kalman
 {
-	//@{
-	/** Supposed to be used for accelerometer bias removal, unused for now. */
-	int skip, iter;
-	float m_orig[M];
-	float m_bias[M];
-	//@}
+	/** micros64() that the state has been predicted to. */
+	uint64_t time;
+
+	/** micros64() of the last DVL velocity that was used. */
+	uint64_t valid;
+
+	/** DVL samples left to weight less after a dropout. */
+	uint8_t blend;
+
+	/** Whether to use the gain tables once settled, from STEADY_GAINS. */
+	bool steady;
+
+	/** DVL samples used in a row by the full filter, up to STEADY_SETTLE. */
+	uint8_t settled;
+
+	/** DVL samples thrown out because the DVL flagged them as errors, and
+	 *  because they failed DVL_GATE, both wrapping. */
+	uint16_t dvl_errors, dvl_gated;
+
+	/** Called with the state as of time just before each prediction, if
+	 *  set. The replay tool keeps every step with it for smoothing. */
+	void (*trace)(const Kalman &k, const float *state, const float *covar);
+
+	/** The latest correction of each kind. */
+	Innovation innov[NUM_INNOV];
+
+	/** Kinds corrected since the caller last cleared it, bit per
+	 *  innov_kind. */
+	uint8_t updated;
 	
 	Kalman();
 
-	/** @brief Removes bias from accelerometer data.
+	/** @brief Forgets how long ago the state was predicted to.
+	 *
+	 *  Call when the filter starts running, so that the first prediction
+	 *  doesn't cover the time it was stopped. The DVL gets DROPOUT_TIME from
+	 *  then to start sending. The full filter runs until it has settled
+	 *  again.
+	 *
+	 *  @param t Current time in microseconds.
 	 */
-	void bias();
+	void restart(uint64_t t);
 
-	/** @brief Computes one iteration of the Kalman filter.
+	/** @brief Predicts the state forward to a time.
+	 *
+	 *  Does nothing if the state is already at or past that time.
+	 *
+	 *  @param state The current state of the sub using the Kalman state model.
+	 *  @param covar The current error of the state.
+	 *  @param t Time to predict to in microseconds.
+	 */
+	void predict(float *state, float *covar, uint64_t t);
+
+	/** @brief Corrects the accelerations with the newest AHRS sample.
+	 *
+	 *  Should be called once for every new AHRS sample, after predicting to
+	 *  the time it arrived.
 	 *
 	 *  @param state The current state of the sub using the Kalman state model.
 	 *  @param covar The current error of the state.
 	 *  @param angles The current euler angles of the sub.
-	 *  @param t The current time of system, used to compute time differences.
-	 *  @return The end time of the system.
 	 */
-	uint32_t compute(float *state, float *covar, float *angles, uint32_t t);
+	void accel(float *state, float *covar, float *angles);
+
+	/** @brief Corrects the velocities with the newest DVL sample.
+	 *
+	 *  Should be called once for every new DVL sample, after predicting to
+	 *  the time it arrived. Does nothing if the DVL returned an error or
+	 *  the sample fails DVL_GATE.
+	 *
+	 *  @param state The current state of the sub using the Kalman state model.
+	 *  @param covar The current error of the state.
+	 *  @param angles The euler angles of the sub when the velocity was true.
+	 *  @param lag How long before the state's time the velocity was true, in
+	 *             seconds.
+	 *
+	 *  @return True if the velocity was used.
+	 */
+	bool velocity(float *state, float *covar, float *angles, float lag);
+
+	/** @brief Finds whether the DVL has dropped out.
+	 *
+	 *  @return True if no DVL velocity has been used for DROPOUT_TIME before
+	 *          the state's time.
+	 */
+	bool dropout() const;
+
+	/** @brief Corrects the accelerations with the motion model.
+	 *
+	 *  Should be called with every AHRS sample while the DVL has dropped out,
+	 *  after predicting to the time it arrived.
+	 *
+	 *  @param state The current state of the sub using the Kalman state model.
+	 *  @param covar The current error of the state.
+	 *  @param forces The inertial forces the motors are commanded to push
+	 *                with, as in Motors::forces.
+	 *  @param angles The current euler angles of the sub.
+	 *  @param yaw_rate How fast the heading is turning in degrees per second.
+	 */
+	void model(float *state, float *covar, const float *forces, float *angles,
+			float yaw_rate);
+
+	/** @brief Finds whether the gain tables are in use.
+	 *
+	 *  @return True if the covariance isn't being worked out, in which case
+	 *          only the variance of X and Y in it is up to date.
+	 */
+	bool fast() const;
+
+private:
+	void unsettle(float *covar, float yaw);
 };
 
 #endif 
@@ -0,0 +1,788 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file kalman_gains.h
+ *  @brief Steady state gains of the Kalman filter, from tuning/gains.py.
+ *
+ *  Generated, so rerun the tool rather than editing by hand. Worked out with
+ *  the sub facing north, for the AHRS at 30 Hz and the DVL at 8 Hz. Each
+ *  table has a row for every 16667 us since the last DVL correction, up to the
+ *  dropout. See STEADY_GAINS.
+ */
+#ifndef KALMAN_GAINS_H
+#define KALMAN_GAINS_H
+
+#include <Arduino.h>
+
+/** Number of rows in each table, and microseconds of time since the last DVL
+ *  correction each covers. */
+#define STEADY_BINS 30
+#define STEADY_BIN 16667UL
+
+/** Rate the variance of X and of Y grows at, in m^2/s. */
+#define STEADY_POSITION_RATE 1.317993e-03
+
+/** Gains of the accelerometer correction, N by M, then the covariance of its
+ *  innovations, M by M. */
+static const float STEADY_ACCEL[STEADY_BINS][N*M + M*M] PROGMEM = {
+	{
+		1.219239e-03, 0.000000e+00,
+		2.132759e-02, 0.000000e+00,
+		2.490761e-01, 0.000000e+00,
+		0.000000e+00, 1.219239e-03,
+		0.000000e+00, 2.132759e-02,
+		0.000000e+00, 2.490761e-01,
+		1.073532e-04, 0.000000e+00,
+		0.000000e+00, 1.073532e-04,
+		2.663767e-01, 0.000000e+00,
+		0.000000e+00, 2.663767e-01
+	},
+	{
+		1.389744e-03, 0.000000e+00,
+		2.189218e-02, 0.000000e+00,
+		2.492806e-01, 0.000000e+00,
+		0.000000e+00, 1.389744e-03,
+		0.000000e+00, 2.189218e-02,
+		0.000000e+00, 2.492806e-01,
+		9.434365e-05, 0.000000e+00,
+		0.000000e+00, 9.434365e-05,
+		2.664446e-01, 0.000000e+00,
+		0.000000e+00, 2.664446e-01
+	},
+	{
+		1.552347e-03, 0.000000e+00,
+		2.223617e-02, 0.000000e+00,
+		2.494595e-01, 0.000000e+00,
+		0.000000e+00, 1.552347e-03,
+		0.000000e+00, 2.223617e-02,
+		0.000000e+00, 2.494595e-01,
+		8.181503e-05, 0.000000e+00,
+		0.000000e+00, 8.181503e-05,
+		2.665037e-01, 0.000000e+00,
+		0.000000e+00, 2.665037e-01
+	},
+	{
+		1.694270e-03, 0.000000e+00,
+		2.266175e-02, 0.000000e+00,
+		2.495771e-01, 0.000000e+00,
+		0.000000e+00, 1.694270e-03,
+		0.000000e+00, 2.266175e-02,
+		0.000000e+00, 2.495771e-01,
+		7.204152e-05, 0.000000e+00,
+		0.000000e+00, 7.204152e-05,
+		2.665420e-01, 0.000000e+00,
+		0.000000e+00, 2.665420e-01
+	},
+	{
+		1.824730e-03, 0.000000e+00,
+		2.292147e-02, 0.000000e+00,
+		2.496802e-01, 0.000000e+00,
+		0.000000e+00, 1.824730e-03,
+		0.000000e+00, 2.292147e-02,
+		0.000000e+00, 2.496802e-01,
+		6.263281e-05, 0.000000e+00,
+		0.000000e+00, 6.263281e-05,
+		2.665753e-01, 0.000000e+00,
+		0.000000e+00, 2.665753e-01
+	},
+	{
+		1.941745e-03, 0.000000e+00,
+		2.324183e-02, 0.000000e+00,
+		2.497483e-01, 0.000000e+00,
+		0.000000e+00, 1.941745e-03,
+		0.000000e+00, 2.324183e-02,
+		0.000000e+00, 2.497483e-01,
+		5.529567e-05, 0.000000e+00,
+		0.000000e+00, 5.529567e-05,
+		2.665968e-01, 0.000000e+00,
+		0.000000e+00, 2.665968e-01
+	},
+	{
+		2.046009e-03, 0.000000e+00,
+		2.343760e-02, 0.000000e+00,
+		2.498080e-01, 0.000000e+00,
+		0.000000e+00, 2.046009e-03,
+		0.000000e+00, 2.343760e-02,
+		0.000000e+00, 2.498080e-01,
+		4.823387e-05, 0.000000e+00,
+		0.000000e+00, 4.823387e-05,
+		2.666156e-01, 0.000000e+00,
+		0.000000e+00, 2.666156e-01
+	},
+	{
+		2.136005e-03, 0.000000e+00,
+		2.375372e-02, 0.000000e+00,
+		2.498445e-01, 0.000000e+00,
+		0.000000e+00, 2.136005e-03,
+		0.000000e+00, 2.375372e-02,
+		0.000000e+00, 2.498445e-01,
+		4.317603e-05, 0.000000e+00,
+		0.000000e+00, 4.317603e-05,
+		2.666267e-01, 0.000000e+00,
+		0.000000e+00, 2.666267e-01
+	},
+	{
+		2.228795e-03, 0.000000e+00,
+		2.430401e-02, 0.000000e+00,
+		2.498826e-01, 0.000000e+00,
+		0.000000e+00, 2.228795e-03,
+		0.000000e+00, 2.430401e-02,
+		0.000000e+00, 2.498826e-01,
+		3.742941e-05, 0.000000e+00,
+		0.000000e+00, 3.742941e-05,
+		2.666383e-01, 0.000000e+00,
+		0.000000e+00, 2.666383e-01
+	},
+	{
+		2.307087e-03, 0.000000e+00,
+		2.419625e-02, 0.000000e+00,
+		2.499060e-01, 0.000000e+00,
+		0.000000e+00, 2.307087e-03,
+		0.000000e+00, 2.419625e-02,
+		0.000000e+00, 2.499060e-01,
+		3.329871e-05, 0.000000e+00,
+		0.000000e+00, 3.329871e-05,
+		2.666451e-01, 0.000000e+00,
+		0.000000e+00, 2.666451e-01
+	},
+	{
+		2.383454e-03, 0.000000e+00,
+		2.447651e-02, 0.000000e+00,
+		2.499267e-01, 0.000000e+00,
+		0.000000e+00, 2.383454e-03,
+		0.000000e+00, 2.447651e-02,
+		0.000000e+00, 2.499267e-01,
+		2.932378e-05, 0.000000e+00,
+		0.000000e+00, 2.932378e-05,
+		2.666510e-01, 0.000000e+00,
+		0.000000e+00, 2.666510e-01
+	},
+	{
+		2.439457e-03, 0.000000e+00,
+		2.439592e-02, 0.000000e+00,
+		2.499406e-01, 0.000000e+00,
+		0.000000e+00, 2.439457e-03,
+		0.000000e+00, 2.439592e-02,
+		0.000000e+00, 2.499406e-01,
+		2.622520e-05, 0.000000e+00,
+		0.000000e+00, 2.622520e-05,
+		2.666549e-01, 0.000000e+00,
+		0.000000e+00, 2.666549e-01
+	},
+	{
+		2.503719e-03, 0.000000e+00,
+		2.460633e-02, 0.000000e+00,
+		2.499529e-01, 0.000000e+00,
+		0.000000e+00, 2.503719e-03,
+		0.000000e+00, 2.460633e-02,
+		0.000000e+00, 2.499529e-01,
+		2.324358e-05, 0.000000e+00,
+		0.000000e+00, 2.324358e-05,
+		2.666582e-01, 0.000000e+00,
+		0.000000e+00, 2.666582e-01
+	},
+	{
+		2.543693e-03, 0.000000e+00,
+		2.454603e-02, 0.000000e+00,
+		2.499613e-01, 0.000000e+00,
+		0.000000e+00, 2.543693e-03,
+		0.000000e+00, 2.454603e-02,
+		0.000000e+00, 2.499613e-01,
+		2.091940e-05, 0.000000e+00,
+		0.000000e+00, 2.091940e-05,
+		2.666604e-01, 0.000000e+00,
+		0.000000e+00, 2.666604e-01
+	},
+	{
+		2.597138e-03, 0.000000e+00,
+		2.470398e-02, 0.000000e+00,
+		2.499689e-01, 0.000000e+00,
+		0.000000e+00, 2.597138e-03,
+		0.000000e+00, 2.470398e-02,
+		0.000000e+00, 2.499689e-01,
+		1.868299e-05, 0.000000e+00,
+		0.000000e+00, 1.868299e-05,
+		2.666622e-01, 0.000000e+00,
+		0.000000e+00, 2.666622e-01
+	},
+	{
+		2.627463e-03, 0.000000e+00,
+		2.501319e-02, 0.000000e+00,
+		2.499740e-01, 0.000000e+00,
+		0.000000e+00, 2.627463e-03,
+		0.000000e+00, 2.501319e-02,
+		0.000000e+00, 2.499740e-01,
+		1.693975e-05, 0.000000e+00,
+		0.000000e+00, 1.693975e-05,
+		2.666635e-01, 0.000000e+00,
+		0.000000e+00, 2.666635e-01
+	},
+	{
+		2.673565e-03, 0.000000e+00,
+		2.511872e-02, 0.000000e+00,
+		2.499787e-01, 0.000000e+00,
+		0.000000e+00, 2.673565e-03,
+		0.000000e+00, 2.511872e-02,
+		0.000000e+00, 2.499787e-01,
+		1.526237e-05, 0.000000e+00,
+		0.000000e+00, 1.526237e-05,
+		2.666645e-01, 0.000000e+00,
+		0.000000e+00, 2.666645e-01
+	},
+	{
+		2.700098e-03, 0.000000e+00,
+		2.500938e-02, 0.000000e+00,
+		2.499819e-01, 0.000000e+00,
+		0.000000e+00, 2.700098e-03,
+		0.000000e+00, 2.500938e-02,
+		0.000000e+00, 2.499819e-01,
+		1.395489e-05, 0.000000e+00,
+		0.000000e+00, 1.395489e-05,
+		2.666652e-01, 0.000000e+00,
+		0.000000e+00, 2.666652e-01
+	},
+	{
+		2.737309e-03, 0.000000e+00,
+		2.508859e-02, 0.000000e+00,
+		2.499848e-01, 0.000000e+00,
+		0.000000e+00, 2.737309e-03,
+		0.000000e+00, 2.508859e-02,
+		0.000000e+00, 2.499848e-01,
+		1.269682e-05, 0.000000e+00,
+		0.000000e+00, 1.269682e-05,
+		2.666658e-01, 0.000000e+00,
+		0.000000e+00, 2.666658e-01
+	},
+	{
+		2.754472e-03, 0.000000e+00,
+		2.500663e-02, 0.000000e+00,
+		2.499869e-01, 0.000000e+00,
+		0.000000e+00, 2.754472e-03,
+		0.000000e+00, 2.500663e-02,
+		0.000000e+00, 2.499869e-01,
+		1.171619e-05, 0.000000e+00,
+		0.000000e+00, 1.171619e-05,
+		2.666662e-01, 0.000000e+00,
+		0.000000e+00, 2.666662e-01
+	},
+	{
+		2.784358e-03, 0.000000e+00,
+		2.506608e-02, 0.000000e+00,
+		2.499888e-01, 0.000000e+00,
+		0.000000e+00, 2.784358e-03,
+		0.000000e+00, 2.506608e-02,
+		0.000000e+00, 2.499888e-01,
+		1.077262e-05, 0.000000e+00,
+		0.000000e+00, 1.077262e-05,
+		2.666665e-01, 0.000000e+00,
+		0.000000e+00, 2.666665e-01
+	},
+	{
+		2.795181e-03, 0.000000e+00,
+		2.500464e-02, 0.000000e+00,
+		2.499901e-01, 0.000000e+00,
+		0.000000e+00, 2.795181e-03,
+		0.000000e+00, 2.500464e-02,
+		0.000000e+00, 2.499901e-01,
+		1.003714e-05, 0.000000e+00,
+		0.000000e+00, 1.003714e-05,
+		2.666667e-01, 0.000000e+00,
+		0.000000e+00, 2.666667e-01
+	},
+	{
+		2.819391e-03, 0.000000e+00,
+		2.516294e-02, 0.000000e+00,
+		2.499914e-01, 0.000000e+00,
+		0.000000e+00, 2.819391e-03,
+		0.000000e+00, 2.516294e-02,
+		0.000000e+00, 2.499914e-01,
+		9.329457e-06, 0.000000e+00,
+		0.000000e+00, 9.329457e-06,
+		2.666669e-01, 0.000000e+00,
+		0.000000e+00, 2.666669e-01
+	},
+	{
+		2.829685e-03, 0.000000e+00,
+		2.548123e-02, 0.000000e+00,
+		2.499922e-01, 0.000000e+00,
+		0.000000e+00, 2.829685e-03,
+		0.000000e+00, 2.548123e-02,
+		0.000000e+00, 2.499922e-01,
+		8.777844e-06, 0.000000e+00,
+		0.000000e+00, 8.777844e-06,
+		2.666670e-01, 0.000000e+00,
+		0.000000e+00, 2.666670e-01
+	},
+	{
+		2.849237e-03, 0.000000e+00,
+		2.522587e-02, 0.000000e+00,
+		2.499931e-01, 0.000000e+00,
+		0.000000e+00, 2.849237e-03,
+		0.000000e+00, 2.522587e-02,
+		0.000000e+00, 2.499931e-01,
+		8.247078e-06, 0.000000e+00,
+		0.000000e+00, 8.247078e-06,
+		2.666671e-01, 0.000000e+00,
+		0.000000e+00, 2.666671e-01
+	},
+	{
+		2.863452e-03, 0.000000e+00,
+		2.536067e-02, 0.000000e+00,
+		2.499937e-01, 0.000000e+00,
+		0.000000e+00, 2.863452e-03,
+		0.000000e+00, 2.536067e-02,
+		0.000000e+00, 2.499937e-01,
+		7.833367e-06, 0.000000e+00,
+		0.000000e+00, 7.833367e-06,
+		2.666672e-01, 0.000000e+00,
+		0.000000e+00, 2.666672e-01
+	},
+	{
+		2.871732e-03, 0.000000e+00,
+		2.516917e-02, 0.000000e+00,
+		2.499942e-01, 0.000000e+00,
+		0.000000e+00, 2.871732e-03,
+		0.000000e+00, 2.516917e-02,
+		0.000000e+00, 2.499942e-01,
+		7.435292e-06, 0.000000e+00,
+		0.000000e+00, 7.435292e-06,
+		2.666673e-01, 0.000000e+00,
+		0.000000e+00, 2.666673e-01
+	},
+	{
+		2.885763e-03, 0.000000e+00,
+		2.527029e-02, 0.000000e+00,
+		2.499947e-01, 0.000000e+00,
+		0.000000e+00, 2.885763e-03,
+		0.000000e+00, 2.527029e-02,
+		0.000000e+00, 2.499947e-01,
+		7.125008e-06, 0.000000e+00,
+		0.000000e+00, 7.125008e-06,
+		2.666673e-01, 0.000000e+00,
+		0.000000e+00, 2.666673e-01
+	},
+	{
+		2.887185e-03, 0.000000e+00,
+		2.512667e-02, 0.000000e+00,
+		2.499951e-01, 0.000000e+00,
+		0.000000e+00, 2.887185e-03,
+		0.000000e+00, 2.512667e-02,
+		0.000000e+00, 2.499951e-01,
+		6.826452e-06, 0.000000e+00,
+		0.000000e+00, 6.826452e-06,
+		2.666673e-01, 0.000000e+00,
+		0.000000e+00, 2.666673e-01
+	},
+	{
+		2.900236e-03, 0.000000e+00,
+		2.520252e-02, 0.000000e+00,
+		2.499953e-01, 0.000000e+00,
+		0.000000e+00, 2.900236e-03,
+		0.000000e+00, 2.520252e-02,
+		0.000000e+00, 2.499953e-01,
+		6.593739e-06, 0.000000e+00,
+		0.000000e+00, 6.593739e-06,
+		2.666674e-01, 0.000000e+00,
+		0.000000e+00, 2.666674e-01
+	}
+};
+
+/** Gains and innovation covariance of the DVL correction. */
+static const float STEADY_DVL[STEADY_BINS][N*M + M*M] PROGMEM = {
+	{
+		1.254737e-01, 0.000000e+00,
+		3.663291e-01, 0.000000e+00,
+		1.293105e-01, 0.000000e+00,
+		0.000000e+00, 1.254737e-01,
+		0.000000e+00, 3.663291e-01,
+		0.000000e+00, 1.293105e-01,
+		-8.976175e-03, 0.000000e+00,
+		0.000000e+00, -8.976175e-03,
+		1.558233e-02, 0.000000e+00,
+		0.000000e+00, 1.558233e-02
+	},
+	{
+		1.254737e-01, 0.000000e+00,
+		3.663291e-01, 0.000000e+00,
+		1.293105e-01, 0.000000e+00,
+		0.000000e+00, 1.254737e-01,
+		0.000000e+00, 3.663291e-01,
+		0.000000e+00, 1.293105e-01,
+		-8.976175e-03, 0.000000e+00,
+		0.000000e+00, -8.976175e-03,
+		1.558233e-02, 0.000000e+00,
+		0.000000e+00, 1.558233e-02
+	},
+	{
+		1.254737e-01, 0.000000e+00,
+		3.663291e-01, 0.000000e+00,
+		1.293105e-01, 0.000000e+00,
+		0.000000e+00, 1.254737e-01,
+		0.000000e+00, 3.663291e-01,
+		0.000000e+00, 1.293105e-01,
+		-8.976175e-03, 0.000000e+00,
+		0.000000e+00, -8.976175e-03,
+		1.558233e-02, 0.000000e+00,
+		0.000000e+00, 1.558233e-02
+	},
+	{
+		1.254737e-01, 0.000000e+00,
+		3.663291e-01, 0.000000e+00,
+		1.293105e-01, 0.000000e+00,
+		0.000000e+00, 1.254737e-01,
+		0.000000e+00, 3.663291e-01,
+		0.000000e+00, 1.293105e-01,
+		-8.976175e-03, 0.000000e+00,
+		0.000000e+00, -8.976175e-03,
+		1.558233e-02, 0.000000e+00,
+		0.000000e+00, 1.558233e-02
+	},
+	{
+		1.254737e-01, 0.000000e+00,
+		3.663291e-01, 0.000000e+00,
+		1.293105e-01, 0.000000e+00,
+		0.000000e+00, 1.254737e-01,
+		0.000000e+00, 3.663291e-01,
+		0.000000e+00, 1.293105e-01,
+		-8.976175e-03, 0.000000e+00,
+		0.000000e+00, -8.976175e-03,
+		1.558233e-02, 0.000000e+00,
+		0.000000e+00, 1.558233e-02
+	},
+	{
+		1.254737e-01, 0.000000e+00,
+		3.663291e-01, 0.000000e+00,
+		1.293105e-01, 0.000000e+00,
+		0.000000e+00, 1.254737e-01,
+		0.000000e+00, 3.663291e-01,
+		0.000000e+00, 1.293105e-01,
+		-8.976175e-03, 0.000000e+00,
+		0.000000e+00, -8.976175e-03,
+		1.558233e-02, 0.000000e+00,
+		0.000000e+00, 1.558233e-02
+	},
+	{
+		1.254737e-01, 0.000000e+00,
+		3.663291e-01, 0.000000e+00,
+		1.293105e-01, 0.000000e+00,
+		0.000000e+00, 1.254737e-01,
+		0.000000e+00, 3.663291e-01,
+		0.000000e+00, 1.293105e-01,
+		-8.976175e-03, 0.000000e+00,
+		0.000000e+00, -8.976175e-03,
+		1.558233e-02, 0.000000e+00,
+		0.000000e+00, 1.558233e-02
+	},
+	{
+		1.254737e-01, 0.000000e+00,
+		3.663291e-01, 0.000000e+00,
+		1.293105e-01, 0.000000e+00,
+		0.000000e+00, 1.254737e-01,
+		0.000000e+00, 3.663291e-01,
+		0.000000e+00, 1.293105e-01,
+		-8.976175e-03, 0.000000e+00,
+		0.000000e+00, -8.976175e-03,
+		1.558233e-02, 0.000000e+00,
+		0.000000e+00, 1.558233e-02
+	},
+	{
+		1.305144e-01, 0.000000e+00,
+		3.758181e-01, 0.000000e+00,
+		1.294162e-01, 0.000000e+00,
+		0.000000e+00, 1.305144e-01,
+		0.000000e+00, 3.758181e-01,
+		0.000000e+00, 1.294162e-01,
+		-9.206446e-03, 0.000000e+00,
+		0.000000e+00, -9.206446e-03,
+		1.584343e-02, 0.000000e+00,
+		0.000000e+00, 1.584343e-02
+	},
+	{
+		1.355550e-01, 0.000000e+00,
+		3.853071e-01, 0.000000e+00,
+		1.295218e-01, 0.000000e+00,
+		0.000000e+00, 1.355550e-01,
+		0.000000e+00, 3.853071e-01,
+		0.000000e+00, 1.295218e-01,
+		-9.436717e-03, 0.000000e+00,
+		0.000000e+00, -9.436717e-03,
+		1.610454e-02, 0.000000e+00,
+		0.000000e+00, 1.610454e-02
+	},
+	{
+		1.405957e-01, 0.000000e+00,
+		3.947961e-01, 0.000000e+00,
+		1.296275e-01, 0.000000e+00,
+		0.000000e+00, 1.405957e-01,
+		0.000000e+00, 3.947961e-01,
+		0.000000e+00, 1.296275e-01,
+		-9.666988e-03, 0.000000e+00,
+		0.000000e+00, -9.666988e-03,
+		1.636564e-02, 0.000000e+00,
+		0.000000e+00, 1.636564e-02
+	},
+	{
+		1.456363e-01, 0.000000e+00,
+		4.042851e-01, 0.000000e+00,
+		1.297331e-01, 0.000000e+00,
+		0.000000e+00, 1.456363e-01,
+		0.000000e+00, 4.042851e-01,
+		0.000000e+00, 1.297331e-01,
+		-9.897259e-03, 0.000000e+00,
+		0.000000e+00, -9.897259e-03,
+		1.662675e-02, 0.000000e+00,
+		0.000000e+00, 1.662675e-02
+	},
+	{
+		1.506770e-01, 0.000000e+00,
+		4.137741e-01, 0.000000e+00,
+		1.298388e-01, 0.000000e+00,
+		0.000000e+00, 1.506770e-01,
+		0.000000e+00, 4.137741e-01,
+		0.000000e+00, 1.298388e-01,
+		-1.012753e-02, 0.000000e+00,
+		0.000000e+00, -1.012753e-02,
+		1.688785e-02, 0.000000e+00,
+		0.000000e+00, 1.688785e-02
+	},
+	{
+		1.557176e-01, 0.000000e+00,
+		4.232631e-01, 0.000000e+00,
+		1.299444e-01, 0.000000e+00,
+		0.000000e+00, 1.557176e-01,
+		0.000000e+00, 4.232631e-01,
+		0.000000e+00, 1.299444e-01,
+		-1.035780e-02, 0.000000e+00,
+		0.000000e+00, -1.035780e-02,
+		1.714896e-02, 0.000000e+00,
+		0.000000e+00, 1.714896e-02
+	},
+	{
+		1.607583e-01, 0.000000e+00,
+		4.327521e-01, 0.000000e+00,
+		1.300501e-01, 0.000000e+00,
+		0.000000e+00, 1.607583e-01,
+		0.000000e+00, 4.327521e-01,
+		0.000000e+00, 1.300501e-01,
+		-1.058807e-02, 0.000000e+00,
+		0.000000e+00, -1.058807e-02,
+		1.741006e-02, 0.000000e+00,
+		0.000000e+00, 1.741006e-02
+	},
+	{
+		1.657989e-01, 0.000000e+00,
+		4.422411e-01, 0.000000e+00,
+		1.301557e-01, 0.000000e+00,
+		0.000000e+00, 1.657989e-01,
+		0.000000e+00, 4.422411e-01,
+		0.000000e+00, 1.301557e-01,
+		-1.081834e-02, 0.000000e+00,
+		0.000000e+00, -1.081834e-02,
+		1.767117e-02, 0.000000e+00,
+		0.000000e+00, 1.767117e-02
+	},
+	{
+		1.722613e-01, 0.000000e+00,
+		4.508590e-01, 0.000000e+00,
+		1.291112e-01, 0.000000e+00,
+		0.000000e+00, 1.722613e-01,
+		0.000000e+00, 4.508590e-01,
+		0.000000e+00, 1.291112e-01,
+		-1.102596e-02, 0.000000e+00,
+		0.000000e+00, -1.102596e-02,
+		1.797495e-02, 0.000000e+00,
+		0.000000e+00, 1.797495e-02
+	},
+	{
+		1.787237e-01, 0.000000e+00,
+		4.594769e-01, 0.000000e+00,
+		1.280667e-01, 0.000000e+00,
+		0.000000e+00, 1.787237e-01,
+		0.000000e+00, 4.594769e-01,
+		0.000000e+00, 1.280667e-01,
+		-1.123358e-02, 0.000000e+00,
+		0.000000e+00, -1.123358e-02,
+		1.827873e-02, 0.000000e+00,
+		0.000000e+00, 1.827873e-02
+	},
+	{
+		1.851861e-01, 0.000000e+00,
+		4.680948e-01, 0.000000e+00,
+		1.270221e-01, 0.000000e+00,
+		0.000000e+00, 1.851861e-01,
+		0.000000e+00, 4.680948e-01,
+		0.000000e+00, 1.270221e-01,
+		-1.144120e-02, 0.000000e+00,
+		0.000000e+00, -1.144120e-02,
+		1.858251e-02, 0.000000e+00,
+		0.000000e+00, 1.858251e-02
+	},
+	{
+		1.916484e-01, 0.000000e+00,
+		4.767127e-01, 0.000000e+00,
+		1.259776e-01, 0.000000e+00,
+		0.000000e+00, 1.916484e-01,
+		0.000000e+00, 4.767127e-01,
+		0.000000e+00, 1.259776e-01,
+		-1.164881e-02, 0.000000e+00,
+		0.000000e+00, -1.164881e-02,
+		1.888629e-02, 0.000000e+00,
+		0.000000e+00, 1.888629e-02
+	},
+	{
+		1.981108e-01, 0.000000e+00,
+		4.853306e-01, 0.000000e+00,
+		1.249331e-01, 0.000000e+00,
+		0.000000e+00, 1.981108e-01,
+		0.000000e+00, 4.853306e-01,
+		0.000000e+00, 1.249331e-01,
+		-1.185643e-02, 0.000000e+00,
+		0.000000e+00, -1.185643e-02,
+		1.919006e-02, 0.000000e+00,
+		0.000000e+00, 1.919006e-02
+	},
+	{
+		2.045732e-01, 0.000000e+00,
+		4.939485e-01, 0.000000e+00,
+		1.238885e-01, 0.000000e+00,
+		0.000000e+00, 2.045732e-01,
+		0.000000e+00, 4.939485e-01,
+		0.000000e+00, 1.238885e-01,
+		-1.206405e-02, 0.000000e+00,
+		0.000000e+00, -1.206405e-02,
+		1.949384e-02, 0.000000e+00,
+		0.000000e+00, 1.949384e-02
+	},
+	{
+		2.110356e-01, 0.000000e+00,
+		5.025665e-01, 0.000000e+00,
+		1.228440e-01, 0.000000e+00,
+		0.000000e+00, 2.110356e-01,
+		0.000000e+00, 5.025665e-01,
+		0.000000e+00, 1.228440e-01,
+		-1.227167e-02, 0.000000e+00,
+		0.000000e+00, -1.227167e-02,
+		1.979762e-02, 0.000000e+00,
+		0.000000e+00, 1.979762e-02
+	},
+	{
+		2.110356e-01, 0.000000e+00,
+		5.025665e-01, 0.000000e+00,
+		1.228440e-01, 0.000000e+00,
+		0.000000e+00, 2.110356e-01,
+		0.000000e+00, 5.025665e-01,
+		0.000000e+00, 1.228440e-01,
+		-1.227167e-02, 0.000000e+00,
+		0.000000e+00, -1.227167e-02,
+		1.979762e-02, 0.000000e+00,
+		0.000000e+00, 1.979762e-02
+	},
+	{
+		2.110356e-01, 0.000000e+00,
+		5.025665e-01, 0.000000e+00,
+		1.228440e-01, 0.000000e+00,
+		0.000000e+00, 2.110356e-01,
+		0.000000e+00, 5.025665e-01,
+		0.000000e+00, 1.228440e-01,
+		-1.227167e-02, 0.000000e+00,
+		0.000000e+00, -1.227167e-02,
+		1.979762e-02, 0.000000e+00,
+		0.000000e+00, 1.979762e-02
+	},
+	{
+		2.110356e-01, 0.000000e+00,
+		5.025665e-01, 0.000000e+00,
+		1.228440e-01, 0.000000e+00,
+		0.000000e+00, 2.110356e-01,
+		0.000000e+00, 5.025665e-01,
+		0.000000e+00, 1.228440e-01,
+		-1.227167e-02, 0.000000e+00,
+		0.000000e+00, -1.227167e-02,
+		1.979762e-02, 0.000000e+00,
+		0.000000e+00, 1.979762e-02
+	},
+	{
+		2.110356e-01, 0.000000e+00,
+		5.025665e-01, 0.000000e+00,
+		1.228440e-01, 0.000000e+00,
+		0.000000e+00, 2.110356e-01,
+		0.000000e+00, 5.025665e-01,
+		0.000000e+00, 1.228440e-01,
+		-1.227167e-02, 0.000000e+00,
+		0.000000e+00, -1.227167e-02,
+		1.979762e-02, 0.000000e+00,
+		0.000000e+00, 1.979762e-02
+	},
+	{
+		2.110356e-01, 0.000000e+00,
+		5.025665e-01, 0.000000e+00,
+		1.228440e-01, 0.000000e+00,
+		0.000000e+00, 2.110356e-01,
+		0.000000e+00, 5.025665e-01,
+		0.000000e+00, 1.228440e-01,
+		-1.227167e-02, 0.000000e+00,
+		0.000000e+00, -1.227167e-02,
+		1.979762e-02, 0.000000e+00,
+		0.000000e+00, 1.979762e-02
+	},
+	{
+		2.110356e-01, 0.000000e+00,
+		5.025665e-01, 0.000000e+00,
+		1.228440e-01, 0.000000e+00,
+		0.000000e+00, 2.110356e-01,
+		0.000000e+00, 5.025665e-01,
+		0.000000e+00, 1.228440e-01,
+		-1.227167e-02, 0.000000e+00,
+		0.000000e+00, -1.227167e-02,
+		1.979762e-02, 0.000000e+00,
+		0.000000e+00, 1.979762e-02
+	},
+	{
+		2.110356e-01, 0.000000e+00,
+		5.025665e-01, 0.000000e+00,
+		1.228440e-01, 0.000000e+00,
+		0.000000e+00, 2.110356e-01,
+		0.000000e+00, 5.025665e-01,
+		0.000000e+00, 1.228440e-01,
+		-1.227167e-02, 0.000000e+00,
+		0.000000e+00, -1.227167e-02,
+		1.979762e-02, 0.000000e+00,
+		0.000000e+00, 1.979762e-02
+	}
+};
+
+/** Covariance of the state at the dropout, for the full filter to start
+ *  from, as its upper triangle by rows. */
+static const float STEADY_DROPOUT[N*(N+1)/2] PROGMEM = {
+	1.168752e+00, 5.797567e-03, 1.554578e-03, 0.000000e+00, 0.000000e+00, 0.000000e+00, -8.839795e-04, 0.000000e+00,
+	1.248834e-02, 6.176843e-03, 0.000000e+00, 0.000000e+00, 0.000000e+00, -3.210232e-04, 0.000000e+00,
+	5.864481e-02, 0.000000e+00, 0.000000e+00, 0.000000e+00, -4.165992e-04, 0.000000e+00,
+	1.168752e+00, 5.797567e-03, 1.554578e-03, 0.000000e+00, -8.839795e-04,
+	1.248834e-02, 6.176843e-03, 0.000000e+00, -3.210232e-04,
+	5.864481e-02, 0.000000e+00, -4.165992e-04,
+	4.181058e-04, 0.000000e+00,
+	4.181058e-04
+};
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file link.hpp
+ *  @brief Topside serial link in either console or binary mode.
+ *
+ *  The link starts in console mode at 9600 baud, where commands are typed as
+ *  text (see command.hpp). The 'b' command switches the baud rate and mode.
+ *  In binary mode every command and reply is a frame from protocol.hpp.
+ *  Either way commands come out of poll() as the same Command struct, so the
+ *  code that runs them doesn't care which mode is in use.
+ */
+#ifndef LINK_HPP
+#define LINK_HPP
+
+#include <Arduino.h>
+#include "command.hpp"
+#include "protocol.hpp"
+
+/** Baud rate the link starts at.
+ */
+#define LINK_BAUD 9600UL
+
+/** Milliseconds a new baud rate and mode are given to receive a valid command
+ *  before the link goes back to the old ones.
+ */
+#define LINK_FALLBACK_MS 3000UL
+
+/** Size of the queue of binary frames waiting for room in the transmit
+ *  buffer.
+ */
+#define LINK_QUEUE 256
+
+/** @brief Topside serial link.
+ */
+struct Link
+{
+	/** Serial port used. */
+	HardwareSerial *port;
+
+	/** True in binary mode. */
+	bool binary;
+
+	/** Console mode command lexer. */
+	CommandLexer lexer;
+
+	/** Binary mode frame decoder. */
+	ProtoDecoder decoder;
+
+	/** Sequence number of the request being answered. */
+	uint8_t seq;
+
+	/** Sequence number of the next message sent unprompted. */
+	uint8_t push_seq;
+
+	/** Binary frames that decoded but were not valid commands. */
+	uint16_t rejected;
+
+	/** Frames waiting to go out, as a ring buffer of encoded bytes. */
+	uint8_t queue[LINK_QUEUE];
+	uint16_t head, tail, queued;
+
+	/** Frames thrown away because the queue was full. */
+	uint16_t unsent;
+
+	/** Baud rate in use. */
+	uint32_t baud;
+
+	/** Baud rate to switch to once everything sent at the old one has gone
+	 *  out, or 0 if no switch is waiting. */
+	uint32_t next_baud;
+
+	/** Times the baud rate and mode have been changed, so output formatted
+	 *  before a change can be told apart. */
+	uint8_t modes;
+
+	/** True until something valid has come in since the last set_mode().
+	 *  The old baud rate and mode are kept to go back to. */
+	bool trial;
+	uint32_t trial_start;
+	uint32_t old_baud;
+	bool old_binary;
+
+	Link(HardwareSerial &port);
+
+	/** @brief Starts the port in console mode at LINK_BAUD.
+	 */
+	void begin();
+
+	/** @brief Reads pending input until a complete command is found.
+	 *
+	 *  Never blocks. Call until it returns false to drain the port. Goes back
+	 *  to the old baud rate and mode if nothing valid has come in for
+	 *  LINK_FALLBACK_MS since the switch of set_mode(). Reads nothing while
+	 *  a switch is waiting.
+	 *
+	 *  @param cmd Where the command is written.
+	 *  @return True if cmd holds a new command.
+	 */
+	bool poll(Command &cmd);
+
+	/** @brief Answers the command returned by the last poll().
+	 *
+	 *  In console mode a single value is printed on its own line, and
+	 *  several values are separated by spaces. In binary mode the values are
+	 *  sent as floats in a frame with the command's id and seq.
+	 *
+	 *  @param op Command being answered.
+	 *  @param v Values to send.
+	 *  @param n Number of values, at most CMD_MAX_ARGS.
+	 *  @param digits Decimal places used in console mode.
+	 */
+	void reply(char op, const float *v, uint8_t n, int digits);
+
+	/** @brief Sends a message topside didn't ask for.
+	 *
+	 *  In console mode the values follow the id on one line, so they can be
+	 *  told apart from replies. In binary mode it is a frame like a reply,
+	 *  numbered with push_seq.
+	 *
+	 *  @param op Message id.
+	 *  @param v Values to send.
+	 *  @param n Number of values, at most CMD_MAX_ARGS.
+	 *  @param digits Decimal places used in console mode.
+	 */
+	void push(char op, const float *v, uint8_t n, int digits);
+
+	/** @brief Sends a binary frame.
+	 *
+	 *  Never blocks. What doesn't fit in the transmit buffer waits in the
+	 *  queue for pump(), and the frame is thrown away and counted in unsent
+	 *  if the queue has no room for it either.
+	 *
+	 *  @param id Message id.
+	 *  @param seq Sequence number.
+	 *  @param payload Payload bytes.
+	 *  @param len Number of payload bytes.
+	 */
+	void send(uint8_t id, uint8_t seq, const void *payload, size_t len);
+
+	/** @brief Moves queued frames into the transmit buffer as it has room.
+	 *
+	 *  Never blocks. Once the queue and the transmit buffer are empty, makes
+	 *  the switch set_mode() left waiting. Anything else written to the port
+	 *  has to wait until this returns true, or it would land in the middle
+	 *  of a frame or go out at the wrong rate.
+	 *
+	 *  @return True once the queue is empty and no switch is waiting.
+	 */
+	bool pump();
+
+	/** @brief Changes the baud rate and mode.
+	 *
+	 *  The mode changes at once, but the baud rate only once pump() has sent
+	 *  everything already queued at the old one, so the reply to the 'b'
+	 *  command is not garbled. Until a valid command comes in at the new
+	 *  rate, poll() goes back to the old rate and mode after
+	 *  LINK_FALLBACK_MS, so a rate topside can't reach doesn't leave the sub
+	 *  deaf.
+	 *
+	 *  @param baud New baud rate, which has to pass link_baud_ok().
+	 *  @param binary True for binary mode, false for console mode.
+	 *  @return False, changing nothing, if baud isn't supported.
+	 */
+	bool set_mode(uint32_t baud, bool binary);
+
+private:
+	void fall_back();
+	void switch_to(uint32_t baud, bool binary);
+};
+
+/** @brief Checks a baud rate is one the link can switch to.
+ *
+ *  These are the standard rates up to 115200, and the ones above that the
+ *  AVR's 16 MHz clock divides exactly.
+ *
+ *  @param baud The baud rate.
+ *  @return True if it is supported.
+ */
+bool link_baud_ok(uint32_t baud);
+
+#endif
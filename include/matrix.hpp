@@ -0,0 +1,496 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file matrix.hpp
+ *  @brief Fixed size matrices with their dimensions checked at compile time.
+ *
+ *  Matrix<R, C> holds R by C floats in a row major array, the same layout
+ *  as the float tables of the Kalman filter, and Ref<R, C> reads and
+ *  writes one of those arrays in place. Both can be added, subtracted,
+ *  scaled, transposed and multiplied with the usual operators, eg
+ *
+ *      Ref<N, N> A(a), Q(Qk);
+ *      A = F*A*transpose(F) + Q*dt;
+ *
+ *  and mismatched dimensions don't compile. Every size is a template
+ *  argument, so every loop has a constant trip count the compiler can
+ *  unroll, and nothing is ever allocated on the heap.
+ *
+ *  Sums, differences, scaling and transposes aren't worked out when they
+ *  are written but when they are assigned, one element at a time straight
+ *  into the destination, so they need no temporaries. A product reads each
+ *  element of its operands many times, so it is worked out right away into
+ *  a Matrix on the stack, which is then read like any other. That also
+ *  means it is safe to assign a product to one of its own operands.
+ *  Elementwise operations only read the element they write, so they are
+ *  safe in place too. A transpose reads other elements than it writes, so
+ *  assigning one goes through a temporary.
+ *
+ *  A covariance is symmetric, so SymRef<N> keeps only its upper triangle,
+ *  N*(N+1)/2 floats rather than N*N. It reads as the whole matrix, and
+ *  assigning to it works out only the upper triangle. shear() updates one
+ *  in place for models that are the identity but for a few terms, and
+ *  ldl() factors one to solve with.
+ *
+ *  Expressions hold references to what they are made from, so use them
+ *  within the statement that makes them rather than keeping them in an auto
+ *  variable.
+ */
+#ifndef MATRIX_HPP
+#define MATRIX_HPP
+
+#include <Arduino.h>
+#include <string.h>
+
+/** The element type of T, without const. */
+template <class T> struct Plain { typedef T type; };
+template <class T> struct Plain<const T> { typedef T type; };
+
+/** @brief Base of everything that can be read as an R by C matrix.
+ *
+ *  E is the type deriving from it, which has an operator()(r, c) giving the
+ *  element, and a SHUFFLES flag for whether it reads elements of what it is
+ *  made from other than the one it gives.
+ */
+template <class E, int R, int C, class T>
+struct Expr
+{
+	const E &self() const { return *static_cast<const E *>(this); }
+};
+
+/** @brief Writes an expression into R by C elements at a. */
+template <int R, int C, class T, class E>
+inline void assign(T *a, const Expr<E, R, C, T> &e)
+{
+	const E &x = e.self();
+	if (E::SHUFFLES)
+	{
+		T t[R*C];
+		for (int r = 0; r < R; r++)
+			for (int c = 0; c < C; c++)
+				t[r*C+c] = x(r, c);
+		memcpy(a, t, sizeof(t));
+		return;
+	}
+	for (int r = 0; r < R; r++)
+		for (int c = 0; c < C; c++)
+			a[r*C+c] = x(r, c);
+}
+
+/** @brief An R by C matrix of T, 4*R*C bytes for float.
+ */
+template <int R, int C, class T = float>
+struct Matrix : Expr<Matrix<R, C, T>, R, C, T>
+{
+	enum { SHUFFLES = 0 };
+
+	/** Elements, row major. */
+	T a[R*C];
+
+	/** Leaves the elements uninitialized. */
+	Matrix() {}
+
+	template <class E>
+	Matrix(const Expr<E, R, C, T> &e) { assign(this->a, e); }
+
+	template <class E>
+	Matrix &operator=(const Expr<E, R, C, T> &e)
+	{
+		assign(this->a, e);
+		return *this;
+	}
+
+	T &operator()(int r, int c) { return this->a[r*C+c]; }
+	T operator()(int r, int c) const { return this->a[r*C+c]; }
+
+	/** @brief Makes a matrix of all zeros. */
+	static Matrix zero()
+	{
+		Matrix m;
+		for (int i = 0; i < R*C; i++)
+			m.a[i] = 0.;
+		return m;
+	}
+
+	/** @brief Makes a matrix with ones on the main diagonal and zeros
+	 *  elsewhere. */
+	static Matrix identity()
+	{
+		Matrix m = zero();
+		for (int i = 0; i < R && i < C; i++)
+			m.a[i*C+i] = 1.;
+		return m;
+	}
+};
+
+/** @brief An R by C matrix kept in an array somewhere else.
+ *
+ *  For working on the float arrays the rest of the code passes around
+ *  without copying them. Assigning to a Ref writes the array. T can be
+ *  const to only read it.
+ */
+template <int R, int C, class T = float>
+struct Ref : Expr<Ref<R, C, T>, R, C, typename Plain<T>::type>
+{
+	enum { SHUFFLES = 0 };
+
+	/** First element, row major. */
+	T *a;
+
+	explicit Ref(T *a) : a(a) {}
+
+	template <class E>
+	Ref &operator=(const Expr<E, R, C, typename Plain<T>::type> &e)
+	{
+		assign(this->a, e);
+		return *this;
+	}
+
+	/** Copies the elements of o, rather than pointing at its array. */
+	Ref &operator=(const Ref &o)
+	{
+		assign(this->a, o);
+		return *this;
+	}
+
+	T &operator()(int r, int c) const { return this->a[r*C+c]; }
+};
+
+/** @brief Index of row r, column c of an n by n symmetric matrix kept as its
+ *  upper triangle by rows. */
+inline int sym_index(int r, int c, int n)
+{
+	if (r > c)
+	{
+		int t = r;
+		r = c;
+		c = t;
+	}
+	return r*(2*n - r - 1)/2 + c;
+}
+
+/** @brief An R by R symmetric matrix kept as its upper triangle by rows, in
+ *  an array of R*(R+1)/2 elements somewhere else.
+ *
+ *  Assigning to it only works out and writes the upper triangle, so
+ *  whatever is assigned has to be symmetric. T can be const to only read
+ *  it.
+ */
+template <int R, class T = float>
+struct SymRef : Expr<SymRef<R, T>, R, R, typename Plain<T>::type>
+{
+	enum { SHUFFLES = 0 };
+
+	/** First element of the upper triangle. */
+	T *a;
+
+	explicit SymRef(T *a) : a(a) {}
+
+	template <class E>
+	SymRef &operator=(const Expr<E, R, R, typename Plain<T>::type> &e)
+	{
+		const E &x = e.self();
+		typename Plain<T>::type t[E::SHUFFLES ? R*(R+1)/2 : 1];
+		typename Plain<T>::type *to = E::SHUFFLES ? t : this->a;
+		for (int r = 0, n = 0; r < R; r++)
+			for (int c = r; c < R; c++)
+				to[n++] = x(r, c);
+		if (E::SHUFFLES)
+			memcpy(this->a, t, sizeof(t));
+		return *this;
+	}
+
+	/** Copies the elements of o, rather than pointing at its array. */
+	SymRef &operator=(const SymRef &o)
+	{
+		memmove(this->a, o.a, sizeof(T)*R*(R+1)/2);
+		return *this;
+	}
+
+	T &operator()(int r, int c) const { return this->a[sym_index(r, c, R)]; }
+};
+
+/** @brief Replaces P with E*P*E', where E is the identity but for k at row i,
+ *  column j.
+ *
+ *  This adds k times row and column j to row and column i, which takes R
+ *  multiplies and no temporaries, against 2*R^3 multiplies and an R by R
+ *  temporary for the products in full. A model that is the identity but
+ *  for a few terms is a product of these.
+ *
+ *  @param P The symmetric matrix, updated in place.
+ *  @param i The row and column changed, not j.
+ *  @param j The row and column added to it.
+ *  @param k How much of j is added.
+ */
+template <int R, class T>
+inline void shear(const SymRef<R, T> &P, int i, int j, T k)
+{
+	P(i, i) += k*(T(2)*P(i, j) + k*P(j, j));
+	for (int l = 0; l < R; l++)
+		if (l != i)
+			P(i, l) += k*P(j, l);
+}
+
+/** @brief What ldl() found.
+ */
+enum ldl_result
+{
+	/** Positive definite. */
+	LDL_OK,
+
+	/** Some pivots were too small to be told from rounding, or negative,
+	 *  and were dropped. */
+	LDL_DEFICIENT,
+
+	/** There was a NaN or infinity in it, so nothing it gives is any use. */
+	LDL_NOT_FINITE
+};
+
+/** @brief Factors a symmetric matrix into L*D*L' in place.
+ *
+ *  L is unit lower triangular and goes where the lower triangle is, which
+ *  for a SymRef is the same as the upper, and D goes on the diagonal. It
+ *  takes R divides and no square roots, where inverting by Gauss-Jordan
+ *  takes 2*R^2 divides, and a divide costs several multiplies on the AVR.
+ *
+ *  A pivot that comes out no more than tol times the diagonal element it
+ *  started from is what is left of rounding after the rows before it
+ *  explained that row, or the matrix isn't positive definite. Either way it
+ *  is set to zero with its column of L, so that the solve leaves that
+ *  component out rather than dividing by noise. That is what the Kalman
+ *  filter's sequential updates do with a measurement whose innovation has
+ *  no variance.
+ *
+ *  @param A The matrix, replaced by its factors.
+ *  @param tol Smallest pivot kept, as a fraction of its diagonal element,
+ *             around 1e-5 for float and 1e-12 for double.
+ *  @return LDL_OK, LDL_DEFICIENT if pivots were dropped, or LDL_NOT_FINITE,
+ *          which leaves A partly factored.
+ */
+template <int R, class T>
+int ldl(const SymRef<R, T> &A, T tol)
+{
+	int result = LDL_OK;
+	for (int j = 0; j < R; j++)
+	{
+		// v = L(j, k)*D(k), which every row below uses.
+		T v[R], d = A(j, j);
+		for (int k = 0; k < j; k++)
+		{
+			v[k] = A(j, k)*A(k, k);
+			d -= A(j, k)*v[k];
+		}
+		if (!isfinite(d))
+			return LDL_NOT_FINITE;
+		if (!(d > tol*A(j, j)) || !(d > T(0.)))
+		{
+			A(j, j) = 0.;
+			for (int i = j+1; i < R; i++)
+				A(i, j) = 0.;
+			result = LDL_DEFICIENT;
+			continue;
+		}
+		A(j, j) = d;
+		T di = T(1.)/d;
+		for (int i = j+1; i < R; i++)
+		{
+			T e = A(i, j);
+			for (int k = 0; k < j; k++)
+				e -= A(i, k)*v[k];
+			A(i, j) = e*di;
+		}
+	}
+	return result;
+}
+
+/** @brief Solves L*Z = B for Z in place of B, with L from ldl().
+ *
+ *  Row k of Z is then row k of B less what the rows before it explain, and
+ *  its variance is D(k). The sum of Z(k)^2/D(k) is B'*A^-1*B.
+ */
+template <int R, int C, class T, class U>
+void ldl_forward(const SymRef<R, T> &LD, const Ref<R, C, U> &B)
+{
+	for (int i = 1; i < R; i++)
+		for (int k = 0; k < i; k++)
+		{
+			T l = LD(i, k);
+			if (l == T(0.))
+				continue;
+			for (int c = 0; c < C; c++)
+				B(i, c) -= l*B(k, c);
+		}
+}
+
+/** @brief Solves A*X = B for X in place of B, with A factored by ldl().
+ *
+ *  Components along dropped pivots come out zero.
+ */
+template <int R, int C, class T, class U>
+void ldl_solve(const SymRef<R, T> &LD, const Ref<R, C, U> &B)
+{
+	ldl_forward(LD, B);
+	for (int i = 0; i < R; i++)
+	{
+		T d = LD(i, i), di = d > T(0.) ? T(1.)/d : T(0.);
+		for (int c = 0; c < C; c++)
+			B(i, c) *= di;
+	}
+	for (int i = R-1; i >= 0; i--)
+		for (int k = i+1; k < R; k++)
+		{
+			T l = LD(k, i);
+			if (l == T(0.))
+				continue;
+			for (int c = 0; c < C; c++)
+				B(i, c) -= l*B(k, c);
+		}
+}
+
+template <class A, class B, int R, int C, class T>
+struct Sum : Expr<Sum<A, B, R, C, T>, R, C, T>
+{
+	enum { SHUFFLES = A::SHUFFLES || B::SHUFFLES };
+	const A &x;
+	const B &y;
+	Sum(const A &x, const B &y) : x(x), y(y) {}
+	T operator()(int r, int c) const { return x(r, c) + y(r, c); }
+};
+
+template <class A, class B, int R, int C, class T>
+struct Difference : Expr<Difference<A, B, R, C, T>, R, C, T>
+{
+	enum { SHUFFLES = A::SHUFFLES || B::SHUFFLES };
+	const A &x;
+	const B &y;
+	Difference(const A &x, const B &y) : x(x), y(y) {}
+	T operator()(int r, int c) const { return x(r, c) - y(r, c); }
+};
+
+template <class A, int R, int C, class T>
+struct Scaled : Expr<Scaled<A, R, C, T>, R, C, T>
+{
+	enum { SHUFFLES = A::SHUFFLES };
+	const A &x;
+	T k;
+	Scaled(const A &x, T k) : x(x), k(k) {}
+	T operator()(int r, int c) const { return x(r, c)*k; }
+};
+
+template <class A, int R, int C, class T>
+struct Transposed : Expr<Transposed<A, R, C, T>, R, C, T>
+{
+	enum { SHUFFLES = 1 };
+	const A &x;
+	Transposed(const A &x) : x(x) {}
+	T operator()(int r, int c) const { return x(c, r); }
+};
+
+template <class A, class B, int R, int C, class T>
+inline Sum<A, B, R, C, T> operator+(const Expr<A, R, C, T> &x,
+		const Expr<B, R, C, T> &y)
+{
+	return Sum<A, B, R, C, T>(x.self(), y.self());
+}
+
+template <class A, class B, int R, int C, class T>
+inline Difference<A, B, R, C, T> operator-(const Expr<A, R, C, T> &x,
+		const Expr<B, R, C, T> &y)
+{
+	return Difference<A, B, R, C, T>(x.self(), y.self());
+}
+
+template <class A, int R, int C, class T>
+inline Scaled<A, R, C, T> operator*(const Expr<A, R, C, T> &x,
+		typename Plain<T>::type k)
+{
+	return Scaled<A, R, C, T>(x.self(), k);
+}
+
+template <class A, int R, int C, class T>
+inline Scaled<A, R, C, T> operator*(typename Plain<T>::type k,
+		const Expr<A, R, C, T> &x)
+{
+	return Scaled<A, R, C, T>(x.self(), k);
+}
+
+/** @brief Transpose of x, C by R. */
+template <class A, int R, int C, class T>
+inline Transposed<A, C, R, T> transpose(const Expr<A, R, C, T> &x)
+{
+	return Transposed<A, C, R, T>(x.self());
+}
+
+/** @brief Product of x and y, worked out right away.
+ *
+ *  Rows of the product are built up one element of x at a time so that the
+ *  zeros in sparse matrices like the model or measurement matrix cost a
+ *  compare rather than a row of multiplies. Keep the sparse one on the
+ *  left.
+ */
+template <class A, class B, int R, int K, int C, class T>
+inline Matrix<R, C, T> operator*(const Expr<A, R, K, T> &x,
+		const Expr<B, K, C, T> &y)
+{
+	const A &p = x.self();
+	const B &q = y.self();
+	Matrix<R, C, T> m;
+	for (int r = 0; r < R; r++)
+	{
+		for (int c = 0; c < C; c++)
+			m.a[r*C+c] = 0.;
+		for (int k = 0; k < K; k++)
+		{
+			T v = p(r, k);
+			if (v == T(0.))
+				continue;
+			for (int c = 0; c < C; c++)
+				m.a[r*C+c] += v*q(k, c);
+		}
+	}
+	return m;
+}
+
+/** @brief Prints a matrix a row to a line, elements separated by spaces.
+ *
+ *  @param out Where to print it.
+ *  @param x The matrix.
+ */
+template <class A, int R, int C, class T>
+void print(Print &out, const Expr<A, R, C, T> &x)
+{
+	for (int r = 0; r < R; r++)
+	{
+		for (int c = 0; c < C; c++)
+		{
+			if (c)
+				out.print(' ');
+			out.print((double)x.self()(r, c), 6);
+		}
+		out.print('\n');
+	}
+}
+
+#endif
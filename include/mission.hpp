@@ -0,0 +1,128 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file mission.hpp
+ *  @brief Queue of waypoints the sub works through on its own.
+ *
+ *  Topside uploads a mission as a batch of 'm' commands. The front waypoint
+ *  is copied into the target state every control tick, and it is done once
+ *  the sub has stayed within its tolerances for its dwell time, or when its
+ *  timeout runs out. Then the next one takes over, and topside is told which
+ *  waypoint finished and how. After the last one the sub holds its setpoint.
+ */
+#ifndef MISSION_HPP
+#define MISSION_HPP
+
+#include <Arduino.h>
+#include "config.h"
+
+/** Most waypoints that can be queued.
+ */
+#define MISSION_MAX 16
+
+/** @brief How a waypoint finished.
+ */
+enum mission_result
+{
+	MISSION_NONE,    // still working on it
+	MISSION_REACHED, // stayed within tolerance for the dwell time
+	MISSION_TIMEOUT  // ran out of time first
+};
+
+/** @brief One setpoint and when it counts as done.
+ */
+struct Waypoint
+{
+	/** Setpoint, as in the 's' command. */
+	float target[DOF];
+
+	/** Largest distance from the target in meters. */
+	float tolerance;
+
+	/** Largest heading error in degrees. */
+	float heading_tolerance;
+
+	/** Seconds to stay within tolerance, none if negative. */
+	float dwell;
+
+	/** Seconds allowed in total, or 0 or less for no limit. */
+	float timeout;
+};
+
+struct Mission
+{
+	/** Ring buffer of waypoints, the active one at head. */
+	Waypoint queue[MISSION_MAX];
+	uint8_t head, count;
+
+	/** Number of the active waypoint, counted from the first one added
+	 *  since the queue was last empty. */
+	uint16_t index;
+
+	/** Whether the active waypoint's timer is running, and millis() when it
+	 *  started. */
+	bool started;
+	uint32_t start;
+
+	/** Whether the sub is within tolerance, and millis() when it got there. */
+	bool within;
+	uint32_t arrival;
+
+	Mission();
+
+	/** @brief Adds a waypoint to the back of the queue.
+	 *
+	 *  @param args Target[DOF], tolerance, heading tolerance, dwell, and
+	 *         timeout, ie the arguments of the 'm' command.
+	 *  @return False if the queue is full.
+	 */
+	bool add(const float *args);
+
+	/** @brief Drops every waypoint.
+	 *
+	 *  @return Number of waypoints dropped.
+	 */
+	uint8_t clear();
+
+	/** @brief Restarts the active waypoint's timers, eg after the sub has
+	 *  been killed for a while.
+	 */
+	void restart();
+
+	/** @brief Steers towards the active waypoint and checks whether it is
+	 *  done.
+	 *
+	 *  Call every control tick while the sub is running. Does nothing if the
+	 *  queue is empty.
+	 *
+	 *  @param current Current state.
+	 *  @param target Target state, overwritten with the active waypoint.
+	 *  @param now millis().
+	 *  @return How the active waypoint finished, if it did. index is then the
+	 *          number of the next one.
+	 */
+	int update(const float *current, float *target, uint32_t now);
+};
+
+#endif
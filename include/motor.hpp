@@ -32,31 +32,21 @@
 
 #include "m5/m5.h"
 #include "config.h"
-#include "pid.hpp"
+#include "control.hpp"
 
 /** Startup time for motors after sub is unkilled.
  */
 #define PAUSE_TIME 4500 
 
 /** @brief Helper class for motors.
+ *
+ *  The controllers, thrusts and forces are those of Control, in float.
  */
-struct Motors
+struct Motors : Control<float>
 {
-	/** PID controllers for each degree of freedom. */
-	PID controllers[DOF+1];
-
-	/** Current thrust values for each of the motors. */
-	float thrust[NUM_MOTORS];
-
 	/** Holds pressed values for remote control. */
 	int buttons[NUM_MOTORS];
 
-	/** Theoretical forces for each degree of freedom. */
-	float forces[DOF];
-
-	/** Computed PID values from each controller. */
-	float pid[DOF];
-
 	/** Current submarine power. */
 	float p;
 
@@ -75,10 +65,9 @@ struct Motors
 	 *  @param dstate Difference between desired and current state.
 	 *  @param daltitude Difference between distances from bottom. 
 	 *  @param angles Current euler angles.
-	 *  @param t Current time used for time difference calculations.
-	 *  @return Time after iteration is finished.
+	 *  @param dt Time since the last iteration in seconds. Must not be 0.
 	 */
-	uint32_t run(float *dstate, float daltitude, float *angles, uint32_t t);
+	void run(float *dstate, float daltitude, float *angles, float dt);
 };
 
 #endif 
@@ -0,0 +1,205 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file navigation.hpp
+ *  @brief Sensor fusion around the Kalman filter, and a log of its inputs.
+ *
+ *  Each control tick, the newest AHRS and DVL samples are fed to the Kalman
+ *  filter in the order they were true, along with the attitude history the
+ *  DVL is rotated with and the motor forces the motion model uses during a
+ *  dropout. Everything the filter depends on goes through here, so a log of
+ *  what was passed in reproduces it exactly.
+ *
+ *  The position is kept in two parts: whole meters in origin, and the rest in
+ *  the state, which is moved over into origin whenever it passes half a
+ *  meter. A float far from zero can't resolve the few millimeters the sub
+ *  moves each prediction, so X and Y themselves would lose a little more of
+ *  every step the further the sub got from where it started. Under half a
+ *  meter they resolve a few nanometers, wherever the sub is.
+ *
+ *  The log is a NavRecord per control tick in which the filter ran, and a
+ *  NavRecord with the whole filter state every time it restarts. Topside
+ *  turns it on with the 'e' command. In console mode each record is a line
+ *  "e <hex bytes>", and in binary mode an 'e' frame, with the bytes as laid
+ *  out by NavRecord::pack(). The replay tool in replay/ reruns the filter
+ *  from it and smooths the result.
+ */
+#ifndef NAVIGATION_HPP
+#define NAVIGATION_HPP
+
+#include <Arduino.h>
+#include "kalman.hpp"
+#include "history.hpp"
+#include "sensor.hpp"
+
+/** Number of control ticks of motor forces kept for the motion model.
+ */
+#define FORCE_LOG 8
+
+/** @brief Kalman filter state and what feeds it.
+ */
+struct Navigation
+{
+	Kalman kalman;
+
+	/** State and covariance as described in kalman.hpp, the covariance as
+	 *  its upper triangle by rows. */
+	float state[N];
+	float covar[N*(N+1)/2];
+
+	/** Whole meters of X and Y that have been moved out of the state. The
+	 *  position is origin plus the state's X and Y. */
+	int32_t origin[2];
+
+	/** Attitude samples, to rotate the DVL with the attitude it measured
+	 *  at. */
+	History history;
+
+	/** Motor forces along X and Y from the last few control ticks, each held
+	 *  from when it was set until the next. Only a few ticks are ever looked
+	 *  back over, so like the history this keeps the low 32 bits of the
+	 *  time. */
+	float force_log[FORCE_LOG][2];
+	uint32_t force_log_time[FORCE_LOG];
+	uint8_t force_log_head;
+
+	Navigation();
+
+	/** @brief Sets the position to the origin, keeping everything else.
+	 */
+	void zero();
+
+	/** @brief Finds the position.
+	 *
+	 *  @param xy X and Y in meters, set.
+	 */
+	void position(float *xy) const;
+
+	/** @brief Fuses the newest samples.
+	 *
+	 *  Samples are taken in the order they were true, which their times say,
+	 *  not the order they were noticed in. Every sample must be fused
+	 *  exactly once.
+	 *
+	 *  @param ahrs_fresh True if the AHRS has a new sample.
+	 *  @param att When the AHRS samples were true.
+	 *  @param angles The newest yaw, pitch, and roll.
+	 *  @param dvl_fresh True if the DVL has a new sample.
+	 *  @param dvl When the DVL samples were true.
+	 */
+	void fuse(bool ahrs_fresh, const Sensor &att, float *angles,
+			bool dvl_fresh, const Sensor &dvl);
+
+	/** @brief Records the forces the motors were just set to.
+	 *
+	 *  @param t Current micros().
+	 *  @param forces Inertial forces, as in Motors::forces.
+	 */
+	void force(uint32_t t, const float *forces);
+
+private:
+	void fuse_ahrs(const Sensor &att, float *angles);
+	void fuse_dvl(const Sensor &dvl, float *angles);
+	void average_forces(uint32_t from, uint32_t to, float *forces) const;
+	void recenter();
+};
+
+/** @brief Flags saying what a NavRecord holds.
+ */
+enum nav_record_flags
+{
+	NAV_STATE = 1,   // the whole filter, right after it restarted
+	NAV_ZERO = 2,    // the position was zeroed before this tick
+	NAV_CLEAR = 4,   // the attitude history was cleared before this tick
+	NAV_AHRS = 8,    // an AHRS sample was fused
+	NAV_DVL = 16,    // a DVL sample was fused
+	NAV_FORCE = 32   // the motors were set
+};
+
+/** Longest NavRecord::pack() output, the state record.
+ */
+#define NAV_RECORD_LEN (1 + 9 + 4*(N + N*(N+1)/2))
+
+/** @brief Everything the filter was given in one control tick, or its
+ *         whole state when it restarted.
+ *
+ *  Only the parts the flags say are there are packed.
+ */
+struct NavRecord
+{
+	uint8_t flags;
+
+	/** millis() of the control tick, as in telemetry. Not in state
+	 *  records, which would then be too long for a frame. */
+	uint32_t time;
+
+	/** NAV_STATE: the low 32 bits of Kalman::time and valid, blend, the
+	 *  state, and the upper triangle of the covariance by rows. The filter
+	 *  only restarts after an unkill zeroed the position, so the origin is
+	 *  always 0 and isn't logged. */
+	uint32_t kalman_time, kalman_valid;
+	uint8_t kalman_blend;
+	float state[N];
+	float covar[N*(N+1)/2];
+
+	/** NAV_AHRS: the low 32 bits of when the sample was true and the one
+	 *  before it, the attitude the controller used, and the raw
+	 *  accelerometer along surge, sway, and heave in g. */
+	uint32_t ahrs_time, ahrs_prev;
+	float angles[3];
+	float accel[3];
+
+	/** NAV_DVL: the low 32 bits of when the sample was true and the one
+	 *  before it, and the raw forward and starboard velocities and range as
+	 *  the DVL sent them. */
+	uint32_t dvl_time, dvl_prev;
+	int32_t dvl_vel[2];
+	int32_t dvl_range;
+
+	/** NAV_FORCE: when the motors were set and the forces along X and Y. */
+	uint32_t force_time;
+	float forces[2];
+
+	/** Depth in meters, and the X and Y the state ended the tick with, less
+	 *  origin, to check a replay against. Not in state records. */
+	float depth;
+	float check[2];
+
+	/** @brief Lays the record out as little endian bytes.
+	 *
+	 *  @param out Where to write, at least NAV_RECORD_LEN bytes.
+	 *  @return Number of bytes written.
+	 */
+	size_t pack(uint8_t *out) const;
+
+	/** @brief Reads a record laid out by pack().
+	 *
+	 *  @param in The bytes.
+	 *  @param len Number of bytes.
+	 *  @return False if the length doesn't match the flags.
+	 */
+	bool unpack(const uint8_t *in, size_t len);
+};
+
+#endif
@@ -25,45 +25,70 @@
 /** @file pid.hpp
  *  @brief Helper class to compute PID for motors.
  *
+ *  Generic over the scalar, like util.hpp. PID is the float one the motors
+ *  use.
+ *
  *  @author David Zhang
  */
 #ifndef PID_HPP
 #define PID_HPP 
 
+#include "util.hpp"
+
 /** @brief Helper class for PID computations.
  */
-struct PID 
+template <class T>
+struct BasicPID 
 {
 	/** PID gains for proportional, integral, and derivative. */
-	float kp, ki, kd;
+	T kp, ki, kd;
 
 	/** Previous error value. */
-	float prev;
+	T prev;
 	
 	/** Sum of all of the errors. */
-	float sum;
+	T sum;
 
-	PID() {}
-	PID(float a, float b, float c) : kp(a), ki(b), kd(c), prev(0.), sum(0.) {}
+	BasicPID() {}
+	BasicPID(T a, T b, T c) : kp(a), ki(b), kd(c), prev(0.), sum(0.) {}
 
 	/** @brief Initialize the PID gains from the config.
 	 *  
 	 *  @param a Proportional gain.
 	 *  @param b Integral gain.
 	 *  @param c Derivative gain.
-	 *  @return 0 on success.
 	 */
-	float init(float a, float b, float c);
+	void init(T a, T b, T c)
+	{
+		this->kp = a;
+		this->ki = b;
+		this->kd = c;
+		this->prev = 0.0;
+		this->sum = 0.0;
+	}
 
 	/** @brief Compute total PID constant.
 	 *  
+	 *  IMPORTANT: Make sure dt isn't 0, will cause motors to send NAN.
+	 *
 	 *  @param error Difference between setpoint and current point.
 	 *  @param dt Time difference.
 	 *  @param min Minimum value of PID, which is usefull to ensure small changes 
 	 *             are adjusted for.
 	 *  @return The total PID constant.
 	 */
-	float calculate(float error, float dt, float min);
+	T calculate(T error, T dt, T min)
+	{
+		T pout = this->kp*error;
+		this->sum += error*dt;
+		T iout = this->ki*this->sum;
+		T dout = this->kd*(error-this->prev)/dt;
+		this->prev = error;
+		T output = pout + iout + dout;
+		return limit(limit(output, T(-2.), T(2.)), min);
+	}
 };
 
+typedef BasicPID<float> PID;
+
 #endif 
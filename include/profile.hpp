@@ -0,0 +1,126 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file profile.hpp
+ *  @brief Per-stage cycle profiler for the control loop.
+ *
+ *  Wrap a stage in PROFILE_BEGIN(stage) and PROFILE_END(stage) to record how
+ *  many cpu cycles it took. Each stage keeps its min, max and mean along with
+ *  a log2 histogram, ie bin b counts runs that took [2^b, 2^(b+1)) cycles.
+ *  PROFILE_CONTROL_BEGIN() and PROFILE_CONTROL_END(late) at the top and
+ *  bottom of the control task track how often it comes around, the longest
+ *  gap between two runs, and its worst latency: from the tick it was
+ *  released at to when it finished, which is the worst case delay reacting
+ *  to anything.
+ *
+ *  The simulator counts cycles off its virtual clock, which stands still
+ *  while the control code runs, so there only the control task's rate and
+ *  lateness mean anything.
+ *
+ *  Everything here compiles to nothing unless PROFILE is defined, so leave it
+ *  off for runs in the pool.
+ */
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <Arduino.h>
+
+/** Number of histogram bins. The last bin also counts anything longer.
+ */
+#define PROF_BINS 20
+
+/** @brief Stages that can be profiled.
+ */
+enum prof_stage
+{
+	PROF_AHRS,
+	PROF_DVL,
+	PROF_COMMAND,
+	PROF_KALMAN,
+	PROF_PID,
+	PROF_POWER,
+	NUM_PROF_STAGES
+};
+
+#ifdef PROFILE
+
+#include "io_profile.h"
+
+#define PROFILE_INIT() profile_init()
+#define PROFILE_BEGIN(s) uint32_t prof_start_##s = io_profile_cycles()
+#define PROFILE_END(s) profile_record(s, io_profile_cycles() - prof_start_##s)
+#define PROFILE_CONTROL_BEGIN() uint32_t prof_control = io_profile_cycles()
+#define PROFILE_CONTROL_END(late) profile_control(prof_control, late)
+
+/** @brief Timing statistics of one stage.
+ */
+struct ProfStage
+{
+	uint32_t count;
+	uint32_t min, max;
+	uint32_t sum;
+	uint16_t hist[PROF_BINS];
+};
+
+/** @brief Starts the cycle counter and clears the statistics.
+ */
+void profile_init();
+
+/** @brief Adds one run of a stage to its statistics.
+ *
+ *  @param s The stage.
+ *  @param cycles How long it took.
+ */
+void profile_record(enum prof_stage s, uint32_t cycles);
+
+/** @brief Adds one run of the control task to its statistics.
+ *
+ *  @param start Cycle count when it started.
+ *  @param late Microseconds from its release to when it started, as the
+ *              scheduler measured it.
+ */
+void profile_control(uint32_t start, uint32_t late);
+
+/** @brief Prints the statistics and clears them.
+ *
+ *  One line per stage: name, count, min, mean and max cycles, then the
+ *  histogram bins. The last line is "control", the rate the control task ran
+ *  at in Hz, the longest gap between two of its starts and its worst latency
+ *  from release to finish, both in cycles.
+ *
+ *  @param out Where to print the statistics.
+ */
+void profile_print(Print &out);
+
+#else
+
+#define PROFILE_INIT()
+#define PROFILE_BEGIN(s)
+#define PROFILE_END(s)
+#define PROFILE_CONTROL_BEGIN()
+#define PROFILE_CONTROL_END(late)
+
+#endif
+
+#endif
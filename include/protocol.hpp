@@ -0,0 +1,127 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file protocol.hpp
+ *  @brief Framed binary protocol shared by Nautical and topside tools.
+ *
+ *  Every message is laid out as
+ *
+ *      [id] [seq] [payload ...] [crc hi] [crc lo]
+ *
+ *  where the crc is CRC-XMODEM over everything before it (the same crc the
+ *  AHRS uses, so the crc of the whole message is 0). The message is then COBS
+ *  encoded so it contains no zero bytes, and a single zero byte marks the end
+ *  of the frame. A receiver that loses sync just waits for the next zero.
+ *
+ *  Payloads are raw little endian IEEE754 floats. Command messages use the
+ *  console command letter as their id and carry the same arguments, so a
+ *  binary 's' is 6 floats. Replies echo the seq of the request they answer.
+ *
+ *  Nothing in here depends on Arduino, so topside tools can build
+ *  protocol.cpp and crc_xmodem_generic.c directly.
+ */
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Largest payload a message can carry. A telemetry record with every field
+ *  is 205 bytes.
+ */
+#define PROTO_MAX_PAYLOAD 208
+
+/** Bytes added by the id, seq and crc.
+ */
+#define PROTO_OVERHEAD 4
+
+/** Largest encoded frame, including the COBS overhead byte(s) and the zero
+ *  delimiter.
+ */
+#define PROTO_MAX_FRAME (PROTO_MAX_PAYLOAD + PROTO_OVERHEAD + \
+		(PROTO_MAX_PAYLOAD + PROTO_OVERHEAD)/254 + 2)
+
+/** @brief Builds one complete frame.
+ *
+ *  @param id Message id.
+ *  @param seq Sequence number.
+ *  @param payload Payload bytes, may be NULL if len is 0.
+ *  @param len Number of payload bytes, at most PROTO_MAX_PAYLOAD.
+ *  @param out Where the frame is written, must hold PROTO_MAX_FRAME bytes.
+ *  @return Length of the frame including the delimiter, or 0 if len is too
+ *          large.
+ */
+size_t proto_encode(uint8_t id, uint8_t seq, const void *payload, size_t len,
+		uint8_t *out);
+
+/** @brief Reassembles frames from a byte stream.
+ */
+struct ProtoDecoder
+{
+	/** Encoded bytes received since the last delimiter. Decoded in place. */
+	uint8_t buf[PROTO_MAX_FRAME];
+	size_t len;
+
+	/** Fields of the last valid message. Only valid right after feed()
+	 *  returns true. */
+	uint8_t id;
+	uint8_t seq;
+	const uint8_t *payload;
+	size_t size;
+
+	/** Frames thrown away because of a bad crc or bad encoding. */
+	uint16_t errors;
+
+	/** Frames thrown away because they were too long. */
+	uint16_t overflows;
+
+	ProtoDecoder();
+
+	/** @brief Feeds the next received byte.
+	 *
+	 *  @param c The received byte.
+	 *  @return True when a complete, valid message has been decoded.
+	 */
+	bool feed(uint8_t c);
+
+	/** @brief Throws away any partially received frame.
+	 */
+	void reset();
+};
+
+/** @brief Reads a little endian float out of a payload.
+ *
+ *  @param p Pointer to the first byte.
+ *  @return The float.
+ */
+float proto_get_float(const uint8_t *p);
+
+/** @brief Writes a float into a payload as little endian.
+ *
+ *  @param p Pointer to the first byte.
+ *  @param v The float.
+ */
+void proto_put_float(uint8_t *p, float v);
+
+#endif
@@ -25,12 +25,25 @@
 /** @file rotation.h
  *  @brief Converts between frames of reference.
  *
+ *  Generic over the scalar, like util.hpp.
+ *
  *  @author David Zhang
  */
 #ifndef ROTATION_H
 #define ROTATION_H
 
 #include <Arduino.h> 
+#include <math.h>
+#include "config.h"
+
+/** @brief Sine and cosine of an angle in degrees.
+ *
+ *  For float and double. fixed.hpp has them for Fixed.
+ */
+///@{
+inline double sin_deg(double a) { return sin(a*D2R); }
+inline double cos_deg(double a) { return cos(a*D2R); }
+///@}
 
 /** @brief Converts values from body frame of reference to inertial frame of
  *         reference.
@@ -40,6 +53,32 @@
  *  @param output Pointer to where the values in the inertial frame will be 
  *                stored.
  */
-void body_to_inertial(float *input, float *angles, float *output);
+template <class T>
+void body_to_inertial(const T *input, const T *angles, T *output)
+{
+	// Pre-compute trig functions.
+	T spsi = sin_deg(angles[0]);
+	T sthe = sin_deg(angles[1]);
+	T sphi = sin_deg(angles[2]);
+	T cpsi = cos_deg(angles[0]);
+	T cthe = cos_deg(angles[1]);
+	T cphi = cos_deg(angles[2]);
+
+	// Calculate rotation matrix for Euler transformation.
+	T r11 =  cthe*cpsi;
+	T r12 = -cphi*spsi + sphi*sthe*cpsi;
+	T r13 = -sphi*spsi + cphi*sthe*cpsi;
+	T r21 =  cthe*spsi;
+	T r22 =  cphi*cpsi + sphi*sthe*spsi;
+	T r23 =  sphi*cpsi + cphi*sthe*spsi;
+	T r31 = -sthe;
+	T r32 =  sphi*cthe;
+	T r33 =  cphi*cthe;
+
+	// Calculate matrix.
+	output[0] = r11*input[0] + r12*input[1] + r13*input[2];
+	output[1] = r21*input[0] + r22*input[1] + r23*input[2];
+	output[2] = r31*input[0] + r32*input[1] + r33*input[2];
+}
 
-#endif 
+#endif
@@ -0,0 +1,165 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file scheduler.hpp
+ *  @brief Fixed-rate task scheduler for the main control loop.
+ *
+ *  A hardware timer interrupt advances a tick counter at SCHED_HZ. Each task
+ *  declares the rate it wants to run at, and Scheduler::run() (called from
+ *  loop()) runs every task whose release tick has passed, in the order they
+ *  were added. Tasks are cooperative, so a task that runs too long delays the
+ *  ones behind it. That shows up in the jitter and overrun statistics rather
+ *  than in the dt handed to the task, which is always a whole number of
+ *  periods.
+ *
+ *  On the sub the ticks come from io_sched_avr.cpp. Anything else (eg a
+ *  simulator) can drive the scheduler by calling Scheduler::tick() itself.
+ */
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <Arduino.h>
+
+/** Frequency of the scheduler tick.
+ */
+#define SCHED_HZ 1000
+
+/** Microseconds per scheduler tick.
+ */
+#define SCHED_TICK_US (1000000UL/SCHED_HZ)
+
+/** Maximum number of tasks that can be registered.
+ */
+#define SCHED_MAX_TASKS 8
+
+/** @brief A periodic task and its timing statistics.
+ */
+struct Task
+{
+	/** Name printed with the statistics. */
+	const char *name;
+
+	/** Function to run. The argument is the time since the last run in
+	 *  seconds. */
+	void (*fn)(float dt);
+
+	/** Period in ticks. */
+	uint16_t period;
+
+	/** Tick the task is due to run at next. */
+	uint32_t release;
+
+	/** Tick the task was last released at. */
+	uint32_t prev;
+
+	/** Number of times the task has run. */
+	uint32_t runs;
+
+	/** Number of releases skipped because the task was still behind. */
+	uint32_t overruns;
+
+	/** Worst and total lateness of the task start, in microseconds. */
+	uint32_t late_max, late_sum;
+
+	/** Worst execution time of the task, in microseconds. */
+	uint32_t exec_max;
+
+	/** Lateness of the run in progress, or of the last one, in
+	 *  microseconds. */
+	uint32_t late;
+};
+
+/** @brief Runs tasks at fixed rates off a timer tick.
+ */
+struct Scheduler
+{
+	/** Registered tasks, in priority order. */
+	Task tasks[SCHED_MAX_TASKS];
+
+	/** Number of registered tasks. */
+	uint8_t num;
+
+	/** Ticks since the scheduler started. Written from the timer interrupt. */
+	volatile uint32_t ticks;
+
+	/** micros() at the most recent tick. Written from the timer interrupt. */
+	volatile uint32_t tick_time;
+
+	Scheduler();
+
+	/** @brief Registers a new task.
+	 *
+	 *  Tasks are run in the order they are added when several are due at
+	 *  once, so add the most time critical ones first.
+	 *
+	 *  @param name Name of the task for the statistics.
+	 *  @param fn Function to run.
+	 *  @param hz Rate of the task. Must divide SCHED_HZ for an exact rate.
+	 *  @return Index of the task, or -1 if the table is full.
+	 */
+	int add(const char *name, void (*fn)(float dt), uint16_t hz);
+
+	/** @brief Advances the tick counter by one.
+	 *
+	 *  Called from the timer interrupt on the sub, or from the simulated clock
+	 *  on a computer.
+	 *
+	 *  @param us The value of micros() at the tick.
+	 */
+	void tick(uint32_t us);
+
+	/** @brief Runs every task that is due.
+	 *
+	 *  Never blocks. Returns immediately if nothing is due.
+	 */
+	void run();
+
+	/** @brief Restarts all tasks from the current tick.
+	 *
+	 *  Used after the sub has been paused, so the first dt is not the length
+	 *  of the pause.
+	 */
+	void restart();
+
+	/** @brief Clears the jitter and overrun statistics.
+	 */
+	void reset_stats();
+
+	/** @brief Prints one line of statistics per task.
+	 *
+	 *  Each line is: name, runs, overruns, mean lateness, max lateness, max
+	 *  execution time. Times are in microseconds.
+	 *
+	 *  @param out Where to print the statistics.
+	 */
+	void print(Print &out);
+
+	/** @brief Reads the tick counter atomically.
+	 *
+	 *  @return Ticks since the scheduler started.
+	 */
+	uint32_t now();
+};
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+/** @file screen.hpp
+ *  @brief Median prefilter for sensors that are read straight, without the
+ *  Kalman filter to check them.
+ *
+ *  The DVL's range to the bottom and the depth sensor now and then return a
+ *  sample that is nowhere near the others, from a ping off the pool wall or a
+ *  glitch on the analog line. Taken raw, one of those steps the altitude or
+ *  depth PID. This keeps the last few samples and passes each new one on
+ *  unless it is further than a limit from their median, in which case it is
+ *  counted and the median goes on in its place. Good samples go through
+ *  without the lag of a median filter, which the depth controller can't take,
+ *  and a spike shorter than half the window never comes through. A real step
+ *  comes through once it makes up half the window.
+ */
+#ifndef SCREEN_HPP
+#define SCREEN_HPP
+
+#include <Arduino.h>
+
+/** Number of samples the median is taken over. Odd, so the median is one of
+ *  them. */
+#define SCREEN_LEN 5
+
+struct Screen
+{
+	/** Ring buffer of the newest samples. */
+	float window[SCREEN_LEN];
+
+	/** Index the next sample goes in and number of samples kept. */
+	uint8_t head, num;
+
+	/** How far from the median a sample can be before it is replaced. */
+	float limit;
+
+	/** Samples that were replaced, wrapping. */
+	uint16_t rejected;
+
+	/** @param limit How far from the median a sample can be before it is
+	 *               replaced.
+	 */
+	Screen(float limit);
+
+	/** @brief Forgets every sample, but not the count.
+	 */
+	void clear();
+
+	/** @brief Adds a sample, dropping the oldest if full.
+	 *
+	 *  @param x The sample.
+	 *
+	 *  @return x, or the median of the samples kept, x included, if x is
+	 *          further than limit from it.
+	 */
+	float add(float x);
+};
+
+#endif
@@ -0,0 +1,105 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file sensor.hpp
+ *  @brief Bookkeeping for when sensor samples arrive.
+ *
+ *  The AHRS and DVL drivers only say whether there is new data since they
+ *  were last asked. This keeps that answer around until the consumer gets to
+ *  it, along with when each sample was true, so work is only done for new
+ *  samples and integrated over the real time between them. The drivers stamp
+ *  each datagram in the receive interrupt as its last byte arrives, so the
+ *  times don't depend on when the scheduler got around to asking.
+ */
+#ifndef SENSOR_HPP
+#define SENSOR_HPP
+
+#include <Arduino.h>
+
+/** @brief Arrival state of one sensor.
+ */
+struct Sensor
+{
+	/** True if a sample has arrived that hasn't been consumed. */
+	bool fresh;
+
+	/** micros64() when the newest sample was true. */
+	uint64_t time;
+
+	/** micros64() when the sample before it was true. */
+	uint64_t prev;
+
+	/** Number of samples that have arrived. */
+	uint32_t count;
+
+	Sensor() : fresh(false), time(0), prev(0), count(0) {}
+
+	/** @brief Records that a new sample arrived.
+	 *
+	 *  @param t Time the sample was true in microseconds, from the stamp the
+	 *           receive interrupt put on it less the sensor latency.
+	 */
+	void arrive(uint64_t t)
+	{
+		// The first sample after restart() may have been taken before it,
+		// which leaves nothing to measure the interval from.
+		prev = t < time ? t : time;
+		time = t;
+		fresh = true;
+		count++;
+	}
+
+	/** @brief Consumes the newest sample.
+	 *
+	 *  @return True if there was a sample that hadn't been consumed yet.
+	 */
+	bool take()
+	{
+		bool f = fresh;
+		fresh = false;
+		return f;
+	}
+
+	/** @brief Forgets any unconsumed sample and measures the next interval
+	 *         from now.
+	 *
+	 *  @param t Current time in microseconds.
+	 */
+	void restart(uint64_t t)
+	{
+		time = t;
+		fresh = false;
+	}
+
+	/** @brief Time between the newest sample and the one before it.
+	 *
+	 *  @return The interval in seconds.
+	 */
+	float interval() const
+	{
+		return (time - prev)/1000000.;
+	}
+};
+
+#endif
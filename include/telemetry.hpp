@@ -0,0 +1,212 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file telemetry.hpp
+ *  @brief Periodic telemetry pushed to topside without being asked.
+ *
+ *  Topside subscribes once with the 'l' command, giving a mask of fields and
+ *  a rate. Every control tick a snapshot of the whole controller is taken,
+ *  and each field that is due under its own decimation is packed into one
+ *  timestamped record. Records go into a fixed size ring buffer, which the
+ *  telemetry task drains only as fast as the serial transmit buffer has
+ *  room for, so a slow link drops records instead of stalling the control
+ *  loop.
+ *
+ *  In console mode a record is a line "l <ms> <mask> <values...>". In binary
+ *  mode it is an 'l' frame with the time as a uint32, the mask as a byte, and
+ *  the values as floats. Either way the values of the fields in the mask
+ *  appear in the order of the tlm_field enum. Other records, like the
+ *  navigation log and the filter's innovations, share the buffer so nothing
+ *  else writes in between. Records are formatted when they are queued, so
+ *  those still queued when the link changes mode are thrown away.
+ */
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+#include <Arduino.h>
+#include "config.h"
+#include "link.hpp"
+
+/** Size of the record ring buffer in bytes. Room for a console mode record
+ *  of every field, however long its values print.
+ */
+#define TLM_BUFFER 1024
+
+/** Number of raw sensor values in a snapshot.
+ */
+#define TLM_RAW_LEN 14
+
+/** Number of navigation values in a snapshot.
+ */
+#define TLM_NAV_LEN 5
+
+/** Number of reject counters in a snapshot.
+ */
+#define TLM_REJECT_LEN 5
+
+/** Most values in one record, which is every field at once.
+ */
+#define TLM_MAX_VALUES (3*DOF + NUM_MOTORS + TLM_RAW_LEN + TLM_NAV_LEN + \
+		TLM_REJECT_LEN)
+
+/** @brief Fields that can be subscribed to. Bit n of the mask is field n.
+ */
+enum tlm_field
+{
+	TLM_CURRENT, // current[DOF]
+	TLM_DESIRED, // desired[DOF]
+	TLM_PID,     // motors.pid[DOF]
+	TLM_THRUST,  // motors.thrust[NUM_MOTORS]
+	TLM_RAW,     // ahrs att[3], accel[3], dvl velocity[3], range, depth adc,
+	             // ahrs, dvl, and depth sample ages in ms
+	TLM_NAV,     // dvl dropout s, drift since m, position std m,
+	             // accel bias[2] m/s^2
+	TLM_REJECT,  // thrown out since startup, wrapping at 65536: dvl errors,
+	             // dvl velocities gated, ranges, depths, and telemetry
+	             // records that didn't fit in the buffer
+	NUM_TLM_FIELDS
+};
+
+/** @brief Everything about the controller at one control tick.
+ */
+struct Snapshot
+{
+	uint32_t time;
+	float current[DOF];
+	float desired[DOF];
+	float pid[DOF];
+	float thrust[NUM_MOTORS];
+	float raw[TLM_RAW_LEN];
+	float nav[TLM_NAV_LEN];
+	float reject[TLM_REJECT_LEN];
+};
+
+/** @brief Telemetry subscriptions and record buffer.
+ */
+struct Telemetry : public Print
+{
+	/** Record a field every decim[i] control ticks, never if 0. */
+	uint16_t decim[NUM_TLM_FIELDS];
+
+	/** Control ticks since each field was last recorded. */
+	uint16_t count[NUM_TLM_FIELDS];
+
+	/** Ring buffer of records waiting to be sent. Each record is preceded
+	 *  by its length as two bytes. */
+	uint8_t buf[TLM_BUFFER];
+	uint16_t head, tail, used;
+
+	/** Bytes of the record being sent that have not gone out yet. */
+	uint16_t pending;
+
+	/** Records thrown away because the buffer was full, or because the
+	 *  link changed mode before they went out. */
+	uint16_t dropped;
+
+	/** Link::modes when the records in the buffer were formatted. */
+	uint8_t modes;
+
+	Telemetry();
+
+	/** @brief Changes the rate of some fields.
+	 *
+	 *  @param mask Fields to change. Fields not in the mask keep their rate.
+	 *  @param decim Record them every decim control ticks, or 0 to stop.
+	 */
+	void subscribe(uint8_t mask, uint16_t decim);
+
+	/** @brief Records the fields that are due.
+	 *
+	 *  Call exactly once per control tick. Never blocks.
+	 *
+	 *  @param s Snapshot of the current control tick.
+	 *  @param link Link whose mode decides the record format.
+	 */
+	void record(const Snapshot &s, Link &link);
+
+	/** @brief Queues a record of values, in the same format as a telemetry
+	 *  record.
+	 *
+	 *  Dropped like any other record if there is no room. Never blocks.
+	 *
+	 *  @param id Record id, which takes the place of 'l'.
+	 *  @param time Time of the record in milliseconds.
+	 *  @param tag Byte that takes the place of the mask.
+	 *  @param v The values, at most TLM_MAX_VALUES.
+	 *  @param n Number of values.
+	 *  @param link Link whose mode decides the record format.
+	 */
+	void values(char id, uint32_t time, uint8_t tag, const float *v, int n,
+			Link &link);
+
+	/** @brief Queues a record of raw bytes, such as a NavRecord.
+	 *
+	 *  In console mode it is a line of the id and the bytes in hex, and in
+	 *  binary mode a frame with the id. Dropped like any other record if
+	 *  there is no room. Never blocks.
+	 *
+	 *  @param id Record id.
+	 *  @param payload The bytes, at most PROTO_MAX_PAYLOAD.
+	 *  @param len Number of bytes.
+	 *  @param link Link whose mode decides the record format.
+	 */
+	void bytes(char id, const uint8_t *payload, size_t len, Link &link);
+
+	/** @brief Queues a message topside didn't ask for, as Link::push()
+	 *  sends it, behind the records already queued.
+	 *
+	 *  Dropped like any other record if there is no room. Never blocks.
+	 *
+	 *  @param id Message id.
+	 *  @param v Values to send.
+	 *  @param n Number of values, at most CMD_MAX_ARGS.
+	 *  @param digits Decimal places used in console mode, at most 6.
+	 *  @param link Link whose mode decides the format.
+	 */
+	void push(char id, const float *v, uint8_t n, int digits, Link &link);
+
+	/** @brief Sends as much of the buffer as fits in the transmit buffer.
+	 *
+	 *  May stop in the middle of a record, in which case pending is left
+	 *  nonzero and nothing else may be written to the link until a later
+	 *  call has sent the rest.
+	 *
+	 *  @param link Link to send on.
+	 */
+	void flush(Link &link);
+
+
+	/** @brief Appends a byte to the ring buffer.
+	 *
+	 *  Used by the Print functions while a record is being written. Space is
+	 *  checked before each value is written, not here.
+	 */
+	size_t write(uint8_t c);
+	using Print::write;
+
+private:
+	void sync(Link &link);
+};
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file trajectory.hpp
+ *  @brief Smooths setpoint changes into limited speed and acceleration moves.
+ *
+ *  Commands, the mission and resets set the target. Every control tick each
+ *  degree of freedom of the desired state moves towards its target along a
+ *  trapezoidal profile: it speeds up at the acceleration limit until it
+ *  reaches the speed limit, and slows down at the acceleration limit so it
+ *  stops on the target. The PIDs track the desired state, so they see small
+ *  errors that change smoothly instead of one large step, which saturates
+ *  them and kicks the derivative term.
+ *
+ *  The angles move the short way around, using angle_difference.
+ */
+#ifndef TRAJECTORY_HPP
+#define TRAJECTORY_HPP
+
+#include "config.h"
+
+struct Trajectory
+{
+	/** Rate each degree of freedom of the desired state is moving at. */
+	float vel[DOF];
+
+	Trajectory();
+
+	/** @brief Stops moving, eg when the desired state is set directly.
+	 */
+	void stop();
+
+	/** @brief Moves the desired state one step towards the target.
+	 *
+	 *  @param target Target state.
+	 *  @param desired Desired state, updated.
+	 *  @param dt Time step in seconds.
+	 */
+	void step(const float *target, float *desired, float dt);
+};
+
+#endif
@@ -25,11 +25,18 @@
 /** @file util.hpp
  *  @brief Helper functions for other Nautical functions.
  *
+ *  The angle and limit functions are templates on the scalar, so that they
+ *  work on the Fixed of fixed.hpp as well as float and double. The float
+ *  versions are also plain functions, which take double constants too.
+ *
  *  @author David Zhang
  */
 #ifndef UTIL_HPP
 #define UTIL_HPP
 
+#include <stdint.h>
+#include <math.h>
+
 /** @brief Difference between two angles.
  *
  *  For example, if a1 is -170 and a2 is 170, a1-a2 = -340, which isn't how much
@@ -40,7 +47,21 @@
  *  @param a2 Current angle.
  *  @return Angle difference.
  */
-float angle_difference(float a1, float a2);
+template <class T>
+T angle_difference(T a1, T a2)
+{
+	// For [-180, 180].
+	T b1 = a1-a2;
+	if (fabs(b1) > T(180.))
+	{
+		if (a1 < a2)
+			a1 += T(360.);
+		else 
+			a2 += T(360.);
+		b1 = a1-a2;
+	}
+	return b1;
+}
 
 /** @brief Sum of two angles.
  *
@@ -52,7 +73,16 @@ float angle_difference(float a1, float a2);
  *  @param a2 Current angle.
  *  @return Angle difference.
  */
-float angle_add(float a1, float add);
+template <class T>
+T angle_add(T a1, T add)
+{
+	T temp = a1 + add;
+	if (temp > T(180.))
+		return temp - T(360.);
+	else if (temp < T(-180.))
+		return temp + T(360.);
+	return temp;
+}
 
 /** @brief Limits input between two numbers.
  *
@@ -62,7 +92,15 @@ float angle_add(float a1, float add);
  *  @param upper Upper bound.
  *  @return Input after limiting.
  */
-float limit(float input, float lower, float upper);
+template <class T>
+T limit(T input, T lower, T upper)
+{
+	if (input < lower) 
+		return lower;
+	if (input > upper)
+		return upper;
+	return input;
+}
 
 /** @brief Limits input to be at least a certain number.
  *
@@ -71,6 +109,42 @@ float limit(float input, float lower, float upper);
  *  @param min Lower bound.
  *  @return Input after limiting.
  */
+template <class T>
+T limit(T input, T min)
+{
+	if (input < T(0.) && input > -min)
+		return -min;
+	if (input > T(0.) && input < min)
+		return min;
+	return input;
+}
+
+/** @brief The float versions of the above, which take double constants too.
+ */
+///@{
+float angle_difference(float a1, float a2);
+float angle_add(float a1, float add);
+float limit(float input, float lower, float upper);
 float limit(float input, float min);
+///@}
+
+/** @brief micros() carried on into 64 bits, so it doesn't wrap every 71
+ *  minutes.
+ *
+ *  Counts the wraps it sees, so it has to be called at least once between
+ *  each, which the control task does every tick. Not for interrupts.
+ *
+ *  @return Microseconds since startup.
+ */
+uint64_t micros64();
+
+/** @brief Widens a 32 bit time, such as the stamp an interrupt took with
+ *  micros(), to 64 bits.
+ *
+ *  @param t Time in microseconds, within 35 minutes either side of ref.
+ *  @param ref A 64 bit time near it, such as micros64().
+ *  @return The 64 bit time whose low 32 bits are t.
+ */
+uint64_t widen(uint32_t t, uint64_t ref);
 
 #endif
@@ -30,12 +30,11 @@
 #ifndef VOLTAGE_HPP
 #define VOLTAGE_HPP
 
-#define NUM_SAMPLES 10
-
 /** @brief Calculate voltage left.
  *
  *  I'm not sure how well this function works, it is untested at the moment. It
- *  needs to be calibrated for sure.
+ *  needs to be calibrated for sure. Reads the filtered battery input from
+ *  adc.hpp, so it returns right away.
  *
  *  @return Remaining voltage.
  */
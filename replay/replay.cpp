@@ -0,0 +1,497 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file replay.cpp
+ *  @brief Reruns the navigation filter from logs and smooths the result.
+ *
+ *  Usage: replay [-j jobs] log...
+ *
+ *  Each log is what topside captured after sending "e 1", either the console
+ *  lines or the binary frames. Anything else in it is skipped. The filter is
+ *  started from each state record and fed every tick record through the same
+ *  Navigation and Kalman code the sub runs, so on a build with the same
+ *  floating point it comes out bit for bit the same. Every tick is checked
+ *  against the X and Y the sub logged.
+ *
+ *  The filter's state just before each prediction is kept, and a fixed
+ *  interval Rauch-Tung-Striebel smoother runs back over them, in double.
+ *  Each estimate is then made with every sample of the run, before and
+ *  after, rather than only those before, which makes it a reference to
+ *  measure the onboard filter against without a ground truth. A run is cut
+ *  into separate stretches wherever the position was zeroed. The smoother
+ *  needs the covariance, so the filter here always works it out in full,
+ *  and on a sub built with STEADY_GAINS the ticks it ran on the gain tables
+ *  come out close to the sub's but not the same.
+ *
+ *  For each log, "<log>.csv" gets the smoothed trajectory, and a line of
+ *  statistics is printed: how many ticks matched the sub, and the RMS and
+ *  largest difference between the onboard and smoothed positions and
+ *  velocities. Logs are worked on in parallel, -j at a time, all cores by
+ *  default.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Arduino.h>
+#include "config.h"
+#include "ahrs/ahrs.h"
+#include "dvl/dvl.h"
+#include "protocol.hpp"
+#include "navigation.hpp"
+#include "matrix.hpp"
+#include "util.hpp"
+
+// Elements in the upper triangle of the covariance.
+#define TRI (N*(N+1)/2)
+
+// The filter's times are 64 bits but only the low 32 are logged. They are
+// widened back from here, each against the one before, so a log that runs
+// past a wrap of micros() carries on.
+#define EPOCH (1ULL << 32)
+
+// The filter state just before one prediction, with the origin added back to
+// the position.
+struct Step
+{
+	uint64_t time;
+	float depth;
+	double x[N];
+	float P[TRI];
+};
+
+// What came out of one log.
+struct Run
+{
+	std::string path;
+	bool ok;
+	int error;
+	long records, bad, ticks, mismatched;
+	double worst_mismatch;
+	long steps;
+	double pos_sum, pos_max, vel_sum, vel_max;
+
+	Run() : ok(false), error(0), records(0), bad(0), ticks(0), mismatched(0),
+		worst_mismatch(0.), steps(0), pos_sum(0.), pos_max(0.), vel_sum(0.),
+		vel_max(0.) {}
+};
+
+// What the filter reads from the AHRS and DVL drivers. Each thread replays
+// its own log, so each has its own.
+static thread_local float accel_g[NUM_ACCEL_AXES];
+static thread_local int32_t dvl_fwd, dvl_stb;
+static thread_local std::vector<Step> *steps;
+static thread_local const Navigation *traced;
+static thread_local float depth;
+
+float ahrs_accel(enum accel_axis dir)
+{
+	return accel_g[dir];
+}
+
+int32_t dvl_get_forward_vel()
+{
+	return dvl_fwd;
+}
+
+int32_t dvl_get_starboard_vel()
+{
+	return dvl_stb;
+}
+
+static void trace(const Kalman &k, const float *x, const float *P)
+{
+	Step s;
+	s.time = k.time;
+	s.depth = depth;
+	for (int i = 0; i < N; i++)
+		s.x[i] = x[i];
+	s.x[0] += traced->origin[0];
+	s.x[3] += traced->origin[1];
+	memcpy(s.P, P, sizeof(s.P));
+	steps->push_back(s);
+}
+
+static void unpack(const float *tri, double *P)
+{
+	for (int i = 0, n = 0; i < N; i++)
+		for (int j = i; j < N; j++, n++)
+			P[i*N+j] = P[j*N+i] = tri[n];
+}
+
+// The model of Kalman::predict, in double.
+static void transition(double dt, double *F)
+{
+	for (int i = 0; i < N*N; i++)
+		F[i] = i % (N+1) == 0 ? 1. : 0.;
+	for (int b = 0; b < 6; b += 3)
+	{
+		F[b*N+b+1] = F[(b+1)*N+b+2] = dt;
+		F[b*N+b+2] = dt*dt/2.;
+	}
+}
+
+static void mul(const double *A, const double *B, bool bt, double *C)
+{
+	for (int i = 0; i < N; i++)
+		for (int j = 0; j < N; j++)
+		{
+			double s = 0.;
+			for (int k = 0; k < N; k++)
+				s += A[i*N+k]*(bt ? B[j*N+k] : B[k*N+j]);
+			C[i*N+j] = s;
+		}
+}
+
+// Solves A*X = B for X in place of B, with A symmetric positive definite.
+// False if A isn't, to the precision of a double.
+static bool solve(const double *A, double *B)
+{
+	double L[TRI];
+	for (int i = 0, n = 0; i < N; i++)
+		for (int j = i; j < N; j++)
+			L[n++] = A[i*N+j];
+	SymRef<N, double> LD(L);
+	if (ldl(LD, 1e-12) != LDL_OK)
+		return false;
+	ldl_solve(LD, Ref<N, N, double>(B));
+	return true;
+}
+
+// Smooths one stretch of steps in place of their state and covariance, and
+// adds up how far the filter was from it.
+static void smooth(std::vector<Step> &s, size_t from, FILE *out, Run &run)
+{
+	size_t n = s.size() - from;
+	if (n == 0)
+		return;
+	std::vector<double> xs(n*N), ps(n*N*N);
+	double P[N*N];
+	unpack(s.back().P, P);
+	for (int i = 0; i < N; i++)
+		xs[(n-1)*N+i] = s.back().x[i];
+	memcpy(&ps[(n-1)*N*N], P, sizeof(P));
+
+	// x(k|n) = x(k) + C*(x(k+1|n) - F*x(k)) and
+	// P(k|n) = P(k) + C*(P(k+1|n) - Pp)*C', where Pp = F*P(k)*F' + Q*dt is
+	// the prediction to k+1 and C = P(k)*F'*Pp^-1, found by solving
+	// Pp*C' = F*P(k).
+	for (size_t k = n-1; k-- > 0; )
+	{
+		const Step &a = s[from+k], &b = s[from+k+1];
+		double F[N*N], FP[N*N], Pp[N*N], Ct[N*N], C[N*N], D[N*N], E[N*N];
+		double dt = (int64_t)(b.time - a.time)/1000000.;
+		transition(dt, F);
+		unpack(a.P, P);
+		mul(F, P, false, FP);
+		mul(FP, F, true, Pp);
+		for (int i = 0; i < N*N; i++)
+			Pp[i] += Qk[i]*dt;
+		memcpy(Ct, FP, sizeof(Ct));
+		double xp[N], dx[N];
+		for (int i = 0; i < N; i++)
+		{
+			xp[i] = 0.;
+			for (int j = 0; j < N; j++)
+				xp[i] += F[i*N+j]*a.x[j];
+			dx[i] = xs[(k+1)*N+i] - xp[i];
+		}
+		if (!solve(Pp, Ct))
+		{
+			// Nothing to go on, so keep the filtered estimate.
+			for (int i = 0; i < N; i++)
+				xs[k*N+i] = a.x[i];
+			memcpy(&ps[k*N*N], P, sizeof(P));
+			continue;
+		}
+		for (int i = 0; i < N; i++)
+			for (int j = 0; j < N; j++)
+				C[i*N+j] = Ct[j*N+i];
+		for (int i = 0; i < N; i++)
+		{
+			xs[k*N+i] = a.x[i];
+			for (int j = 0; j < N; j++)
+				xs[k*N+i] += C[i*N+j]*dx[j];
+		}
+		for (int i = 0; i < N*N; i++)
+			D[i] = ps[(k+1)*N*N+i] - Pp[i];
+		mul(C, D, false, E);
+		mul(E, C, true, D);
+		for (int i = 0; i < N*N; i++)
+			ps[k*N*N+i] = P[i] + D[i];
+	}
+
+	for (size_t k = 0; k < n; k++)
+	{
+		const Step &a = s[from+k];
+		const double *x = &xs[k*N], *p = &ps[k*N*N];
+		double dp = hypot(a.x[0] - x[0], a.x[3] - x[3]);
+		double dv = hypot(a.x[1] - x[1], a.x[4] - x[4]);
+		run.pos_sum += dp*dp;
+		run.vel_sum += dv*dv;
+		run.pos_max = fmax(run.pos_max, dp);
+		run.vel_max = fmax(run.vel_max, dv);
+		run.steps++;
+		fprintf(out, "%.6f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,"
+				"%.4f,%.4f,%.4f,%.4f\n",
+				(a.time - EPOCH)/1000000., x[0], x[3], a.depth, x[1], x[4], x[6], x[7],
+				sqrt(fmax(p[0], 0.)), sqrt(fmax(p[3*N+3], 0.)),
+				a.x[0], a.x[3], a.x[1], a.x[4]);
+	}
+	s.erase(s.begin() + from, s.end());
+}
+
+static int hex(uint8_t c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+// Splits a log into records, as console lines or binary frames.
+static void records(const std::vector<uint8_t> &log, std::vector<std::vector<uint8_t> > &out,
+		long &bad)
+{
+	ProtoDecoder dec;
+	for (size_t i = 0; i < log.size(); i++)
+		if (dec.feed(log[i]) && dec.id == 'e')
+			out.push_back(std::vector<uint8_t>(dec.payload, dec.payload + dec.size));
+	for (size_t i = 0; i + 2 < log.size(); )
+	{
+		size_t end = i;
+		while (end < log.size() && log[end] != '\n')
+			end++;
+		size_t stop = end > i && log[end-1] == '\r' ? end - 1 : end;
+		if (log[i] == 'e' && log[i+1] == ' ')
+		{
+			std::vector<uint8_t> r;
+			bool ok = (stop - i) % 2 == 0;
+			for (size_t j = i + 2; ok && j < stop; j += 2)
+			{
+				int hi = hex(log[j]), lo = hex(log[j+1]);
+				ok = hi >= 0 && lo >= 0;
+				r.push_back(hi << 4 | lo);
+			}
+			if (ok)
+				out.push_back(r);
+			else
+				bad++;
+		}
+		i = end + 1;
+	}
+}
+
+static void replay(Run &run)
+{
+	run.ok = false;
+	FILE *f = fopen(run.path.c_str(), "rb");
+	if (!f)
+	{
+		run.error = errno;
+		return;
+	}
+	std::vector<uint8_t> log;
+	uint8_t buf[65536];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		log.insert(log.end(), buf, buf + n);
+	fclose(f);
+	std::vector<std::vector<uint8_t> > recs;
+	records(log, recs, run.bad);
+	log.clear();
+
+	FILE *out = fopen((run.path + ".csv").c_str(), "w");
+	if (!out)
+	{
+		run.error = errno;
+		return;
+	}
+	fprintf(out, "time,north,east,down,vel_north,vel_east,bias_surge,bias_sway,"
+			"std_north,std_east,filter_north,filter_east,filter_vel_north,"
+			"filter_vel_east\n");
+
+	Navigation nav;
+	std::vector<Step> s;
+	steps = &s;
+	nav.kalman.trace = trace;
+	nav.kalman.steady = false;
+	traced = &nav;
+	bool started = false;
+	size_t from = 0;
+	Sensor att, dvl;
+	for (size_t i = 0; i < recs.size(); i++)
+	{
+		NavRecord r;
+		if (!r.unpack(recs[i].data(), recs[i].size()))
+		{
+			run.bad++;
+			continue;
+		}
+		run.records++;
+		if (r.flags & NAV_STATE)
+		{
+			if (started)
+			{
+				trace(nav.kalman, nav.state, nav.covar);
+				smooth(s, from, out, run);
+			}
+			from = s.size();
+			nav.kalman.time = started ? widen(r.kalman_time, nav.kalman.time) :
+				EPOCH + r.kalman_time;
+			nav.kalman.valid = widen(r.kalman_valid, nav.kalman.time);
+			nav.kalman.blend = r.kalman_blend;
+			nav.origin[0] = 0;
+			nav.origin[1] = 0;
+			memcpy(nav.state, r.state, sizeof(nav.state));
+			memcpy(nav.covar, r.covar, sizeof(nav.covar));
+			started = true;
+			continue;
+		}
+		if (!started)
+			continue;
+
+		// A jump in the position isn't something the model can explain, so
+		// smooth either side of it separately.
+		if ((r.flags & NAV_ZERO) && s.size() > from)
+		{
+			trace(nav.kalman, nav.state, nav.covar);
+			smooth(s, from, out, run);
+			from = s.size();
+		}
+		if (r.flags & NAV_ZERO)
+			nav.zero();
+		if (r.flags & NAV_CLEAR)
+			nav.history.clear();
+		if (r.flags & NAV_AHRS)
+		{
+			att.time = widen(r.ahrs_time, nav.kalman.time);
+			att.prev = widen(r.ahrs_prev, att.time);
+			accel_g[SURGE] = r.accel[0];
+			accel_g[SWAY] = r.accel[1];
+			accel_g[HEAVE] = r.accel[2];
+		}
+		if (r.flags & NAV_DVL)
+		{
+			dvl.time = widen(r.dvl_time, nav.kalman.time);
+			dvl.prev = widen(r.dvl_prev, dvl.time);
+			dvl_fwd = r.dvl_vel[0];
+			dvl_stb = r.dvl_vel[1];
+		}
+		depth = r.depth;
+		nav.fuse(r.flags & NAV_AHRS, att, r.angles, r.flags & NAV_DVL, dvl);
+		if (r.flags & NAV_FORCE)
+		{
+			float forces[DOF] = { 0., 0., 0., 0., 0., 0. };
+			forces[F] = r.forces[0];
+			forces[H] = r.forces[1];
+			nav.force(r.force_time, forces);
+		}
+
+		run.ticks++;
+		if (memcmp(&nav.state[0], &r.check[0], 4) || memcmp(&nav.state[3], &r.check[1], 4))
+		{
+			run.mismatched++;
+			run.worst_mismatch = fmax(run.worst_mismatch, fmax(
+					fabs(nav.state[0] - r.check[0]), fabs(nav.state[3] - r.check[1])));
+		}
+	}
+	if (started)
+	{
+		trace(nav.kalman, nav.state, nav.covar);
+		smooth(s, from, out, run);
+	}
+	fclose(out);
+	run.ok = true;
+}
+
+int main(int argc, char **argv)
+{
+	int jobs = std::thread::hardware_concurrency();
+	int opt;
+	while ((opt = getopt(argc, argv, "j:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'j':
+			jobs = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-j jobs] log...\n", argv[0]);
+			return 1;
+		}
+	}
+	if (optind >= argc)
+	{
+		fprintf(stderr, "usage: %s [-j jobs] log...\n", argv[0]);
+		return 1;
+	}
+	if (jobs < 1)
+		jobs = 1;
+
+	std::vector<Run> runs(argc - optind);
+	for (size_t i = 0; i < runs.size(); i++)
+		runs[i].path = argv[optind + i];
+
+	// Each worker takes the next log nobody has started on.
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> workers;
+	for (int j = 0; j < jobs && j < (int)runs.size(); j++)
+		workers.push_back(std::thread([&]() {
+			for (size_t i; (i = next++) < runs.size(); )
+				replay(runs[i]);
+		}));
+	for (size_t j = 0; j < workers.size(); j++)
+		workers[j].join();
+
+	int failed = 0;
+	for (size_t i = 0; i < runs.size(); i++)
+	{
+		const Run &r = runs[i];
+		if (!r.ok)
+		{
+			fprintf(stderr, "%s: %s\n", r.path.c_str(), strerror(r.error));
+			failed++;
+			continue;
+		}
+		printf("%s: %ld records (%ld bad), %ld/%ld ticks match the sub",
+				r.path.c_str(), r.records, r.bad, r.ticks - r.mismatched, r.ticks);
+		if (r.mismatched)
+			printf(" (worst by %.2e m)", r.worst_mismatch);
+		if (r.steps)
+			printf(", filter - smoothed: position rms %.4f max %.4f m, "
+					"velocity rms %.4f max %.4f m/s",
+					sqrt(r.pos_sum/r.steps), r.pos_max,
+					sqrt(r.vel_sum/r.steps), r.vel_max);
+		printf("\n");
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file Arduino.h
+ *  @brief The part of the Arduino core Nautical uses, for running on Linux.
+ *
+ *  Only built into the simulator. Time comes from the simulator's virtual
+ *  clock, the pins read whatever the simulator last wrote to them, and Serial
+ *  is connected to the simulator's standard input and output.
+ */
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// Analog pins of the Mega.
+#define A0 54
+#define A1 55
+#define A2 56
+#define A3 57
+#define A4 58
+#define A5 59
+
+#define NUM_PINS 70
+
+// Clock of the ATmega2560 the code is written for.
+#define F_CPU 16000000UL
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define pgm_read_float(addr) (*(const float *)(addr))
+
+// Interrupts are delivered by the simulator between calls into the control
+// code, so there is never anything to mask.
+#define noInterrupts()
+#define interrupts()
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t micros(void);
+uint32_t millis(void);
+
+/** @brief Advances the virtual clock, since nothing else would.
+ */
+void delay(uint32_t ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+#ifdef __cplusplus
+}
+
+class Print
+{
+public:
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t *buf, size_t n);
+	size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+	size_t write(const char *buf, size_t n) { return write((const uint8_t *)buf, n); }
+	virtual int availableForWrite() { return 0; }
+
+	size_t print(const char *s) { return write(s); }
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(unsigned char v, int base = DEC) { return print((unsigned long)v, base); }
+	size_t print(int v, int base = DEC) { return print((long)v, base); }
+	size_t print(unsigned int v, int base = DEC) { return print((unsigned long)v, base); }
+	size_t print(long v, int base = DEC);
+	size_t print(unsigned long v, int base = DEC);
+	size_t print(double v, int digits = 2);
+
+	size_t println() { return write("\r\n"); }
+	template<class T> size_t println(T v) { return print(v) + println(); }
+	template<class T> size_t println(T v, int f) { return print(v, f) + println(); }
+
+	virtual ~Print() {}
+};
+
+class Stream : public Print
+{
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+};
+
+/** @brief A serial port whose input is fed by the simulator and whose output
+ *         goes to standard output.
+ *
+ *  Transmission is paced at the baud rate in virtual time, so
+ *  availableForWrite() runs out when something sends faster than the real
+ *  port could.
+ */
+/** Size of the serial transmit buffer, which holds one byte less than this,
+ *  as on the AVR.
+ */
+#define SERIAL_TX_BUFFER_SIZE 64
+
+class HardwareSerial : public Stream
+{
+public:
+	HardwareSerial();
+	void begin(unsigned long baud);
+	void end() {}
+	void flush();
+	int available();
+	int read();
+	int peek();
+	int availableForWrite();
+	size_t write(uint8_t c);
+	using Print::write;
+
+	/** @brief Queues bytes as if the topside had sent them.
+	 */
+	void receive(const char *buf, size_t n);
+
+private:
+	unsigned long baud;
+	char rx[256];
+	size_t head, tail;
+	float txq;
+	uint64_t txt;
+	void drain();
+};
+
+extern HardwareSerial Serial;
+
+#endif
+
+#endif
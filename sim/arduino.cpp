@@ -0,0 +1,218 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+#include <stdio.h>
+#include <Arduino.h>
+#include "sim.h"
+
+
+HardwareSerial Serial;
+
+static uint64_t clock_us;
+
+static int pins[NUM_PINS];
+
+
+void sim_clock_set(uint64_t us)
+{
+	clock_us = us;
+}
+
+uint64_t sim_clock()
+{
+	return clock_us;
+}
+
+void sim_pin_set(uint8_t pin, int val)
+{
+	if (pin < NUM_PINS)
+		pins[pin] = val;
+}
+
+uint32_t micros()
+{
+	return (uint32_t)clock_us;
+}
+
+uint32_t millis()
+{
+	return (uint32_t)(clock_us/1000);
+}
+
+void delay(uint32_t ms)
+{
+	clock_us += 1000ULL*ms;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	clock_us += us;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	(void)pin;
+	(void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+	(void)pin;
+	(void)val;
+}
+
+int digitalRead(uint8_t pin)
+{
+	return pin < NUM_PINS ? pins[pin] : LOW;
+}
+
+int analogRead(uint8_t pin)
+{
+	return pin < NUM_PINS ? pins[pin] : 0;
+}
+
+
+size_t Print::write(const uint8_t *buf, size_t n)
+{
+	size_t m = 0;
+	while (n--)
+		m += write(*buf++);
+	return m;
+}
+
+size_t Print::print(long v, int base)
+{
+	if (base == DEC)
+	{
+		char s[24];
+		snprintf(s, sizeof(s), "%ld", v);
+		return write(s);
+	}
+	return print((unsigned long)v, base);
+}
+
+size_t Print::print(unsigned long v, int base)
+{
+	char s[8*sizeof(long) + 1];
+	char *c = &s[sizeof(s) - 1];
+	*c = '\0';
+	if (base < 2)
+		base = 10;
+	do
+	{
+		int d = v % base;
+		*--c = d < 10 ? '0' + d : 'A' + d - 10;
+		v /= base;
+	} while (v);
+	return write(c);
+}
+
+size_t Print::print(double v, int digits)
+{
+	char s[48];
+	snprintf(s, sizeof(s), "%.*f", digits, v);
+	return write(s);
+}
+
+
+// What the transmit buffer holds, one byte less than its size.
+#define TX_BUFFER (SERIAL_TX_BUFFER_SIZE - 1)
+
+HardwareSerial::HardwareSerial()
+{
+	this->baud = 9600;
+	this->head = 0;
+	this->tail = 0;
+	this->txq = 0.;
+	this->txt = 0;
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+	drain();
+	this->baud = baud;
+}
+
+// Empties the transmit buffer at 10 bits per byte for the time since the last
+// call.
+void HardwareSerial::drain()
+{
+	txq -= (clock_us - txt)*1e-6f*baud/10.f;
+	if (txq < 0.)
+		txq = 0.;
+	txt = clock_us;
+}
+
+void HardwareSerial::flush()
+{
+	fflush(stdout);
+	clock_us += (uint64_t)(txq*10.e6f/baud);
+	drain();
+}
+
+int HardwareSerial::available()
+{
+	return (int)((head - tail) % sizeof(rx));
+}
+
+int HardwareSerial::read()
+{
+	if (head == tail)
+		return -1;
+	int c = (unsigned char)rx[tail];
+	tail = (tail + 1) % sizeof(rx);
+	return c;
+}
+
+int HardwareSerial::peek()
+{
+	return head == tail ? -1 : (unsigned char)rx[tail];
+}
+
+int HardwareSerial::availableForWrite()
+{
+	drain();
+	return txq < TX_BUFFER ? (int)(TX_BUFFER - txq) : 0;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+	drain();
+	txq += 1.;
+	putchar(c);
+	return 1;
+}
+
+void HardwareSerial::receive(const char *buf, size_t n)
+{
+	// Like the Arduino core, bytes that don't fit are dropped.
+	for (size_t i = 0; i < n; i++)
+	{
+		size_t next = (head + 1) % sizeof(rx);
+		if (next == tail)
+			break;
+		rx[head] = buf[i];
+		head = next;
+	}
+}
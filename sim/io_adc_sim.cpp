@@ -0,0 +1,77 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/**
+ * Stands in for io_adc_avr.cpp. The simulator advances its clock and then
+ * has the conversions delivered that timer 0 would have triggered in that
+ * time, reading the simulated pins.
+ */
+#include <assert.h>
+#include <stdint.h>
+#include <Arduino.h>
+
+#include "io_adc.h"
+#include "sim.h"
+
+
+#define MAX_CHANNELS 16
+#define PERIOD 1024
+
+
+static void (*handler_adc)(uint8_t idx, uint16_t val);
+
+static uint8_t scan[MAX_CHANNELS];
+static uint8_t num_scan;
+static uint8_t current;
+static uint64_t next;
+
+
+void io_adc_start(uint8_t const *channels, uint8_t n,
+		void (*handler)(uint8_t idx, uint16_t val))
+{
+	assert(handler && n && n <= MAX_CHANNELS);
+	for (uint8_t i = 0; i < n; i++)
+		scan[i] = channels[i];
+	num_scan = n;
+	handler_adc = handler;
+	current = 0;
+	next = sim_clock() + PERIOD;
+	return;
+}
+
+void io_adc_stop()
+{
+	handler_adc = 0;
+	return;
+}
+
+void io_adc_sim_advance(uint64_t us)
+{
+	for (; handler_adc && next <= us; next += PERIOD)
+	{
+		uint8_t idx = current;
+		current = idx + 1 < num_scan ? idx + 1 : 0;
+		handler_adc(idx, analogRead(A0 + scan[idx]));
+	}
+}
@@ -0,0 +1,155 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/**
+ * Stands in for io_ahrs_avr.c. The usart is a single byte receive register
+ * that the simulator fills before calling the receive handler, just like the
+ * Receive Complete Interrupt. Everything sent to the AHRS is discarded, since
+ * the simulated one always streams the components Nautical asks for.
+ *
+ * Interrupts are only ever raised between calls into the control code, so the
+ * triple buffer needs none of the masking the avr version does.
+ */
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "ahrs/io_ahrs.h"
+#include "macrodef.h"
+#include "sim.h"
+
+
+static int (*handler_ahrs_recv)();
+
+static int udr = EOF; // receive register, EOF when empty
+static uint32_t recv_time;
+
+
+static ssize_t sim_ahrs_read(void *cookie, char *buf, size_t size)
+{
+	(void)cookie;
+	if (udr == EOF || !size)
+		return 0;
+	buf[0] = (char)udr;
+	udr = EOF;
+	return 1;
+}
+
+static ssize_t sim_ahrs_write(void *cookie, char const *buf, size_t size)
+{
+	(void)cookie;
+	(void)buf;
+	return size;
+}
+
+
+FILE *io_ahrs;
+
+
+void io_ahrs_init(char const *path)
+{
+	(void)path;
+	cookie_io_functions_t funcs = {sim_ahrs_read, sim_ahrs_write, NULL, NULL};
+	io_ahrs = fopencookie(NULL, "r+", funcs);
+	assert(io_ahrs);
+	setvbuf(io_ahrs, NULL, _IONBF, 0);
+	return;
+}
+
+void io_ahrs_clean()
+{
+	return;
+}
+
+void io_ahrs_sim_receive(unsigned char c)
+{
+	// A byte arriving while the interrupt is disabled is lost, as it would be
+	// in the usart.
+	if (!handler_ahrs_recv)
+		return;
+	udr = c;
+	recv_time = (uint32_t)sim_clock();
+	clearerr(io_ahrs);
+	handler_ahrs_recv();
+}
+
+uint32_t io_ahrs_recv_time()
+{
+	return recv_time;
+}
+
+int io_ahrs_recv_start(int (*handler)())
+{
+	handler_ahrs_recv = handler;
+	return 0;
+}
+
+void io_ahrs_recv_stop()
+{
+	handler_ahrs_recv = NULL;
+	return;
+}
+
+// See io_ahrs_avr.c
+static struct
+{
+	unsigned char write;
+	unsigned char clean;
+	unsigned char read;
+	unsigned char new;
+} tripbuf = {0, 1, 2, false};
+
+bool io_ahrs_tripbuf_update()
+{
+	assert(IN_RANGE(0, tripbuf.write, 2) && IN_RANGE(0, tripbuf.clean, 2) &&
+			IN_RANGE(0, tripbuf.read, 2) && IN_RANGE (0, tripbuf.new, 1));
+	if (tripbuf.new)
+	{
+		tripbuf.new = false;
+		unsigned char tmp = tripbuf.read;
+		tripbuf.read = tripbuf.clean;
+		tripbuf.clean = tmp;
+		return true;
+	}
+	return false;
+}
+
+void io_ahrs_tripbuf_offer()
+{
+	unsigned char tmp = tripbuf.write;
+	tripbuf.write = tripbuf.clean;
+	tripbuf.clean = tmp;
+	tripbuf.new = true;
+}
+
+unsigned char io_ahrs_tripbuf_write()
+{
+	return tripbuf.write;
+}
+
+unsigned char io_ahrs_tripbuf_read()
+{
+	return tripbuf.read;
+}
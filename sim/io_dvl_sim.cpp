@@ -0,0 +1,146 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/**
+ * Stands in for io_dvl_avr.cpp. See io_ahrs_sim.c, which works the same way,
+ * except that what is sent to the DVL is passed on to the simulator so it can
+ * start and stop pinging like the real one.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "dvl/io_dvl.h"
+#include "macrodef.h"
+#include "sim.h"
+
+
+static bool (*io_dvl_recv_handler)();
+
+static int udr = EOF;
+static uint32_t recv_time;
+
+
+static ssize_t sim_dvl_read(void *cookie, char *buf, size_t size)
+{
+	(void)cookie;
+	if (udr == EOF || !size)
+		return 0;
+	buf[0] = (char)udr;
+	udr = EOF;
+	return 1;
+}
+
+static ssize_t sim_dvl_write(void *cookie, char const *buf, size_t size)
+{
+	(void)cookie;
+	for (size_t i = 0; i < size; i++)
+		sim_dvl_transmit(buf[i]);
+	return size;
+}
+
+FILE *io_dvl;
+
+void io_dvl_init(bool (*recv_handler)())
+{
+	assert(recv_handler);
+	io_dvl_recv_handler = recv_handler;
+	cookie_io_functions_t funcs = {sim_dvl_read, sim_dvl_write, NULL, NULL};
+	io_dvl = fopencookie(NULL, "r+", funcs);
+	assert(io_dvl);
+	setvbuf(io_dvl, NULL, _IONBF, 0);
+	return;
+}
+
+void io_dvl_clean()
+{
+	return;
+}
+
+static bool receiving = false;
+
+void io_dvl_sim_receive(unsigned char c)
+{
+	if (!receiving)
+		return;
+	udr = c;
+	recv_time = (uint32_t)sim_clock();
+	clearerr(io_dvl);
+	io_dvl_recv_handler();
+}
+
+uint32_t io_dvl_recv_time()
+{
+	return recv_time;
+}
+
+void io_dvl_recv_begin()
+{
+	receiving = true;
+	return;
+}
+
+void io_dvl_recv_end()
+{
+	receiving = false;
+	return;
+}
+
+static struct {
+	uint8_t write;
+	uint8_t clean;
+	uint8_t read;
+	uint8_t new_data;
+} tripbuf = { 0, 1, 2, false};
+
+bool io_dvl_tripbuf_update()
+{
+	assert(IN_RANGE(0, tripbuf.write, 2) && IN_RANGE(0, tripbuf.clean, 2) &&
+	IN_RANGE(0, tripbuf.read, 2) && IN_RANGE(0, tripbuf.new_data, 1));
+	if (tripbuf.new_data) {
+		tripbuf.new_data = false;
+		uint8_t tmp = tripbuf.read;
+		tripbuf.read = tripbuf.clean;
+		tripbuf.clean = tmp;
+		return true;
+	}
+	return false;
+}
+
+void io_dvl_tripbuf_offer()
+{
+	uint8_t tmp = tripbuf.write;
+	tripbuf.write = tripbuf.clean;
+	tripbuf.clean = tmp;
+	tripbuf.new_data = true;
+	return;
+}
+
+uint8_t io_dvl_tripbuf_get_write_idx() {
+	return tripbuf.write;
+}
+
+uint8_t io_dvl_tripbuf_get_read_idx() {
+	return tripbuf.read;
+}
@@ -0,0 +1,147 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/**
+ * Stands in for io_m5_avr.c. On the avr, the Data Register Empty Interrupt
+ * keeps calling the transmission handler until io_m5_trans_trywait pauses it
+ * at the end of a packet with nothing new to send. Here offering new data runs
+ * the handler straight away until it pauses, so every packet reaches the
+ * simulated thrusters in full before the control code carries on.
+ */
+#define _GNU_SOURCE
+#include <assert.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "m5/io_m5.h"
+#include "macrodef.h"
+#include "sim.h"
+
+
+static int (*handler_m5_trans)();
+
+static bool transmitting = false;
+
+
+static ssize_t sim_m5_read(void *cookie, char *buf, size_t size)
+{
+	(void)cookie;
+	(void)buf;
+	(void)size;
+	return 0;
+}
+
+static ssize_t sim_m5_write(void *cookie, char const *buf, size_t size)
+{
+	(void)cookie;
+	for (size_t i = 0; i < size; i++)
+		sim_m5_transmit(buf[i]);
+	return size;
+}
+
+
+FILE *io_m5;
+
+
+void io_m5_init(char const *path)
+{
+	(void)path;
+	cookie_io_functions_t funcs = {sim_m5_read, sim_m5_write, NULL, NULL};
+	io_m5 = fopencookie(NULL, "r+", funcs);
+	assert(io_m5);
+	setvbuf(io_m5, NULL, _IONBF, 0);
+	return;
+}
+
+void io_m5_clean()
+{
+	return;
+}
+
+int io_m5_trans_set(int (*handler)())
+{
+	handler_m5_trans = handler;
+	return 0;
+}
+
+// See io_m5_avr.c
+static struct
+{
+	unsigned char write;
+	unsigned char clean;
+	unsigned char read;
+	unsigned char new;
+} tripbuf = {0, 1, 2, false};
+
+void io_m5_trans_trywait()
+{
+	if (!tripbuf.new)
+		transmitting = false;
+	return;
+}
+
+void io_m5_trans_stop()
+{
+	transmitting = false;
+	return;
+}
+
+void io_m5_tripbuf_offer_resume()
+{
+	assert(handler_m5_trans);
+	unsigned char tmp = tripbuf.write;
+	tripbuf.write = tripbuf.clean;
+	tripbuf.clean = tmp;
+	tripbuf.new = true;
+
+	transmitting = true;
+	while (transmitting)
+		handler_m5_trans();
+	return;
+}
+
+bool io_m5_tripbuf_update()
+{
+	assert(IN_RANGE(0, tripbuf.write, 2) && IN_RANGE(0, tripbuf.clean, 2) &&
+			IN_RANGE(0, tripbuf.read, 2) && IN_RANGE (0, tripbuf.new, 1));
+	if (tripbuf.new)
+	{
+		tripbuf.new = false;
+		unsigned char tmp = tripbuf.read;
+		tripbuf.read = tripbuf.clean;
+		tripbuf.clean = tmp;
+		return true;
+	}
+	return false;
+}
+
+unsigned char io_m5_tripbuf_write()
+{
+	return tripbuf.write;
+}
+
+unsigned char io_m5_tripbuf_read()
+{
+	return tripbuf.read;
+}
@@ -22,33 +22,26 @@
  * SOFTWARE.
  * ========================================================================== */
 
-#include "pid.hpp"
-#include "util.hpp"
+/**
+ * Stands in for io_profile_avr.cpp. Cycles are counted off the simulator's
+ * virtual clock, at the rate the ATmega2560 runs at.
+ */
+#ifdef PROFILE
+
+#include <Arduino.h>
 
+#include "io_profile.h"
+#include "sim.h"
 
-float PID::init(float a, float b, float c)
+
+void io_profile_start()
 {
-	this->kp = a;
-	this->ki = b;
-	this->kd = c;
-	this->prev = 0.0;
-	this->sum = 0.0;
+	return;
 }
 
-/*
- * IMPORTANT: Make sure DT isn't 0, will cause motors to send NAN.
- */
-float PID::calculate(float error, float dt, float min)
+uint32_t io_profile_cycles()
 {
-	float pout = this->kp*error;
-	this->sum += error*dt;
-	float iout = this->ki*this->sum;
-	float dout = this->kd*(error-this->prev)/dt;
-	this->prev = error;
-	float output = pout + iout + dout;
-	float dir = 1.;
-	if (output < 0) dir = -1.;
-
-	float out = limit(limit(output, -2., 2.), min);
-	return out;
+	return (uint32_t)(sim_clock()*(F_CPU/1000000UL));
 }
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/**
+ * Stands in for io_sched_avr.cpp. The simulator advances its clock and then
+ * has the ticks delivered that the timer would have raised in that time.
+ */
+#include <assert.h>
+#include <stdint.h>
+
+#include "io_sched.h"
+#include "sim.h"
+
+
+static void (*handler_sched)();
+
+static uint64_t period;
+static uint64_t next;
+
+
+void io_sched_start(unsigned int hz, void (*handler)())
+{
+	assert(handler && hz);
+	handler_sched = handler;
+	period = 1000000ULL/hz;
+	next = sim_clock() + period;
+	return;
+}
+
+void io_sched_stop()
+{
+	handler_sched = 0;
+	return;
+}
+
+void io_sched_sim_advance(uint64_t us)
+{
+	while (handler_sched && next <= us)
+	{
+		// Run the handler with the clock at the tick, not where it ended up.
+		uint64_t now = sim_clock();
+		sim_clock_set(next);
+		handler_sched();
+		sim_clock_set(now);
+		next += period;
+	}
+}
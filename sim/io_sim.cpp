@@ -0,0 +1,134 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/**
+ * Stands in for io.cpp and servo.cpp. Brings up the simulated hardware the
+ * same way, except that the DVL is not sent its setup commands. It is always
+ * in the right data format, and dvl_set_data_format() would spin waiting for
+ * a prompt that can only arrive from an interrupt.
+ */
+#include <Arduino.h>
+#include "adc.hpp"
+#include "config.h"
+#include "ahrs/ahrs.h"
+#include "ahrs/io_ahrs.h"
+#include "m5/io_m5.h"
+#include "m5/m5.h"
+#include "dvl/io_dvl.h"
+#include "dvl/dvl.h"
+#include "io.hpp"
+
+
+ServoTimer2 dropper1;
+ServoTimer2 dropper2;
+
+static int pulses[NBR_CHANNELS + 1];
+static uint8_t channels;
+
+
+ServoTimer2::ServoTimer2()
+{
+	this->chanIndex = 0;
+}
+
+uint8_t ServoTimer2::attach(int pin)
+{
+	(void)pin;
+	if (!chanIndex && channels < NBR_CHANNELS)
+	{
+		chanIndex = ++channels;
+		pulses[chanIndex] = DEFAULT_PULSE_WIDTH;
+	}
+	return chanIndex;
+}
+
+uint8_t ServoTimer2::attach(int pin, int min, int max)
+{
+	(void)min;
+	(void)max;
+	return attach(pin);
+}
+
+void ServoTimer2::detach()
+{
+	chanIndex = 0;
+}
+
+void ServoTimer2::write(int pulsewidth)
+{
+	pulses[chanIndex] = pulsewidth;
+}
+
+int ServoTimer2::read()
+{
+	return pulses[chanIndex];
+}
+
+boolean ServoTimer2::attached()
+{
+	return chanIndex != 0;
+}
+
+
+void io()
+{
+	io_ahrs_init("");
+	ahrs_set_datacomp();
+	ahrs_cont_start();
+	io_ahrs_recv_start(ahrs_att_recv);
+
+	pinMode(KILL_PIN, INPUT);
+	pinMode(DEPTH_PIN, INPUT);
+	adc_start();
+
+	dropper1.attach(6);
+	dropper2.attach(7);
+	dropper1.write(2700);
+	dropper2.write(2700);
+
+	if (DVL_ON)
+	{
+		io_dvl_init(dvl_receive_handler);
+		io_dvl_recv_begin();
+		dvl_begin_pinging();
+	}
+
+	io_m5_init("");
+	io_m5_trans_set(m5_power_trans);
+}
+
+void drop(int idx, int val)
+{
+	ServoTimer2 &dropper = idx == 0 ? dropper1 : dropper2;
+	if (idx != 0 && idx != 1)
+		return;
+	if (val == 0) dropper.write(2400);
+	if (val == 1) dropper.write(700);
+}
+
+bool alive()
+{
+	if (SIM) return true;
+	return digitalRead(KILL_PIN) ? false : true;
+}
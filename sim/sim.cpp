@@ -0,0 +1,503 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file sim.cpp
+ *  @brief Software in the loop simulator.
+ *
+ *  Runs the control code (setup() and loop() from main.cpp, with Kalman, PID
+ *  and Motors) unmodified against the vehicle model. The AHRS, DVL and depth
+ *  sensor readings are synthesized from the model and delivered through the
+ *  real parsers as the bytes the sensors would send, and the thrust comes back
+ *  as M5 packets. Everything runs on a virtual clock in 1 ms steps, so it is
+ *  as fast as the host allows.
+ *
+ *  Usage: sim [-t seconds] [-s seed] [-l truth.csv] [script]
+ *
+ *  Each line of the script is a time in seconds followed by a command, which
+ *  is sent to the sub as if typed topside, eg "6 s 3 0 1 0 0 0". The commands
+ *  "!kill" and "!unkill" flip the kill switch. The switch is flipped to alive
+ *  one second in. "!lost" has the DVL report its error velocity, as it does
+ *  when it loses the bottom, until "!found". "!bias u v" offsets the
+ *  accelerometer's surge and sway readings by u and v g from then on.
+ *  "!spikes p" has each DVL ping and depth sample from then on wildly off
+ *  with probability p, "!spikes 0" to stop. The sub's output goes to
+ *  standard output, and -l logs the true state of the vehicle at 50 Hz.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <Arduino.h>
+#include "config.h"
+#include "io.hpp"
+extern "C" {
+#include "ahrs/crc_xmodem.h"
+}
+#include "vehicle.hpp"
+#include "sim.h"
+
+void setup();
+void loop();
+
+
+// Virtual time step of the loop and of the vehicle model.
+#define STEP_US 1000ULL
+
+// Sensor rates in Hz.
+#define AHRS_RATE 30
+#define DVL_RATE 8
+#define DEPTH_RATE 100
+#define LOG_RATE 50
+
+// Serial links. Bytes reach the drivers one 10 bit frame apart, so the last
+// byte of a datagram arrives well after the sample in it was taken, which is
+// what AHRS_LATENCY and DVL_LATENCY make up for.
+#define AHRS_BAUD 38400
+#define DVL_BAUD 9600
+
+// Measurement noise standard deviations.
+#define ANGLE_NOISE 0.2 // degrees
+#define ACCEL_NOISE 0.01 // g
+#define VELOCITY_NOISE 0.005 // m/s
+#define RANGE_NOISE 0.01 // m
+#define DEPTH_NOISE 1. // adc counts
+
+// Velocity the DVL reports when it has no bottom lock, -32.768 m/s in um/s.
+#define DVL_ERROR (-3276800)
+
+// The DVL is mounted 45 degrees off the bow, see Kalman::compute.
+#define DVL_MOUNT (45.*M_PI/180.)
+
+#define BATTERY 16. // volts
+
+#define MAX_EVENTS 256
+
+struct Event
+{
+	double time;
+	char text[64];
+};
+
+// Bytes on their way over a serial link.
+struct Wire
+{
+	void (*receive)(unsigned char c);
+	uint64_t frame; // microseconds per byte
+	unsigned char buf[128];
+	size_t head, len;
+	uint64_t next; // when buf[head] arrives
+};
+
+static Vehicle vehicle;
+
+static Wire ahrs_wire = { io_ahrs_sim_receive, 10000000ULL/AHRS_BAUD, { 0 },
+	0, 0, 0 };
+static Wire dvl_wire = { io_dvl_sim_receive, 10000000ULL/DVL_BAUD, { 0 },
+	0, 0, 0 };
+
+static Event events[MAX_EVENTS];
+static int num_events;
+
+static bool dvl_pinging;
+static bool dvl_lost;
+static double accel_bias[2];
+static double spike_rate;
+
+static uint32_t seed = 1;
+
+
+// xorshift32 and Box-Muller. Reproducible for a given seed, unlike rand().
+static double uniform()
+{
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return (seed + 1.)/4294967297.;
+}
+
+static double noise(double sd)
+{
+	return sd*sqrt(-2.*log(uniform()))*cos(2.*M_PI*uniform());
+}
+
+// A glitch from lo to hi either way.
+static double spike(double lo, double hi)
+{
+	double x = lo + (hi - lo)*uniform();
+	return uniform() < 0.5 ? -x : x;
+}
+
+static void put_float_be(unsigned char *b, float f)
+{
+	uint32_t u;
+	memcpy(&u, &f, 4);
+	for (int i = 0; i < 4; i++)
+		b[i] = u >> (24 - 8*i);
+}
+
+static void put_int32_le(unsigned char *b, int32_t v)
+{
+	for (int i = 0; i < 4; i++)
+		b[i] = (uint32_t)v >> 8*i;
+}
+
+// Starts sending a datagram, after whatever is still going out.
+static void wire_send(Wire *w, const unsigned char *b, size_t n)
+{
+	if (w->len == 0)
+	{
+		w->head = 0;
+		w->next = sim_clock() + w->frame;
+	}
+	else if (w->head + w->len + n > sizeof(w->buf))
+	{
+		memmove(w->buf, &w->buf[w->head], w->len);
+		w->head = 0;
+	}
+	assert(w->head + w->len + n <= sizeof(w->buf));
+	memcpy(&w->buf[w->head + w->len], b, n);
+	w->len += n;
+}
+
+// Hands the driver every byte that has arrived by now.
+static void wire_advance(Wire *w, uint64_t now)
+{
+	for (; w->len && w->next <= now; w->next += w->frame)
+	{
+		w->receive(w->buf[w->head++]);
+		w->len--;
+	}
+}
+
+// Accelerations summed over every model step since the last AHRS sample.
+// The AHRS filters its accelerometer down to its output rate, and sampling
+// the thrusters' chatter instead would alias it into a bias.
+static double ahrs_sum[3];
+static int ahrs_steps;
+
+// Body velocities summed over every model step since the last ping, since
+// the DVL reports the average over the ping rather than where it ended.
+static double dvl_sum[2];
+static int dvl_steps;
+
+// A kGetDataResp datagram with the components ahrs_set_datacomp() asks for.
+static void send_ahrs()
+{
+	static const unsigned char ids[6] = { 5, 24, 25, 21, 22, 23 };
+	float heading = vehicle.pose[Y]*180./M_PI + noise(ANGLE_NOISE);
+	float vals[6] = {
+		heading < 0. ? heading + 360.f : heading >= 360. ? heading - 360.f : heading,
+		(float)(vehicle.pose[P]*180./M_PI + noise(ANGLE_NOISE)),
+		(float)(vehicle.pose[R]*180./M_PI + noise(ANGLE_NOISE)),
+		(float)(ahrs_sum[F]/ahrs_steps/9.81 + accel_bias[0] + noise(ACCEL_NOISE)),
+		(float)(ahrs_sum[H]/ahrs_steps/9.81 + accel_bias[1] + noise(ACCEL_NOISE)),
+		(float)(ahrs_sum[V]/ahrs_steps/9.81 + noise(ACCEL_NOISE)),
+	};
+
+	unsigned char b[38] = { 0x00, 38, 0x05, 7 };
+	size_t n = 4;
+	for (int i = 0; i < 6; i++)
+	{
+		b[n++] = ids[i];
+		put_float_be(&b[n], vals[i]);
+		n += 4;
+	}
+	b[n++] = 79; // kHeadingStatus
+	b[n++] = 1;
+	uint16_t crc = CRC_XMODEM_INIT_VAL;
+	for (size_t i = 0; i < n; i++)
+		crc = crc_xmodem_update(crc, b[i]);
+	b[n++] = crc >> 8;
+	b[n++] = crc & 0xFF;
+
+	wire_send(&ahrs_wire, b, n);
+}
+
+// A datagram with a velocity frame and a range frame, laid out the way
+// parse_velocities expects.
+static void send_dvl()
+{
+	double u = dvl_sum[F]/dvl_steps + noise(VELOCITY_NOISE);
+	double v = dvl_sum[H]/dvl_steps + noise(VELOCITY_NOISE);
+	double range = POOL_DEPTH - vehicle.pose[V] + noise(RANGE_NOISE);
+	if (spike_rate > 0. && uniform() < spike_rate)
+	{
+		u += spike(0.5, 3.);
+		v += spike(0.5, 3.);
+		range += spike(1., 3.);
+	}
+	double t1 = cos(DVL_MOUNT)*u + sin(DVL_MOUNT)*v;
+	double t2 = -sin(DVL_MOUNT)*u + cos(DVL_MOUNT)*v;
+
+	unsigned char b[34] = { 0x7f, 0x7f, 34, 0, 0, 4, 14, 0, 28, 0 };
+	b[14] = 0x03;
+	b[15] = 0x58;
+	put_int32_le(&b[16], dvl_lost ? DVL_ERROR : (int32_t)(t2*100000.));
+	put_int32_le(&b[20], dvl_lost ? DVL_ERROR : (int32_t)(t1*100000.));
+	put_int32_le(&b[24], dvl_lost ? DVL_ERROR : (int32_t)(-vehicle.vel[V]*100000.));
+	b[28] = 0x04;
+	b[29] = 0x58;
+	put_int32_le(&b[30], (int32_t)(range*10000.));
+
+	wire_send(&dvl_wire, b, sizeof(b));
+}
+
+// Starts pinging on "cs" and stops on a break, ignoring everything else.
+void sim_dvl_transmit(unsigned char c)
+{
+	static char line[16];
+	static size_t len;
+	if (c == '\r' || c == '\n')
+	{
+		line[len] = '\0';
+		if (!strcasecmp(line, "cs"))
+			dvl_pinging = true;
+		len = 0;
+		return;
+	}
+	if (len < sizeof(line) - 1)
+		line[len++] = c;
+	if (len >= 3 && !strncmp(&line[len - 3], "===", 3))
+	{
+		dvl_pinging = false;
+		len = 0;
+	}
+}
+
+// Picks the thruster powers out of Propulsion Command packets. See m5.c.
+void sim_m5_transmit(unsigned char c)
+{
+	static unsigned char pkt[12 + 4*NUM_THRUSTERS + 4];
+	static size_t len;
+	if ((len == 0 && c != 0xF5) || (len == 1 && c != 0x5F))
+	{
+		len = c == 0xF5;
+		pkt[0] = c;
+		return;
+	}
+	pkt[len++] = c;
+	if (len < sizeof(pkt))
+		return;
+	len = 0;
+	if (pkt[10] != 0xAA)
+		return;
+	for (int i = 0; i < NUM_MOTORS; i++)
+		memcpy(&vehicle.power[i], &pkt[12 + 4*(i + 1)], 4);
+}
+
+static void set_kill(bool dead)
+{
+	sim_pin_set(KILL_PIN, dead ? HIGH : LOW);
+	vehicle.powered = !dead;
+}
+
+static void load(const char *path)
+{
+	FILE *f = strcmp(path, "-") ? fopen(path, "r") : stdin;
+	if (!f)
+	{
+		perror(path);
+		exit(1);
+	}
+	char line[80];
+	while (num_events < MAX_EVENTS && fgets(line, sizeof(line), f))
+	{
+		Event &e = events[num_events];
+		int n = 0;
+		if (line[0] == '#' || sscanf(line, "%lf %n", &e.time, &n) != 1)
+			continue;
+		strncpy(e.text, &line[n], sizeof(e.text) - 1);
+		e.text[strcspn(e.text, "\r\n")] = '\0';
+		if (e.text[0])
+			num_events++;
+	}
+	if (f != stdin)
+		fclose(f);
+
+	// Stable sort by time, so the script doesn't have to be in order.
+	for (int i = 1; i < num_events; i++)
+	{
+		Event e = events[i];
+		int j = i;
+		for (; j > 0 && events[j - 1].time > e.time; j--)
+			events[j] = events[j - 1];
+		events[j] = e;
+	}
+}
+
+static void run_events(uint64_t now)
+{
+	static int next;
+	for (; next < num_events && events[next].time*1e6 <= now; next++)
+	{
+		const char *t = events[next].text;
+		if (!strcmp(t, "!kill"))
+			set_kill(true);
+		else if (!strcmp(t, "!unkill"))
+			set_kill(false);
+		else if (!strcmp(t, "!lost"))
+			dvl_lost = true;
+		else if (!strcmp(t, "!found"))
+			dvl_lost = false;
+		else if (!strncmp(t, "!bias", 5))
+			sscanf(t, "!bias %lf %lf", &accel_bias[0], &accel_bias[1]);
+		else if (!strncmp(t, "!spikes", 7))
+			sscanf(t, "!spikes %lf", &spike_rate);
+		else
+		{
+			Serial.receive(t, strlen(t));
+			Serial.receive("\n", 1);
+		}
+	}
+}
+
+static void log_truth(FILE *f, uint64_t now)
+{
+	fprintf(f, "%.3f", now*1e-6);
+	for (int i = 0; i < DOF; i++)
+		fprintf(f, ",%.4f", i < BODY_DOF ? vehicle.pose[i] : vehicle.pose[i]*180./M_PI);
+	for (int i = 0; i < DOF; i++)
+		fprintf(f, ",%.4f", vehicle.vel[i]);
+	for (int i = 0; i < NUM_MOTORS; i++)
+		fprintf(f, ",%.3f", vehicle.power[i]);
+	fprintf(f, "\n");
+}
+
+static double wall()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+int main(int argc, char **argv)
+{
+	double seconds = 60.;
+	FILE *truth = NULL;
+	int opt;
+	while ((opt = getopt(argc, argv, "t:s:l:")) != -1)
+	{
+		switch (opt)
+		{
+		case 't':
+			seconds = atof(optarg);
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0) | 1;
+			break;
+		case 'l':
+			if ((truth = fopen(optarg, "w")))
+				break;
+			perror(optarg);
+			return 1;
+		default:
+			fprintf(stderr, "usage: %s [-t seconds] [-s seed] [-l truth.csv] [script]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// The diver flips the kill switch once the sub is in the water.
+	events[num_events].time = 1.;
+	strcpy(events[num_events++].text, "!unkill");
+	if (optind < argc)
+		load(argv[optind]);
+	if (truth)
+		fprintf(truth, "time,north,east,down,yaw,pitch,roll,surge,sway,heave,"
+				"yaw_rate,pitch_rate,roll_rate,m1,m2,m3,m4,m5,m6,m7,m8\n");
+
+	// Start killed on the surface, level, facing north.
+	set_kill(true);
+	sim_pin_set(DEPTH_PIN, 230);
+	sim_pin_set(A1, (int)(BATTERY/(5./1024.*23.88349514563107)));
+
+	double start = wall();
+	uint64_t model = 0;
+	uint64_t next_ahrs = 0, next_dvl = 0, next_depth = 0, next_log = 0;
+	uint64_t end = (uint64_t)(seconds*1e6);
+
+	setup();
+	while (sim_clock() < end)
+	{
+		// delay() in the control code may have moved the clock ahead, so
+		// catch the model up rather than assuming a single step.
+		uint64_t now = sim_clock() + STEP_US;
+		for (; model < now; model += STEP_US)
+		{
+			vehicle.step(STEP_US*1e-6);
+			for (int i = 0; i < 3; i++)
+				ahrs_sum[i] += vehicle.accel[i];
+			ahrs_steps++;
+			dvl_sum[F] += vehicle.vel[F];
+			dvl_sum[H] += vehicle.vel[H];
+			dvl_steps++;
+		}
+		sim_clock_set(now);
+
+		run_events(now);
+
+		for (; next_depth <= now; next_depth += 1000000ULL/DEPTH_RATE)
+		{
+			double counts = 65.*vehicle.pose[V] + noise(DEPTH_NOISE);
+			if (spike_rate > 0. && uniform() < spike_rate)
+				counts += spike(30., 200.);
+			int adc = (int)(230. + counts + 0.5);
+			sim_pin_set(DEPTH_PIN, adc < 0 ? 0 : adc > 1023 ? 1023 : adc);
+		}
+		for (; next_ahrs <= now; next_ahrs += 1000000ULL/AHRS_RATE)
+		{
+			send_ahrs();
+			ahrs_sum[F] = ahrs_sum[H] = ahrs_sum[V] = 0.;
+			ahrs_steps = 0;
+		}
+		for (; next_dvl <= now; next_dvl += 1000000ULL/DVL_RATE)
+		{
+			if (dvl_pinging)
+				send_dvl();
+			dvl_sum[F] = dvl_sum[H] = 0.;
+			dvl_steps = 0;
+		}
+
+		wire_advance(&ahrs_wire, now);
+		wire_advance(&dvl_wire, now);
+		io_adc_sim_advance(now);
+		io_sched_sim_advance(now);
+		loop();
+
+		if (truth && now >= next_log)
+		{
+			log_truth(truth, now);
+			next_log += 1000000ULL/LOG_RATE;
+		}
+	}
+	fflush(stdout);
+	if (truth)
+		fclose(truth);
+
+	double elapsed = wall() - start;
+	fprintf(stderr, "sim: %.1f s in %.3f s (%.0fx real time)\n", seconds,
+			elapsed, seconds/elapsed);
+	return 0;
+}
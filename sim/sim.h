@@ -0,0 +1,86 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file sim.h
+ *  @brief Hooks between the simulator and the simulated hardware drivers.
+ *
+ *  The io_*_sim files stand in for the io_*_avr files. Instead of registers
+ *  and interrupt vectors, the simulator calls into them to raise their
+ *  interrupts, and they call back into the simulator with whatever the control
+ *  code transmits to the hardware.
+ */
+#ifndef SIM_H
+#define SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/** @brief Sets the virtual clock read by micros() and millis().
+ *
+ *  @param us Microseconds since the start of the simulation.
+ */
+void sim_clock_set(uint64_t us);
+
+/** @brief Reads the virtual clock.
+ *
+ *  @return Microseconds since the start of the simulation.
+ */
+uint64_t sim_clock();
+
+/** @brief Sets what digitalRead() or analogRead() returns for a pin.
+ */
+void sim_pin_set(uint8_t pin, int val);
+
+/** @brief Receives a byte on the AHRS usart, calling the receive handler.
+ */
+void io_ahrs_sim_receive(unsigned char c);
+
+/** @brief Receives a byte on the DVL usart, calling the receive handler.
+ */
+void io_dvl_sim_receive(unsigned char c);
+
+/** @brief Calls the scheduler handler for every tick due up to the clock.
+ */
+void io_sched_sim_advance(uint64_t us);
+
+/** @brief Calls the ADC handler for every conversion due up to the clock.
+ */
+void io_adc_sim_advance(uint64_t us);
+
+/** @brief Handles a byte the control code sent to the DVL.
+ */
+void sim_dvl_transmit(unsigned char c);
+
+/** @brief Handles a byte the control code sent to the M5s.
+ */
+void sim_m5_transmit(unsigned char c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+#include <math.h>
+#include "config.h"
+#include "vehicle.hpp"
+
+
+/*
+ * Mass and moments of inertia per degree of freedom, including added mass
+ * (kg and kg m^2).
+ */
+static const double INERTIA[DOF] = { 45., 55., 60., 2.0, 2.5, 1.5 };
+
+/*
+ * Linear and quadratic damping per degree of freedom.
+ */
+static const double DAMP_LIN[DOF] = { 10., 15., 20., 2.0, 3.0, 3.0 };
+static const double DAMP_QUAD[DOF] = { 40., 60., 60., 4.0, 6.0, 6.0 };
+
+#define MASS 30.
+#define GRAVITY 9.81
+
+// Force of one thruster at full power (N), and its lever arm for moments (m).
+#define THRUST 40.
+#define ARM 0.25
+
+// Buoyancy in excess of weight (N). Motors::run adds 0.15 to each vertical
+// thruster to hold depth, which is 0.6 along the V column of ORIENTATION.
+#define NET_BUOYANCY (0.6*THRUST)
+
+// Height of the center of buoyancy above the center of gravity (m).
+#define METACENTER 0.05
+
+
+Vehicle::Vehicle()
+{
+	for (int i = 0; i < DOF; i++)
+	{
+		this->pose[i] = 0.;
+		this->vel[i] = 0.;
+	}
+	for (int i = 0; i < BODY_DOF; i++)
+		this->accel[i] = 0.;
+	for (int i = 0; i < NUM_MOTORS; i++)
+		this->power[i] = 0.;
+	this->powered = false;
+}
+
+void Vehicle::step(double dt)
+{
+	double sy = sin(pose[Y]), cy = cos(pose[Y]);
+	double sp = sin(pose[P]), cp = cos(pose[P]);
+	double sr = sin(pose[R]), cr = cos(pose[R]);
+
+	// Generalized forces from the thrusters. The M5s saturate at full power.
+	double tau[DOF];
+	for (int j = 0; j < DOF; j++)
+	{
+		tau[j] = 0.;
+		for (int i = 0; powered && i < NUM_MOTORS; i++)
+		{
+			double u = power[i] > 1. ? 1. : power[i] < -1. ? -1. : power[i];
+			tau[j] += ORIENTATION[i][j]*u;
+		}
+		tau[j] *= j < BODY_DOF ? THRUST : THRUST*ARM;
+	}
+
+	// Restoring forces and moments from weight and buoyancy.
+	double w = MASS*GRAVITY;
+	double b = w + NET_BUOYANCY;
+	double g[DOF];
+	g[F] = (w - b)*sp;
+	g[H] = -(w - b)*cp*sr;
+	g[V] = -(w - b)*cp*cr;
+	g[Y] = 0.;
+	g[P] = METACENTER*b*sp;
+	g[R] = METACENTER*b*cp*sr;
+
+	double acc[DOF];
+	for (int j = 0; j < DOF; j++)
+	{
+		double damp = DAMP_LIN[j]*vel[j] + DAMP_QUAD[j]*vel[j]*fabs(vel[j]);
+		acc[j] = (tau[j] - damp - g[j])/INERTIA[j];
+		vel[j] += acc[j]*dt;
+	}
+
+	// The accelerometer feels the acceleration of the body, which is the
+	// rate of change of the body velocities plus the turning of the body
+	// frame under them, w x v. It also feels gravity, which points down in
+	// NED.
+	double p = vel[R], q = vel[P], r = vel[Y];
+	accel[F] = acc[F] + q*vel[V] - r*vel[H] + GRAVITY*sp;
+	accel[H] = acc[H] + r*vel[F] - p*vel[V] - GRAVITY*cp*sr;
+	accel[V] = acc[V] + p*vel[H] - q*vel[F] - GRAVITY*cp*cr;
+
+	// Body velocities into NED, with the ZYX Euler rotation.
+	double u = vel[F], v = vel[H], z = vel[V];
+	pose[F] += (cy*cp*u + (cy*sp*sr - sy*cr)*v + (cy*sp*cr + sy*sr)*z)*dt;
+	pose[H] += (sy*cp*u + (sy*sp*sr + cy*cr)*v + (sy*sp*cr - cy*sr)*z)*dt;
+	pose[V] += (-sp*u + cp*sr*v + cp*cr*z)*dt;
+
+	// Body rates into Euler angle rates.
+	pose[R] += (p + sr*sp/cp*q + cr*sp/cp*r)*dt;
+	pose[P] += (cr*q - sr*r)*dt;
+	pose[Y] += (sr/cp*q + cr/cp*r)*dt;
+	if (pose[Y] > M_PI)
+		pose[Y] -= 2.*M_PI;
+	else if (pose[Y] < -M_PI)
+		pose[Y] += 2.*M_PI;
+
+	// Stop at the surface and the floor.
+	if (pose[V] < 0. || pose[V] > POOL_DEPTH)
+	{
+		pose[V] = pose[V] < 0. ? 0. : POOL_DEPTH;
+		vel[V] = 0.;
+	}
+}
@@ -0,0 +1,82 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/** @file vehicle.hpp
+ *  @brief Rigid body model of the sub for the simulator.
+ *
+ *  Six degrees of freedom with diagonal mass and damping, thrust from the
+ *  eight thrusters, and weight and buoyancy acting through separate centers so
+ *  pitch and roll right themselves. Coriolis terms are left out, since the sub
+ *  never moves or turns fast enough for them to matter.
+ *
+ *  The thrusters are placed through ORIENTATION: the force or moment on each
+ *  degree of freedom is the dot product of the thruster powers with its
+ *  column. That is the same geometry Motors uses to allocate thrust, including
+ *  the 1.1 fudge factors, so the controller sees the cross coupling they
+ *  cause.
+ */
+#ifndef VEHICLE_HPP
+#define VEHICLE_HPP
+
+#include "config.h"
+
+/** Depth of the pool floor in meters.
+ */
+#define POOL_DEPTH 5.
+
+struct Vehicle
+{
+	/** North, east and down in meters, then yaw, pitch and roll in radians,
+	 *  indexed by F, H, V, Y, P and R.
+	 */
+	double pose[DOF];
+
+	/** Surge, sway and heave in m/s, then yaw, pitch and roll rates in rad/s,
+	 *  in the body frame.
+	 */
+	double vel[DOF];
+
+	/** Specific force in the body frame in m/s^2, ie what an accelerometer
+	 *  reads.
+	 */
+	double accel[BODY_DOF];
+
+	/** Thruster powers in [-1, 1], in the same order as Motors::thrust.
+	 */
+	float power[NUM_MOTORS];
+
+	/** False while the kill switch has the thrusters unpowered.
+	 */
+	bool powered;
+
+	Vehicle();
+
+	/** @brief Integrates the model forward in time.
+	 *
+	 *  @param dt Time step in seconds.
+	 */
+	void step(double dt);
+};
+
+#endif
@@ -0,0 +1,130 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+#include <Arduino.h>
+
+#include "adc.hpp"
+#include "config.h"
+#include "io_adc.h"
+
+
+// Samples are kept in 1/64ths of a count, which holds 64 summed conversions
+// of up to 1023 in 16 bits.
+#define FRAC_BITS 6
+
+struct Input
+{
+	// Conversions summed so far and how many.
+	uint16_t sum;
+	uint8_t num;
+
+	// Low pass state, the filtered value shifted up by the filter shift.
+	uint32_t acc;
+
+	// Written by the interrupt, which then bumps seq. Only the interrupt
+	// writes, so a reader that sees seq change knows it was interrupted part
+	// way through a 16 bit read and tries again.
+	volatile uint16_t value;
+	volatile uint32_t time;
+	volatile uint16_t count;
+	volatile uint8_t seq;
+};
+
+static Input inputs[NUM_ADC_INPUTS];
+
+
+static void handler(uint8_t idx, uint16_t val)
+{
+	Input *in = &inputs[idx];
+	uint8_t os = ADC_INPUTS[idx][1];
+	uint8_t shift = ADC_INPUTS[idx][2];
+
+	in->sum += val;
+	if (++in->num < (1U << os))
+		return;
+	uint16_t sample = in->sum << (FRAC_BITS - os);
+	in->sum = 0;
+	in->num = 0;
+
+	// Start the filter on the first sample instead of rising from zero.
+	if (in->count == 0)
+		in->acc = (uint32_t)sample << shift;
+	else
+		in->acc += sample - (in->acc >> shift);
+
+	// A sum is centered half its length back, and the low pass delays it by
+	// another 2^shift - 1 samples.
+	uint32_t length = (uint32_t)(1000000./IO_ADC_HZ*NUM_ADC_INPUTS) << os;
+	in->value = in->acc >> shift;
+	in->time = micros() - length/2 - (((1UL << shift) - 1)*length);
+	in->count++;
+	in->seq++;
+}
+
+void adc_start()
+{
+	uint8_t channels[NUM_ADC_INPUTS];
+	for (int i = 0; i < NUM_ADC_INPUTS; i++)
+		channels[i] = ADC_INPUTS[i][0];
+	io_adc_start(channels, NUM_ADC_INPUTS, handler);
+}
+
+float adc_read(enum adc_input input)
+{
+	Input *in = &inputs[input];
+	uint8_t seq;
+	uint16_t value;
+	do
+	{
+		seq = in->seq;
+		value = in->value;
+	} while (seq != in->seq);
+	return value/(float)(1U << FRAC_BITS);
+}
+
+uint32_t adc_time(enum adc_input input)
+{
+	Input *in = &inputs[input];
+	uint8_t seq;
+	uint32_t time;
+	do
+	{
+		seq = in->seq;
+		time = in->time;
+	} while (seq != in->seq);
+	return time;
+}
+
+uint16_t adc_count(enum adc_input input)
+{
+	Input *in = &inputs[input];
+	uint8_t seq;
+	uint16_t count;
+	do
+	{
+		seq = in->seq;
+		count = in->count;
+	} while (seq != in->seq);
+	return count;
+}
@@ -69,6 +69,7 @@ static struct ahrs
 	float att[NUM_ATT_AXES];
 	float accel[NUM_ACCEL_AXES];
 	uint_fast8_t headingstatus;
+	uint32_t time;
 } ahrs[3];
 
 
@@ -82,6 +83,11 @@ float ahrs_accel(enum accel_axis const dir)
 	return ahrs[io_ahrs_tripbuf_read()].accel[dir];
 }
 
+uint32_t ahrs_time()
+{
+	return ahrs[io_ahrs_tripbuf_read()].time;
+}
+
 uint_fast8_t ahrs_headingstatus()
 {
 	return ahrs[io_ahrs_tripbuf_read()].headingstatus;
@@ -317,6 +323,7 @@ static bool parse_att(unsigned char const c)
 		// if the crc of the entire datagram == 0.
 		if (crc_xmodem_update(crc, c) == 0x0000U)
 		{
+			ahrs[write_idx].time = io_ahrs_recv_time();
 			io_ahrs_tripbuf_offer();
 			// Datagram and all attitude data is considered valid
 			state = INIT;
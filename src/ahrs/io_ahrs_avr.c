@@ -27,6 +27,7 @@
  * synchronization with ISRs
  */
 #include <assert.h>
+#include <Arduino.h>
 #include <avr/io.h>
 #include <avr/interrupt.h>
 
@@ -47,6 +48,10 @@
 
 static int (*handler_ahrs_recv)();
 
+// micros() when the byte being handled arrived. Only written and read within
+// the Receive Complete Interrupt, so it needs no protection.
+static uint32_t recv_time;
+
 
 static int uart_ahrs_putchar(char c, FILE *stream)
 {
@@ -126,12 +131,21 @@ ISR(CC_XXX(USART, NUSART, _RX_vect)) // Receive Complete Interrupt
 								pointer. If it is not initialized, the Receive
 								Complete Interrupt should not be enabled. */);
 
+	// Stamp the byte before anything else, so the handler can tell when a
+	// datagram was completed.
+	recv_time = micros();
+
 	// This function must read from the UDR (eg, with 'fgetc(io_ahrs)'),
 	// clearing the RXC flag, otherwise this interrupt will keep triggering
 	// until the flag is cleared.
 	handler_ahrs_recv();
 }
 
+uint32_t io_ahrs_recv_time()
+{
+	return recv_time;
+}
+
 int io_ahrs_recv_start(int (*handler)())
 {
 	handler_ahrs_recv = handler;
@@ -0,0 +1,163 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+#include <Arduino.h>
+#include "command.hpp"
+
+
+int command_args(char op)
+{
+	switch (op)
+	{
+		case 'e':
+		case 'i':
+		case 'p':
+		case 'z':
+			return 1;
+		case 'b':
+		case 'g':
+		case 'l':
+			return 2;
+		case 's':
+		case 'r':
+			return 6;
+		case 'm':
+			return 10;
+		case 'a':
+		case 'c':
+		case 'd':
+		case 'f':
+		case 'h':
+		case 'j':
+		case 'k':
+		case 'n':
+		case 't':
+		case 'v':
+		case 'w':
+		case 'x':
+			return 0;
+	}
+	return -1;
+}
+
+CommandLexer::CommandLexer()
+{
+	this->dropped = 0;
+	reset();
+}
+
+void CommandLexer::reset()
+{
+	this->holding = false;
+	clear();
+}
+
+void CommandLexer::clear()
+{
+	this->cmd.op = 0;
+	this->cmd.argc = 0;
+	this->len = 0;
+	this->want = 0;
+	this->busy = false;
+}
+
+static bool is_number(char c)
+{
+	return (c >= '0' && c <= '9') || c == '.' || c == '-' || c == '+';
+}
+
+bool CommandLexer::feed(char c)
+{
+	// A held byte goes first. If that finishes a command too, this one is
+	// held in its place.
+	if (flush())
+	{
+		held = c;
+		holding = true;
+		return true;
+	}
+	return lex(c);
+}
+
+bool CommandLexer::flush()
+{
+	if (!holding)
+		return false;
+	holding = false;
+	return lex(held);
+}
+
+bool CommandLexer::lex(char c)
+{
+	if (is_number(c))
+	{
+		// Stray numbers between commands are ignored, the same way
+		// Stream::parseFloat() skipped them.
+		if (!busy)
+			return false;
+
+		// A number too long to be sane means the line is garbage.
+		if (len >= CMD_MAX_TOKEN)
+		{
+			dropped++;
+			clear();
+			return false;
+		}
+		token[len++] = c;
+		return false;
+	}
+
+	// Anything else ends the argument being read.
+	if (busy && len > 0)
+	{
+		token[len] = '\0';
+		cmd.args[cmd.argc++] = atof(token);
+		len = 0;
+		if (cmd.argc == want)
+		{
+			// The byte that ended it may start the next command.
+			busy = false;
+			if (command_args(c) >= 0)
+			{
+				held = c;
+				holding = true;
+			}
+			return true;
+		}
+	}
+
+	int n = command_args(c);
+	if (n < 0)
+		return false;
+
+	if (busy)
+		dropped++;
+	clear();
+	cmd.op = c;
+	if (n == 0)
+		return true;
+	want = n;
+	busy = true;
+	return false;
+}
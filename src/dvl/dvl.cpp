@@ -46,6 +46,7 @@ static struct dvl_data
     int32_t velocity_forward;
     int32_t velocity_upward;
     int32_t range_to_bottom;
+    uint32_t time;
 } dvl_data[3];
 
 int32_t dvl_get_forward_vel()
@@ -68,6 +69,11 @@ int32_t dvl_get_range_to_bottom()
     return dvl_data[io_dvl_tripbuf_get_read_idx()].range_to_bottom;
 }
 
+uint32_t dvl_get_time()
+{
+    return dvl_data[io_dvl_tripbuf_get_read_idx()].time;
+}
+
 typedef enum
 {
     COMMAND_READY,
@@ -338,6 +344,7 @@ static bool parse_velocities(unsigned char const c)
             break;
         case 3:;
             dvl_data[io_dvl_tripbuf_get_write_idx()].range_to_bottom |= ((int32_t)c << 24);
+            dvl_data[io_dvl_tripbuf_get_write_idx()].time = io_dvl_recv_time();
             io_dvl_tripbuf_offer();
             reset_parser();
             return true;
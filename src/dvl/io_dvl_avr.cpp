@@ -46,6 +46,9 @@
 
 static bool (*io_dvl_recv_handler)();
 
+// micros() when the byte being handled arrived, see io_ahrs_avr.c
+static uint32_t recv_time;
+
 static int uart_dvl_putchar(char c, FILE *stream)
 {
     (void)stream;
@@ -103,9 +106,15 @@ void io_dvl_clean()
 ISR(CC_XXX(USART, NUSART, _RX_vect))
 {
     assert(io_dvl_recv_handler);
+    recv_time = micros();
     io_dvl_recv_handler();
 }
 
+uint32_t io_dvl_recv_time()
+{
+    return recv_time;
+}
+
 void io_dvl_recv_begin() 
 {
 	CC_XXX(UCSR, NUSART, B) |= (1U << CC_XXX(RXCIE, NUSART, ));
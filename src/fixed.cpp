@@ -0,0 +1,75 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+#include <Arduino.h>
+#include "fixed.hpp"
+
+
+// sin(d*D2R) of each whole degree d from 0 to 90, times 2^16, so that it
+// agrees with the float math where it overlaps.
+static const int32_t SINE[91] PROGMEM = {
+	0, 1144, 2287, 3430, 4571, 5712, 6850, 7987,
+	9121, 10252, 11380, 12504, 13625, 14742, 15854, 16961,
+	18064, 19160, 20251, 21336, 22414, 23485, 24550, 25606,
+	26655, 27696, 28728, 29752, 30766, 31772, 32767, 33753,
+	34728, 35693, 36646, 37589, 38520, 39440, 40347, 41242,
+	42125, 42994, 43851, 44694, 45524, 46340, 47142, 47929,
+	48702, 49460, 50202, 50930, 51642, 52338, 53019, 53683,
+	54331, 54962, 55577, 56174, 56755, 57318, 57864, 58392,
+	58902, 59395, 59869, 60325, 60763, 61182, 61583, 61965,
+	62328, 62672, 62997, 63302, 63589, 63856, 64103, 64331,
+	64540, 64729, 64898, 65047, 65177, 65286, 65376, 65446,
+	65496, 65526, 65536
+};
+
+static const int32_t TURN = 360L << 16;
+static const int32_t HALF = 180L << 16;
+static const int32_t QUARTER = 90L << 16;
+
+Fixed sin_deg(Fixed a)
+{
+	// Down to [0, 180] with the sign, then to [0, 90].
+	int32_t x = a.v % TURN;
+	if (x < 0)
+		x += TURN;
+	bool negative = x >= HALF;
+	if (negative)
+		x -= HALF;
+	if (x > QUARTER)
+		x = HALF - x;
+
+	// The differences between neighbours are below 1145, so this fits in
+	// 32 bits.
+	int i = x >> 16;
+	int32_t frac = x & 0xffff;
+	int32_t s = pgm_read_dword(&SINE[i]);
+	if (frac)
+		s += ((int32_t)pgm_read_dword(&SINE[i+1]) - s)*frac >> 16;
+	return Fixed::raw(negative ? -s : s);
+}
+
+Fixed cos_deg(Fixed a)
+{
+	return sin_deg(Fixed::raw(a.v % TURN + QUARTER));
+}
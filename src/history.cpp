@@ -0,0 +1,90 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+#include <Arduino.h>
+#include "history.hpp"
+#include "util.hpp"
+
+
+History::History()
+{
+	clear();
+}
+
+void History::clear()
+{
+	this->head = 0;
+	this->num = 0;
+}
+
+void History::record(uint32_t t, const float *a)
+{
+	this->head = (this->head + 1) % HISTORY_LEN;
+	if (this->num < HISTORY_LEN)
+		this->num++;
+	this->time[this->head] = t;
+	for (int i = 0; i < 3; i++)
+		this->angles[this->head][i] = a[i];
+}
+
+bool History::at(uint32_t t, float *a) const
+{
+	if (this->num == 0)
+		return false;
+
+	// Walk back from the newest sample to the first one at or before t.
+	// Times are compared as differences so they survive micros() wrapping.
+	uint8_t newer = this->head;
+	for (uint8_t n = 1; n < this->num; n++)
+	{
+		uint8_t older = (newer + HISTORY_LEN - 1) % HISTORY_LEN;
+		int32_t after = t - this->time[older];
+		if (after >= 0)
+		{
+			int32_t span = this->time[newer] - this->time[older];
+			float f = span > 0 && after < span ? (float)after/span : 1.;
+			for (int i = 0; i < 3; i++)
+				a[i] = angle_add(this->angles[older][i],
+						f*angle_difference(this->angles[newer][i],
+							this->angles[older][i]));
+			return true;
+		}
+		newer = older;
+	}
+
+	// Older than everything kept, or only one sample.
+	for (int i = 0; i < 3; i++)
+		a[i] = this->angles[newer][i];
+	return true;
+}
+
+void History::rate(float *r) const
+{
+	uint8_t older = (this->head + HISTORY_LEN - 1) % HISTORY_LEN;
+	int32_t span = this->time[this->head] - this->time[older];
+	for (int i = 0; i < 3; i++)
+		r[i] = this->num > 1 && span > 0 ? angle_difference(
+				this->angles[this->head][i], this->angles[older][i])/
+			(span/1000000.) : 0.;
+}
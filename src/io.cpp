@@ -23,6 +23,7 @@
  * ========================================================================== */
 
 #include <Arduino.h>
+#include "adc.hpp"
 #include "config.h"
 #include "streaming.h"
 #include "ahrs/ahrs.h"
@@ -49,6 +50,7 @@ void io()
 	pinMode(KILL_PIN, INPUT);
 
 	pinMode(DEPTH_PIN, INPUT);
+	adc_start();
 	pinMode(49, OUTPUT);
 	digitalWrite(49, HIGH); 
 
@@ -0,0 +1,106 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+#include <assert.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "io_adc.h"
+
+
+// Most channels that can be scanned.
+#define MAX_CHANNELS 16
+
+// Timer/Counter0 Overflow as the auto trigger source (ADTS = 100).
+#define TRIGGER (1U << ADTS2)
+
+// A prescale of 128 gives a 125 kHz ADC clock at 16 MHz, inside the 50-200
+// kHz needed for full resolution. A conversion then takes about 104 us, well
+// within the 1024 us between triggers.
+#define PRESCALE ((1U << ADPS2) | (1U << ADPS1) | (1U << ADPS0))
+
+
+static void (*handler_adc)(uint8_t idx, uint16_t val);
+
+static uint8_t scan[MAX_CHANNELS];
+static uint8_t num_scan;
+static volatile uint8_t current;
+
+
+// Points the multiplexer at a channel against AVCC. Channels 8 to 15 need
+// MUX5, which lives in ADCSRB next to the trigger source.
+static void select(uint8_t ch)
+{
+	ADMUX = (1U << REFS0) | (ch & 0x07);
+	ADCSRB = TRIGGER | ((ch & 0x08) ? (1U << MUX5) : 0);
+}
+
+void io_adc_start(uint8_t const *channels, uint8_t n,
+		void (*handler)(uint8_t idx, uint16_t val))
+{
+	assert(handler && n && n <= MAX_CHANNELS);
+	for (uint8_t i = 0; i < n; i++)
+	{
+		scan[i] = channels[i];
+
+		// Digital input buffers only add noise on analog pins.
+		if (channels[i] < 8)
+			DIDR0 |= (1U << channels[i]);
+		else
+			DIDR2 |= (1U << (channels[i] - 8));
+	}
+	num_scan = n;
+	handler_adc = handler;
+	current = 0;
+	select(scan[0]);
+
+	sei(); // enable global interrupts (they may be already enabled anyway)
+
+	// Enable the ADC with auto triggering and the conversion complete
+	// interrupt. The first conversion starts on the next overflow.
+	ADCSRA = (1U << ADEN) | (1U << ADATE) | (1U << ADIE) | (1U << ADIF) |
+		PRESCALE;
+	return;
+}
+
+void io_adc_stop()
+{
+	ADCSRA &= ~((1U << ADATE) | (1U << ADIE));
+	return;
+}
+
+ISR(ADC_vect)
+{
+	// ADCL must be read first, which locks ADCH until it is read too.
+	uint16_t val = ADCL;
+	val |= (uint16_t)ADCH << 8;
+
+	// The next conversion is a whole trigger period away, so switching the
+	// multiplexer now has it settled in time.
+	uint8_t idx = current;
+	current = idx + 1 < num_scan ? idx + 1 : 0;
+	select(scan[current]);
+
+	handler_adc(idx, val);
+}
@@ -0,0 +1,80 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+#ifdef PROFILE
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "io_profile.h"
+#include "macrodef.h"
+
+
+// Timer used as the cycle counter. Must be a 16 bit timer (ie 1, 3, 4, 5) on
+// the atmega2560 that nothing else is using. Timer 3 belongs to the M5s and
+// timer 4 to the scheduler.
+#define NTIMER 5
+
+
+// High 16 bits of the cycle count. The timer itself holds the low 16.
+static volatile uint16_t overflows;
+
+
+void io_profile_start()
+{
+	// Normal mode, no prescaling, so every timer tick is one cpu cycle. The
+	// overflow interrupt extends it to 32 bits, costing a few cycles every
+	// 4 ms.
+	CC_XXX(TCCR, NTIMER, A) = 0;
+	CC_XXX(TCCR, NTIMER, B) = 0;
+	CC_XXX(TCNT, NTIMER, ) = 0;
+	overflows = 0;
+	sei(); // enable global interrupts (they may be already enabled anyway)
+	CC_XXX(TIMSK, NTIMER, ) |= (1U << CC_XXX(TOIE, NTIMER, ));
+	CC_XXX(TCCR, NTIMER, B) |= (1U << CC_XXX(CS, NTIMER, 0));
+	return;
+}
+
+ISR(CC_XXX(TIMER, NTIMER, _OVF_vect))
+{
+	overflows++;
+}
+
+uint32_t io_profile_cycles()
+{
+	uint8_t const sreg = SREG;
+	cli();
+	uint16_t t = CC_XXX(TCNT, NTIMER, );
+	uint16_t ov = overflows;
+
+	// The counter may have wrapped after interrupts were disabled, in which
+	// case the overflow is pending but hasn't been counted yet. A small count
+	// means the wrap happened before it was read.
+	if ((CC_XXX(TIFR, NTIMER, ) & (1U << CC_XXX(TOV, NTIMER, ))) && t < 0x8000U)
+		ov++;
+	SREG = sreg;
+	return ((uint32_t)ov << 16) | t;
+}
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/**
+ * See the ahrs io_ahrs_avr.c and m5 io_m5_avr.c files for more verbose
+ * commenting on dealing with the avr timers and interrupts.
+ */
+#include <assert.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "io_sched.h"
+#include "macrodef.h"
+
+
+// Timer used for the scheduler tick. Must be a 16 bit timer (ie 1, 3, 4, 5) on
+// the atmega2560 that nothing else is using. Timer 3 belongs to the M5s.
+#define NTIMER 4
+
+// A prescale of 8 gives 0.5us resolution at 16 MHz, which reaches down to
+// ~31 Hz in 16 bits. That is slower than any tick we would want.
+#define PRESCALE 8UL
+#define PRESCALE_REG (1U << CC_XXX(CS, NTIMER, 1))
+
+
+static void (*handler_sched)();
+
+
+void io_sched_start(unsigned int hz, void (*handler)())
+{
+	assert(handler);
+	assert(F_CPU/PRESCALE/hz - 1UL < (1UL << 16));
+	handler_sched = handler;
+
+	// Waveform Generation Mode 4 (CTC with OCRnA as TOP), so the counter
+	// resets itself on every compare match and the period does not depend on
+	// how quickly the interrupt is serviced.
+	CC_XXX(TCCR, NTIMER, A) = 0;
+	CC_XXX(TCCR, NTIMER, B) = (1U << CC_XXX(WGM, NTIMER, 2));
+	CC_XXX(TCNT, NTIMER, ) = 0;
+	CC_XXX(OCR, NTIMER, A) = F_CPU/PRESCALE/hz - 1UL;
+
+	sei(); // enable global interrupts (they may be already enabled anyway)
+
+	// Enable Output Compare Match Interrupt, then start the timer.
+	CC_XXX(TIMSK, NTIMER, ) |= (1U << CC_XXX(OCIE, NTIMER, A));
+	CC_XXX(TCCR, NTIMER, B) |= PRESCALE_REG;
+	return;
+}
+
+void io_sched_stop()
+{
+	CC_XXX(TIMSK, NTIMER, ) &= ~(1U << CC_XXX(OCIE, NTIMER, A));
+	CC_XXX(TCCR, NTIMER, B) &= ~((1U << CC_XXX(CS, NTIMER, 0)) |
+			(1U << CC_XXX(CS, NTIMER, 1)) | (1U << CC_XXX(CS, NTIMER, 2)));
+	return;
+}
+
+ISR(CC_XXX(TIMER, NTIMER, _COMPA_vect))
+{
+	handler_sched();
+}
@@ -27,51 +27,296 @@
 #include "dvl/dvl.h"
 #include "streaming.h"
 #include "config.h"
-#include "matrix.h"
+#include "matrix.hpp"
 #include "kalman.hpp"
+#include "kalman_gains.h"
 #include "rotation.h"
 
 
 Kalman::Kalman()
 {
-	this->skip = 1000;
-	this->iter = 1000;
-	for (int i = 0; i < M; i++)
+	this->time = 0;
+	this->valid = 0;
+	this->blend = 0;
+	this->steady = STEADY_GAINS;
+	this->settled = 0;
+	this->dvl_errors = 0;
+	this->dvl_gated = 0;
+	this->trace = NULL;
+	memset(this->innov, 0, sizeof(this->innov));
+	this->updated = 0;
+}
+
+void Kalman::restart(uint64_t t)
+{
+	this->time = t;
+	this->valid = t;
+	this->blend = 0;
+	this->settled = 0;
+}
+
+// Corrects the state with a measurement z of M values, keeping the
+// innovations in in.
+static void correct(float *state, float *covar, const float *H,
+		const float *R, const float *z, Innovation &in)
+{
+	in.count++;
+	in.nis = kalman_correct(state, covar, H, R, z, in.y, in.s);
+	for (int m = 0; m < M; m++)
+		in.r[m] = R[m*M+m];
+}
+
+// Factors the covariance S of innovations y, kept as its upper triangle, as
+// L*D*L' and replaces y with L^-1*y. That leaves each innovation less what
+// the rows before it explain, and what is left of its variance in D, as the
+// sequential corrections find them. Returns the normalized innovation
+// squared, which is infinite if S isn't finite, so that the gate throws the
+// measurement out.
+static float eliminate(float *y, float *S)
+{
+	SymRef<M> L(S);
+	if (ldl(L, (float)SOLVE_TOL) == LDL_NOT_FINITE)
+		return INFINITY;
+	ldl_forward(L, Ref<M, 1>(y));
+	float nis = 0.;
+	for (int k = 0; k < M; k++)
+		if (L(k, k) > 0.)
+			nis += y[k]*y[k]/L(k, k);
+	return nis;
+}
+
+// Normalized innovation squared of a whole measurement against the state,
+// before any of it is applied. The sequential corrections add up the same
+// sum, but only once the first rows have already moved the state, so here
+// S = H*P*H' + R is eliminated instead.
+static float measurement_nis(const float *state, const float *covar,
+		const float *H, const float *R, const float *z)
+{
+	SymRef<N, const float> P(covar);
+	float y[M], S[M*(M+1)/2];
+	for (int a = 0; a < M; a++)
+	{
+		const float *h = &H[a*N];
+		y[a] = z[a];
+		for (int j = 0; j < N; j++)
+			y[a] -= h[j]*state[j];
+		for (int b = a; b < M; b++)
+		{
+			const float *g = &H[b*N];
+			float s = a == b ? R[a*M+a] : 0.;
+			for (int i = 0; i < N; i++)
+			{
+				if (h[i] == 0.)
+					continue;
+				for (int j = 0; j < N; j++)
+					s += h[i]*P(i, j)*g[j];
+			}
+			S[sym_index(a, b, M)] = s;
+		}
+	}
+	return eliminate(y, S);
+}
+
+// The row of a gain table for the time since the last DVL correction.
+static const float *steady_row(const float (*table)[N*M + M*M], uint64_t since)
+{
+	uint64_t b = since/STEADY_BIN;
+	return table[b < STEADY_BINS ? b : STEADY_BINS - 1];
+}
+
+// Innovations y of a measurement z of X and Y components, and their
+// covariance S from a table row, as its upper triangle. The tables are for
+// the sub facing north, so S is turned to the heading, whose cosine and sine
+// are c and s.
+static void steady_innovations(const float *state, const float *H,
+		const float *z, const float *row, float c, float s, float *y, float *S)
+{
+	for (int m = 0; m < M; m++)
+	{
+		y[m] = z[m];
+		for (int j = 0; j < N; j++)
+			if (H[m*N+j] != 0.)
+				y[m] -= H[m*N+j]*state[j];
+	}
+	float a = pgm_read_float(&row[N*M]);
+	float b = pgm_read_float(&row[N*M+1]);
+	float d = pgm_read_float(&row[N*M+3]);
+	S[0] = c*c*a - 2.*c*s*b + s*s*d;
+	S[1] = c*s*(a - d) + (c*c - s*s)*b;
+	S[2] = s*s*a + 2.*c*s*b + c*c*d;
+}
+
+// Fills in the innovations of a correction from the table, as the
+// sequential corrections would have found them, but for the count. Returns
+// the normalized innovation squared.
+static float steady_record(const float *y, const float *S, const float *R,
+		Innovation &in)
+{
+	float ys[M], Ss[M*(M+1)/2];
+	memcpy(ys, y, sizeof(ys));
+	memcpy(Ss, S, sizeof(Ss));
+	in.nis = eliminate(ys, Ss);
+	for (int m = 0; m < M; m++)
+	{
+		in.y[m] = ys[m];
+		in.s[m] = Ss[sym_index(m, m, M)];
+		in.r[m] = R[m*M+m];
+	}
+	return in.nis;
+}
+
+// Corrects the state with the gains in a table row. The innovations are
+// turned into the frame the table is for, and the correction to X and Y
+// turned back, which is O(N*M) in place of the O(N^2*M) of correct().
+static void steady_correct(float *state, const float *y, const float *row,
+		float c, float s)
+{
+	float y0 = c*y[0] + s*y[1], y1 = -s*y[0] + c*y[1];
+	float dx[N];
+	for (int i = 0; i < N; i++)
+		dx[i] = pgm_read_float(&row[i*M])*y0 + pgm_read_float(&row[i*M+1])*y1;
+	for (int k = 0; k < 3; k++)
+	{
+		state[k] += c*dx[k] - s*dx[k+3];
+		state[k+3] += s*dx[k] + c*dx[k+3];
+	}
+	state[6] += dx[6];
+	state[7] += dx[7];
+}
+
+// Row i of the turn to heading c, s, as the columns of its two terms and
+// their values. The biases aren't turned.
+static void turn_row(int i, float c, float s, int *a, float *u)
+{
+	if (i < 3)
+	{
+		a[0] = i;
+		u[0] = c;
+		a[1] = i+3;
+		u[1] = -s;
+	}
+	else if (i < 6)
+	{
+		a[0] = i-3;
+		u[0] = s;
+		a[1] = i;
+		u[1] = c;
+	}
+	else
 	{
-		m_orig[i] = 0.;
-		m_bias[i] = 0.;
+		a[0] = a[1] = i;
+		u[0] = 1.;
+		u[1] = 0.;
 	}
 }
 
-void Kalman::bias()
+bool Kalman::fast() const
 {
-	// Compute initial bias from the accelerometer.
-	for (int i = 0; i < M; i++)
-		m_bias[i] = 0.;
-	for (int i = 0; i < skip; i++)
+	return this->steady && this->settled >= STEADY_SETTLE;
+}
+
+void Kalman::unsettle(float *covar, float yaw)
+{
+	if (!dropout())
+		return;
+	if (fast())
 	{
-		delay(1);
-		ahrs_att_update();
+		// Start the full filter from the covariance the tables have at a
+		// dropout, D, turned to the heading by T*D*T'. Each row of T mixes
+		// only the X and Y parts of its pair, so each element is four of D.
+		// The variance of the position has been kept up meanwhile, and is
+		// kept if it is larger.
+		SymRef<N> P(covar);
+		float c = cos(yaw*D2R), s = sin(yaw*D2R);
+		float px = P(0, 0), py = P(3, 3);
+		for (int i = 0; i < N; i++)
+		{
+			int a[2], b[2];
+			float u[2], v[2];
+			turn_row(i, c, s, a, u);
+			for (int j = i; j < N; j++)
+			{
+				turn_row(j, c, s, b, v);
+				float d = 0.;
+				for (int p = 0; p < 2; p++)
+					for (int q = 0; q < 2; q++)
+						d += u[p]*v[q]*pgm_read_float(
+								&STEADY_DROPOUT[sym_index(a[p], b[q], N)]);
+				P(i, j) = d;
+			}
+		}
+		P(0, 0) = fmax(P(0, 0), px);
+		P(3, 3) = fmax(P(3, 3), py);
 	}
-	for (int i = 0; i < iter; i++)
+	this->settled = 0;
+}
+
+void Kalman::predict(float *state, float *covar, uint64_t t)
+{
+	if (t <= this->time)
+		return;
+	if (this->trace)
+		this->trace(*this, state, covar);
+	float dt = (t - this->time)/1000000.;
+	this->time = t;
+
+	// On the gain tables, only the variance of the position, which grows at
+	// a steady rate, is predicted.
+	kalman_predict(state, fast() ? (float *)NULL : covar, dt);
+	if (fast())
 	{
-		delay(1);
-		ahrs_att_update();
-		m_bias[0] += ahrs_accel((enum accel_axis)(SURGE));
-		m_bias[1] += ahrs_accel((enum accel_axis)(SWAY));
+		SymRef<N> P(covar);
+		P(0, 0) += STEADY_POSITION_RATE*dt;
+		P(3, 3) += STEADY_POSITION_RATE*dt;
 	}
-	m_bias[0] /= (float)iter;
-	m_bias[1] /= (float)iter;
 }
 
-uint32_t Kalman::compute(float *state, float *covar, float *angles, uint32_t t)
+void bias_rows(float yaw, float *H)
+{
+	float sy = sin(yaw*D2R), cy = cos(yaw*D2R);
+	H[6] = cy;
+	H[7] = -sy;
+	H[N+6] = sy;
+	H[N+7] = cy;
+}
+
+void Kalman::accel(float *state, float *covar, float *angles)
 {
-	// Calculate time difference since last iteration.
-	uint32_t temp = micros();
-	float dt = (temp-t)/1000000.;
+	// The accelerometer measures gravity too, which points down in the
+	// inertial frame. Take it out in the body frame, then rotate what is
+	// left into the inertial frame.
+	float sp = sin(angles[1]*D2R), cp = cos(angles[1]*D2R);
+	float sr = sin(angles[2]*D2R), cr = cos(angles[2]*D2R);
+	float body[3], m[3];
+	body[0] = (ahrs_accel((enum accel_axis)(SURGE)) - sp)*GRAVITY;
+	body[1] = (ahrs_accel((enum accel_axis)(SWAY)) + cp*sr)*GRAVITY;
+	body[2] = (ahrs_accel((enum accel_axis)(HEAVE)) + cp*cr)*GRAVITY;
+	body_to_inertial(body, angles, m);
+
+	// The bias is along the body axes, so it turns with the sub. Pitch and
+	// roll are small enough to leave out.
+	float H[M*N];
+	memcpy(H, Ha, sizeof(H));
+	bias_rows(angles[0], H);
+	unsettle(covar, angles[0]);
+	if (fast())
+	{
+		float c = cos(angles[0]*D2R), s = sin(angles[0]*D2R);
+		const float *row = steady_row(STEADY_ACCEL, this->time - this->valid);
+		float y[M], S[M*(M+1)/2];
+		steady_innovations(state, H, m, row, c, s, y, S);
+		steady_record(y, S, Ra, this->innov[INNOV_ACCEL]);
+		this->innov[INNOV_ACCEL].count++;
+		steady_correct(state, y, row, c, s);
+	}
+	else
+		correct(state, covar, H, Ra, m, this->innov[INNOV_ACCEL]);
+	this->updated |= 1 << INNOV_ACCEL;
+}
 
+bool Kalman::velocity(float *state, float *covar, float *angles, float lag)
+{
 	// Convert DVL velocities from um/s to m/s.
-	float *m = new float[3];
 	float t1 = dvl_get_forward_vel()/100000.;
 	float t2 = dvl_get_starboard_vel()/100000.;
 
@@ -80,137 +325,120 @@ uint32_t Kalman::compute(float *state, float *covar, float *angles, uint32_t t)
 	float u = cos(45.*D2R)*t1 - sin(45.*D2R)*t2;
 	float v = sin(45.*D2R)*t1 + cos(45.*D2R)*t2;
 
-	// Check if DVL has returned error velocity.
-	m_orig[0] = dvl_get_forward_vel();
-	m_orig[1] = dvl_get_starboard_vel();
+	// Check if DVL has returned error velocity, in which case the
+	// prediction is all there is.
 	if (fabs(t1) > 32. || fabs(t2) > 32.)
 	{
-		// Serial << "DVL did not return data." << _FLOAT(t1, 6) << " " << 
-		//	_FLOAT(t2, 6) << endl;
-		delete[] m;
-		// delete[] Kk;
-		return temp;
+		this->dvl_errors++;
+		return false;
 	}
 
-	// Convert from body to inertial reference frame and multiply by time
-	// difference to get change in distance.
+	// Convert from body to inertial reference frame, which is what the
+	// velocities in the state are in.
 	float temparr[3] = {u, v, 0};
+	float m[3];
 	body_to_inertial(temparr, angles, m);
-	m_orig[0] = m[0];
-	m_orig[1] = m[1];
-	state[0] += m[0]*dt;
-	state[3] += m[1]*dt;
-	delete[] m; 
-
-	/*
-	 * The Kalman filter is turned off until a better sub movement model can be
-	 * found. This would require manual calibration for power/acceleration
-	 * ratios and a lot of testing. 
-	 *
-	 * It might be a good idea to Kalman filter depth or attitude data, but
-	 * these seem to be accurate for now.
-	 */
-	/*
-	// Predict new state using model.
-	// X, VX, AX, Y, VY, AY.
-	float *a1 = new float[N];
-	float Fk[N*N] = {
-	1, dt, 0, 0, 0, 0,
-	0, 1, dt, 0, 0, 0,
-	0, 0, 1, 0, 0, 0,
-	0, 0, 0, 1, dt, 0,
-	0, 0, 0, 0, 1, dt,
-	0, 0, 0, 0, 0, 1
-	};
-	multiply(Fk, state, N, N, 1, a1);
-	memcpy(state, a1, sizeof(float)*N);
-	delete[] a1;
-
-	// Predict new covariance.
-	float *b1 = new float[N*N];
-	float *b2 = new float[N*N];
-	float *b3 = new float[N*N];
-	multiply(Fk, covar, N, N, N, b1);
-	transpose(Fk, N, N, b2);
-	multiply(b1, b2, N, N, N, b3);
-	add(Qk, b3, N, N, covar);	
-	delete[] b1;
-	delete[] b2;
-	delete[] b3;
-
-	// Calculate the Kalman gain.
-	float *Kk = new float[N*M];
-	float *c1 = new float[N*M];
-	float *c2 = new float[N*M];
-	float *c3 = new float[M*N];
-	float *c4 = new float[M*M];
-	float *c5 = new float[M*M];
-	transpose(Hk, M, N, c1);
-	multiply(covar, c1, N, N, M, c2);
-	multiply(Hk, covar, M, N, N, c3);
-	multiply(c3, c1, M, N, M, c4);
-	add(Rk, c4, M, M, c5);
-	invert(c5, M);
-	multiply(c2, c5, N, M, M, Kk);
-	delete[] c1;
-	delete[] c2;
-	delete[] c3;
-	delete[] c4;
-	delete[] c5;
-
-	// Receive measurements, taking into account accelerometer bias. Harsh
-	// cutoff to reduce accelerometer drift.
-	float *m = new float[M];
-	float t1 = dvl_get_forward_vel()/100000.0f;
-	float t2 = dvl_get_starboard_vel()/100000.0f;
-	float u = cos(45.f*D2R)*t1 - sin(45.f*D2R)*t2;
-	float v = sin(45.f*D2R)*t1 + cos(45.f*D2R)*t2;
-	m_orig[0] = dvl_get_forward_vel();
-	m_orig[1] = dvl_get_starboard_vel();
-	if (fabs(t1) > 3.0f || fabs(t2) > 3.0f)
+
+	// The velocity was true lag seconds ago, when it was the current
+	// velocity less the acceleration since.
+	float H[M*N];
+	memcpy(H, Hk, sizeof(H));
+	H[2] = -lag;
+	H[N+5] = -lag;
+	unsettle(covar, angles[0]);
+
+	// Coming back from a dropout, the velocity may have drifted a long way,
+	// and so has the position it was integrated into. Take the first few
+	// samples as less precise than they are so the correction is spread
+	// out rather than made in one step.
+	if (dropout())
+		this->blend = DVL_BLEND;
+	if (fast())
 	{
-	delete[] m;
-	// delete[] Kk;
-	return temp;
+		float c = cos(angles[0]*D2R), s = sin(angles[0]*D2R);
+		const float *row = steady_row(STEADY_DVL, this->time - this->valid);
+		float y[M], S[M*(M+1)/2];
+		steady_innovations(state, H, m, row, c, s, y, S);
+		Innovation in = this->innov[INNOV_DVL];
+		if (!(steady_record(y, S, Rk, in) <= DVL_GATE))
+		{
+			this->dvl_gated++;
+			return false;
+		}
+		in.count++;
+		this->innov[INNOV_DVL] = in;
+		steady_correct(state, y, row, c, s);
 	}
-	m[0] = u*cos(heading*D2R) - v*sin(heading*D2R);
-	m[1] = u*sin(heading*D2R) + v*cos(heading*D2R);
-	m_orig[0] = m[0];
-	m_orig[1] = m[1];
-	state[0] += m[0]*dt;
-	state[3] += m[1]*dt;
-	delete[] m; 
-
-	// Update state using measurements and Kalman gain.
-	float *d1 = new float[M];
-	float *d2 = new float[M];
-	float *d3 = new float[N];
-	float *d4 = new float[N];
-	multiply(Hk, state, M, N, 1, d1);
-	subtract(m, d1, M, 1, d2);
-	multiply(Kk, d2, N, M, 1, d3);
-	add(d3, state, N, 1, d4);
-	memcpy(state, d4, sizeof(float)*N);
-	delete[] d1;
-	delete[] d2;
-	delete[] d3;
-	delete[] d4;
-
-	// Update error covariance using Kalman gain.
-	float *e1 = new float[M*N];
-	float *e2 = new float[N*N];
-	float *e3 = new float[N*N];
-	multiply(Hk, covar, M, N, N, e1);
-	multiply(Kk, e1, N, M, N, e2);
-	subtract(covar, e2, N, N, e3);
-	memcpy(covar, e3, sizeof(float)*N*N);
-	delete[] e1;
-	delete[] e2;
-	delete[] e3;
-
-	delete[] m;
-	delete[] Kk;
-	*/
-	return temp;
+	else
+	{
+		float R[M*M];
+		memcpy(R, Rk, sizeof(R));
+		if (this->blend)
+		{
+			float scale = (this->blend + 1)*(this->blend + 1);
+			for (int i = 0; i < M*M; i++)
+				R[i] *= scale;
+			this->blend--;
+		}
+		else if (!(measurement_nis(state, covar, H, R, m) <= DVL_GATE))
+		{
+			this->dvl_gated++;
+			return false;
+		}
+		else if (this->settled < STEADY_SETTLE)
+			this->settled++;
+		correct(state, covar, H, R, m, this->innov[INNOV_DVL]);
+	}
+	this->updated |= 1 << INNOV_DVL;
+	this->valid = this->time;
+	return true;
 }
 
+bool Kalman::dropout() const
+{
+	return this->time > this->valid + DROPOUT_TIME;
+}
+
+void Kalman::model(float *state, float *covar, const float *forces, float *angles,
+		float yaw_rate)
+{
+	unsettle(covar, angles[0]);
+
+	// Surge and sway as unit vectors in the inertial frame. Pitch and roll
+	// are small enough to leave out.
+	float sy = sin(angles[0]*D2R), cy = cos(angles[0]*D2R);
+	float axes[M][2] = { { cy, sy }, { -sy, cy } };
+
+	// Along each axis the body velocity u changes at (T - D(u))/m, with
+	// thrust T and drag D(u) = a*u + b*u*|u|. The inertial acceleration along
+	// the axis is that plus the turning of the axes under the velocity,
+	// which is -r*v for surge and r*u for sway at yaw rate r. Drag is
+	// linearized around the estimated velocity u0, so for surge
+	// a + D'(u0)/m*u + r*v = (T - D(u0) + D'(u0)*u0)/m, which is a
+	// measurement of the acceleration and the velocities together.
+	float r = yaw_rate*D2R;
+	float Hm[M*N], z[M];
+	memset(Hm, 0, sizeof(Hm));
+	for (int k = 0; k < M; k++)
+	{
+		float thrust = MOTION_MODEL[k][0], mass = MOTION_MODEL[k][1];
+		float lin = MOTION_MODEL[k][2], quad = MOTION_MODEL[k][3];
+		float ex = axes[k][0], ey = axes[k][1];
+		float u = ex*state[1] + ey*state[4];
+		float f = ex*forces[F] + ey*forces[H];
+		float drag = lin*u + quad*u*fabs(u);
+		float slope = lin + 2.*quad*fabs(u);
+
+		// The other axis, turned a quarter back, so w x v along this axis
+		// is r times the velocity along it.
+		float turn = k == 0 ? r : -r;
+		float ox = axes[1-k][0], oy = axes[1-k][1];
+		Hm[k*N+1] = slope/mass*ex + turn*ox;
+		Hm[k*N+2] = ex;
+		Hm[k*N+4] = slope/mass*ey + turn*oy;
+		Hm[k*N+5] = ey;
+		z[k] = (thrust*f - drag + slope*u)/mass;
+	}
+	correct(state, covar, Hm, Rm, z, this->innov[INNOV_MODEL]);
+	this->updated |= 1 << INNOV_MODEL;
+}
@@ -0,0 +1,238 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+#include <Arduino.h>
+#include "streaming.h"
+#include "link.hpp"
+
+
+Link::Link(HardwareSerial &port)
+{
+	this->port = &port;
+	this->binary = false;
+	this->seq = 0;
+	this->push_seq = 0;
+	this->rejected = 0;
+	this->head = 0;
+	this->tail = 0;
+	this->queued = 0;
+	this->unsent = 0;
+	this->baud = LINK_BAUD;
+	this->next_baud = 0;
+	this->modes = 0;
+	this->trial = false;
+	this->trial_start = 0;
+	this->old_baud = LINK_BAUD;
+	this->old_binary = false;
+}
+
+static const uint32_t BAUDS[] = { 9600, 19200, 38400, 57600, 115200, 250000,
+	500000, 1000000 };
+
+bool link_baud_ok(uint32_t baud)
+{
+	for (size_t i = 0; i < sizeof(BAUDS)/sizeof(BAUDS[0]); i++)
+		if (baud == BAUDS[i])
+			return true;
+	return false;
+}
+
+void Link::begin()
+{
+	port->begin(LINK_BAUD);
+}
+
+bool Link::poll(Command &cmd)
+{
+	if (trial && !next_baud && millis() - trial_start >= LINK_FALLBACK_MS)
+		fall_back();
+
+	// Anything read before a switch would be read at the wrong rate.
+	if (next_baud && !pump())
+		return false;
+
+	while (port->available() > 0)
+	{
+		uint8_t c = port->read();
+
+		if (!binary)
+		{
+			if (lexer.feed(c))
+			{
+				trial = false;
+				cmd = lexer.cmd;
+				return true;
+			}
+			continue;
+		}
+
+		if (!decoder.feed(c))
+			continue;
+
+		// A frame with a good crc shows topside can reach the new rate, even
+		// if it isn't a command.
+		trial = false;
+
+		// The payload has to be exactly the arguments of the command.
+		int n = command_args(decoder.id);
+		if (n < 0 || decoder.size != 4*(size_t)n)
+		{
+			rejected++;
+			continue;
+		}
+		cmd.op = decoder.id;
+		cmd.argc = n;
+		for (int i = 0; i < n; i++)
+			cmd.args[i] = proto_get_float(decoder.payload + 4*i);
+		seq = decoder.seq;
+		return true;
+	}
+
+	// A command letter that ended the last command and had nothing after it.
+	if (!binary && lexer.flush())
+	{
+		trial = false;
+		cmd = lexer.cmd;
+		return true;
+	}
+	return false;
+}
+
+void Link::reply(char op, const float *v, uint8_t n, int digits)
+{
+	if (!binary)
+	{
+		if (n == 1)
+		{
+			*port << _FLOAT(v[0], digits) << '\n';
+			return;
+		}
+		for (int i = 0; i < n; i++)
+			*port << _FLOAT(v[i], digits) << ' ';
+		*port << '\n';
+		return;
+	}
+
+	uint8_t payload[4*CMD_MAX_ARGS];
+	for (int i = 0; i < n; i++)
+		proto_put_float(payload + 4*i, v[i]);
+	send(op, seq, payload, 4*n);
+}
+
+void Link::push(char op, const float *v, uint8_t n, int digits)
+{
+	if (!binary)
+	{
+		*port << op;
+		for (int i = 0; i < n; i++)
+			*port << ' ' << _FLOAT(v[i], digits);
+		*port << '\n';
+		return;
+	}
+
+	uint8_t payload[4*CMD_MAX_ARGS];
+	for (int i = 0; i < n; i++)
+		proto_put_float(payload + 4*i, v[i]);
+	send(op, push_seq++, payload, 4*n);
+}
+
+void Link::send(uint8_t id, uint8_t seq, const void *payload, size_t len)
+{
+	uint8_t frame[PROTO_MAX_FRAME];
+	size_t m = proto_encode(id, seq, payload, len, frame);
+
+	// Frames go out whole and in order, so this one waits behind any that are
+	// queued already.
+	pump();
+	if (m == 0 || m > (size_t)(LINK_QUEUE - queued))
+	{
+		unsent++;
+		return;
+	}
+	for (size_t i = 0; i < m; i++)
+	{
+		queue[head] = frame[i];
+		head = (head + 1) % LINK_QUEUE;
+	}
+	queued += m;
+	pump();
+}
+
+bool Link::pump()
+{
+	int room = port->availableForWrite();
+	while (queued && room > 0)
+	{
+		port->write(queue[tail]);
+		tail = (tail + 1) % LINK_QUEUE;
+		queued--;
+		room--;
+	}
+	if (queued)
+		return false;
+	if (!next_baud)
+		return true;
+
+	// The transmit buffer has to be empty too. flush() then only waits for
+	// the last byte or two to shift out.
+	if (port->availableForWrite() < SERIAL_TX_BUFFER_SIZE - 1)
+		return false;
+	port->flush();
+	port->begin(next_baud);
+	this->baud = next_baud;
+	this->next_baud = 0;
+	this->trial_start = millis();
+	return true;
+}
+
+bool Link::set_mode(uint32_t baud, bool binary)
+{
+	if (!link_baud_ok(baud))
+		return false;
+	this->old_baud = this->baud;
+	this->old_binary = this->binary;
+	this->trial = true;
+	switch_to(baud, binary);
+	return true;
+}
+
+// Nothing valid came in at the new rate, so topside is most likely still
+// talking at the old one.
+void Link::fall_back()
+{
+	this->trial = false;
+	switch_to(old_baud, old_binary);
+}
+
+// Changes the mode now, and the baud rate in pump() once everything queued
+// has gone out at the old one.
+void Link::switch_to(uint32_t baud, bool binary)
+{
+	this->next_baud = baud;
+	this->binary = binary;
+	this->modes++;
+	lexer.reset();
+	decoder.reset();
+	pump();
+}
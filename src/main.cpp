@@ -23,314 +23,688 @@
  * ========================================================================== */
 
 #include <Arduino.h>
+#include "adc.hpp"
 #include "ahrs/ahrs.h"
 #include "dvl/dvl.h"
 #include "streaming.h"
 #include "config.h"
-#include "kalman.hpp"
 #include "motor.hpp"
 #include "util.hpp"
 #include "pid.hpp"
 #include "io.hpp"
 #include "rotation.h"
 #include "voltage.hpp"
+#include "scheduler.hpp"
+#include "io_sched.h"
+#include "command.hpp"
+#include "link.hpp"
+#include "telemetry.hpp"
+#include "sensor.hpp"
+#include "profile.hpp"
+#include "mission.hpp"
+#include "trajectory.hpp"
+#include "navigation.hpp"
+#include "matrix.hpp"
+#include "screen.hpp"
 
 
-void run()
+/*
+ * Rates of each task in Hz. They must divide SCHED_HZ. The AHRS sends
+ * attitude at roughly 30 Hz and the DVL pings at a few Hz, so polling them
+ * faster than the control loop keeps the data used by the controller fresh.
+ */
+#define ATTITUDE_HZ 100
+#define DVL_HZ 50
+#define COMMAND_HZ 100
+#define CONTROL_HZ 50
+#define TELEMETRY_HZ 100
+
+static Scheduler sched;
+static int control_task;
+
+static Link topside(Serial);
+
+static Telemetry telemetry;
+static Snapshot snapshot;
+
+static Motors motors;
+
+static Mission mission;
+
+static Trajectory trajectory;
+
+static Navigation navigation;
+
+static float current[DOF] = { 0., 0., 0., 0., 0., 0. };
+static float desired[DOF] = { 0., 0., 0., 0., 0., 0. };
+static float target[DOF] = { 0., 0., 0., 0., 0., 0. };
+static float altitude;
+static float depth_adc;
+static float desired_altitude = -1.;
+
+static float dstate[DOF] = { 0., 0., 0., 0., 0., 0. };
+static float daltitude;
+
+static float INITIAL_YAW, INITIAL_PITCH, INITIAL_ROLL; 
+
+static bool alive_state;
+static bool alive_state_prev;
+static bool pause = false;
+static uint32_t pause_time;
+
+static Sensor att;
+static Sensor dvl;
+
+// Screens for the range to the bottom and the depth, which go to the PIDs
+// without the Kalman filter to check them, and the depth sample count last
+// seen, so that each sample goes in once.
+static Screen range_screen(RANGE_SCREEN);
+static Screen depth_screen(DEPTH_SCREEN);
+static uint16_t depth_count;
+
+// DVL dropout duration in seconds, estimated drift since, and the standard
+// deviation of the position, both in meters, then the accelerometer bias
+// along surge and sway in m/s^2.
+static float nav[TLM_NAV_LEN];
+
+// Whether the navigation log is on, and what has happened to the filter
+// since the last record.
+static bool nav_log;
+static uint8_t nav_flags;
+
+// Kinds of correction to send the innovations of, bit per innov_kind.
+static uint8_t innov_mask;
+
+
+static void task_attitude(float)
 {
-	if (!SIM) io();
-	if (!SIM) ahrs_att_update();
+	PROFILE_BEGIN(PROF_AHRS);
+	if (!SIM && ahrs_att_update())
+		att.arrive(widen(ahrs_time() - AHRS_LATENCY, micros64()));
+	PROFILE_END(PROF_AHRS);
+}
 
-	float INITIAL_YAW, INITIAL_PITCH, INITIAL_ROLL; 
-	if (USE_INITIAL_HEADING)
+static void task_dvl(float)
+{
+	PROFILE_BEGIN(PROF_DVL);
+	if (DVL_ON && !SIM && dvl_data_update())
+		dvl.arrive(widen(dvl_get_time() - DVL_LATENCY, micros64()));
+	PROFILE_END(PROF_DVL);
+}
+
+static void execute(const Command &cmd)
+{
+	char c = cmd.op;
+
+	if (c == 'a')
+	{
+		float a = alive();
+		topside.reply(c, &a, 1, 0);
+	}
+	else if (c == 'c')
+	{
+		topside.reply(c, current, DOF, 6);
+	}
+	else if (c == 'd')
+	{
+		topside.reply(c, target, DOF, 6);
+	}
+	else if (c == 'p')
+	{
+		motors.p = cmd.args[0];
+		if (motors.p < 0.05)
+		{
+			for (int i = 0; i < NUM_MOTORS; i++)
+			{
+				motors.thrust[i] = 0.;
+				motors.buttons[i] = 0;
+			}
+		}
+	}
+	else if (c == 's')
+	{
+		// A setpoint from topside takes over from the mission.
+		mission.clear();
+		for (int i = 0; i < DOF; i++)
+			target[i] = cmd.args[i];
+	}
+	else if (c == 'z')
+	{
+		desired_altitude = cmd.args[0];
+	}
+	else if (c == 'w')
+	{
+		topside.reply(c, &altitude, 1, 2);
+	}
+	else if (c == 'r')
+	{
+		mission.clear();
+		for (int i = 0; i < DOF; i++)
+			target[i] = current[i];
+		float temp1[3];
+		float temp2[3] = {current[Y], current[P], current[R]};
+		for (int i = 0; i < BODY_DOF; i++)
+			temp1[i] = cmd.args[i];
+		float temp[3];
+		body_to_inertial(temp1, temp2, temp);
+		for (int i = 0; i < BODY_DOF; i++)
+			target[i] += temp[i];
+		for (int i = BODY_DOF; i < GYRO_DOF; i++)
+			target[i] = angle_add(current[i], cmd.args[i]);
+	}
+	else if (c == 'h' && !SIM)
+	{
+		float h = ahrs_att((enum att_axis) (YAW));
+		topside.reply(c, &h, 1, 2);
+	}
+	else if (c == 'x' && !SIM)
+	{
+		navigation.zero();
+		nav_flags |= NAV_ZERO;
+		desired[F] = 0.;
+		desired[H] = 0.;
+		desired[V] = 0.;
+		desired[Y] = 0.;
+		for (int i = 0; i < DOF; i++)
+			target[i] = desired[i];
+		trajectory.stop();
+		current[F] = 0.;
+		current[H] = 0.;
+		current[Y] = 0.;
 		INITIAL_YAW = ahrs_att((enum att_axis) (YAW));
-	else 
-		INITIAL_YAW = FAR ? 225. : 340.;
-	INITIAL_PITCH = ahrs_att((enum att_axis) (PITCH));
-	INITIAL_ROLL = ahrs_att((enum att_axis) (ROLL));
+		att.fresh = true;
+	}
+	else if (c == 'f')
+	{
+		topside.reply(c, motors.forces, DOF, 6);
+	}
+	else if (c == 'v') 
+	{
+		float v = voltage();
+		topside.reply(c, &v, 1, 2);
+	}
+	else if (c == 'w')
+	{
+		for (int i = 0; i < NUM_MOTORS; i++)
+			motors.buttons[i] = (int)cmd.args[i];
+		if (motors.p > 0.01) 
+		{
+			// Relative distance of 10 ensures max speed is used.
+			float temp1[3] = {0, 0, 0};
+			float temp2[3] = {current[Y], current[P], current[R]};
+			if (motors.buttons[0] == 1)
+				temp1[0] = 10.;
+			if (motors.buttons[1] == 1)
+				temp1[1] = -10.;
+			if (motors.buttons[2] == 1)
+				temp1[0] = -10.;
+			if (motors.buttons[3] == 1)
+				temp1[1] = 10.;
+			if (motors.buttons[4] == 1)
+				target[Y] = angle_add(target[Y], -10.);
+			if (motors.buttons[5] == 1)
+				target[Y] = angle_add(target[Y], 10.);
+			float temp[3];
+			body_to_inertial(temp1, temp2, temp);
+			target[F] = current[F] + temp[0];
+			target[H] = current[H] + temp[1];
+		}
+	}
+	else if (c == 'g')
+	{
+		int idx = (int)cmd.args[0];
+		int val = (int)cmd.args[1];
+		drop(idx, val);
+	}
+	else if (c == 't')
+	{
+		topside.reply(c, motors.thrust, NUM_MOTORS, 6);
+	}
+	else if (c == 'j' && !topside.binary)
+	{
+		// Print scheduler statistics and start measuring again.
+		sched.print(Serial);
+		sched.reset_stats();
+	}
+#ifdef PROFILE
+	else if (c == 'k' && !topside.binary)
+	{
+		// Print per-stage cycle counts and start measuring again.
+		profile_print(Serial);
+	}
+#endif
+	else if (c == 'l')
+	{
+		// Subscribe to a mask of telemetry fields at a rate in Hz, or stop
+		// sending them with a rate of 0.
+		uint16_t decim = 0;
+		if (cmd.args[1] > 0.)
+			decim = (uint16_t)(CONTROL_HZ/cmd.args[1] + 0.5);
+		if (cmd.args[1] > 0. && decim < 1)
+			decim = 1;
+		telemetry.subscribe((uint8_t)cmd.args[0], decim);
+	}
+	else if (c == 'm')
+	{
+		// Queue a waypoint and answer with the queue length, or -1 if it is
+		// full.
+		float n = mission.add(cmd.args) ? mission.count : -1.;
+		topside.reply(c, &n, 1, 0);
+	}
+	else if (c == 'n')
+	{
+		// Abandon the mission, holding the current setpoint.
+		float n = mission.clear();
+		topside.reply(c, &n, 1, 0);
+	}
+	else if (c == 'e')
+	{
+		// Turn the navigation log on or off. It starts with the next
+		// restart of the filter, so turn it on before unkilling.
+		nav_log = cmd.args[0] > 0.5;
+		nav_flags = 0;
+	}
+	else if (c == 'i')
+	{
+		innov_mask = (uint8_t)cmd.args[0];
+	}
+	else if (c == 'b')
+	{
+		// Acknowledge at the old rate before switching, with a rate of -1
+		// if it isn't one the link supports, in which case nothing changes.
+		// A float out of range of a uint32_t can't be cast to one, so
+		// anything past the fastest rate is taken as 0, which isn't one.
+		uint32_t baud = cmd.args[0] > 0. && cmd.args[0] <= 1000000. ?
+			(uint32_t)cmd.args[0] : 0;
+		float v[2] = { cmd.args[0], cmd.args[1] };
+		if (!link_baud_ok(baud))
+			v[0] = -1.;
+		topside.reply(c, v, 2, 0);
+		topside.set_mode(baud, cmd.args[1] > 0.5);
+	}
+}
+
+static void task_command(float)
+{
+	// Drain everything that has arrived. The link never waits for more
+	// input, so a half received command just stays in the lexer or decoder
+	// until the rest of it shows up. Replies can't go out in the middle of a
+	// telemetry record, so while one is half sent the commands wait there
+	// until a later tick has sent the rest of it.
+	Command cmd;
+	PROFILE_BEGIN(PROF_COMMAND);
+	if (telemetry.pending)
+		telemetry.flush(topside);
+	if (!telemetry.pending)
+		while (topside.poll(cmd))
+			execute(cmd);
+	PROFILE_END(PROF_COMMAND);
+}
+
+// Copies everything telemetry can report at the end of a control tick, so
+// every field of a record comes from the same tick.
+static void take_snapshot()
+{
+	snapshot.time = millis();
+	for (int i = 0; i < DOF; i++)
+	{
+		snapshot.current[i] = current[i];
+		snapshot.desired[i] = desired[i];
+		snapshot.pid[i] = motors.pid[i];
+	}
+	for (int i = 0; i < NUM_MOTORS; i++)
+		snapshot.thrust[i] = motors.thrust[i];
+	snapshot.raw[0] = ahrs_att((enum att_axis) (YAW));
+	snapshot.raw[1] = ahrs_att((enum att_axis) (PITCH));
+	snapshot.raw[2] = ahrs_att((enum att_axis) (ROLL));
+	snapshot.raw[3] = ahrs_accel((enum accel_axis) (SURGE));
+	snapshot.raw[4] = ahrs_accel((enum accel_axis) (SWAY));
+	snapshot.raw[5] = ahrs_accel((enum accel_axis) (HEAVE));
+	snapshot.raw[6] = dvl_get_forward_vel();
+	snapshot.raw[7] = dvl_get_starboard_vel();
+	snapshot.raw[8] = dvl_get_upward_vel();
+	snapshot.raw[9] = dvl_get_range_to_bottom();
+	snapshot.raw[10] = depth_adc;
+
+	// How old the newest sample from each sensor is, in milliseconds.
+	uint64_t now = micros64();
+	snapshot.raw[11] = (int64_t)(now - att.time)/1000.;
+	snapshot.raw[12] = (int64_t)(now - dvl.time)/1000.;
+	snapshot.raw[13] = (int32_t)((uint32_t)now - adc_time(ADC_DEPTH))/1000.;
+	for (int i = 0; i < TLM_NAV_LEN; i++)
+		snapshot.nav[i] = nav[i];
+	snapshot.reject[0] = navigation.kalman.dvl_errors;
+	snapshot.reject[1] = navigation.kalman.dvl_gated;
+	snapshot.reject[2] = range_screen.rejected;
+	snapshot.reject[3] = depth_screen.rejected;
+	snapshot.reject[4] = telemetry.dropped;
+}
 
-	bool alive_state = alive();
-	bool alive_state_prev = alive_state;
-	bool pause = false;
-	uint32_t pause_time;
+// Logs the whole filter, which it has to start from to be replayed.
+static void log_state()
+{
+	if (!nav_log)
+		return;
+	NavRecord r;
+	r.flags = NAV_STATE;
+	r.kalman_time = navigation.kalman.time;
+	r.kalman_valid = navigation.kalman.valid;
+	r.kalman_blend = navigation.kalman.blend;
+	for (int i = 0; i < N; i++)
+		r.state[i] = navigation.state[i];
+	memcpy(r.covar, navigation.covar, sizeof(r.covar));
+	uint8_t buf[NAV_RECORD_LEN];
+	size_t n = r.pack(buf);
+	telemetry.bytes('e', buf, n, topside);
+}
 
-	Motors motors;
+// Logs what the filter was given this tick.
+static void log_tick(bool ahrs_fresh, bool dvl_fresh, const float *angles,
+		uint32_t force_time)
+{
+	NavRecord r;
+	r.flags = nav_flags | NAV_FORCE;
+	r.time = millis();
+	if (ahrs_fresh)
+	{
+		r.flags |= NAV_AHRS;
+		r.ahrs_time = att.time;
+		r.ahrs_prev = att.prev;
+		for (int i = 0; i < 3; i++)
+			r.angles[i] = angles[i];
+		r.accel[0] = ahrs_accel((enum accel_axis)(SURGE));
+		r.accel[1] = ahrs_accel((enum accel_axis)(SWAY));
+		r.accel[2] = ahrs_accel((enum accel_axis)(HEAVE));
+	}
+	if (dvl_fresh)
+	{
+		r.flags |= NAV_DVL;
+		r.dvl_time = dvl.time;
+		r.dvl_prev = dvl.prev;
+		r.dvl_vel[0] = dvl_get_forward_vel();
+		r.dvl_vel[1] = dvl_get_starboard_vel();
+		r.dvl_range = dvl_get_range_to_bottom();
+	}
+	r.force_time = force_time;
+	r.forces[0] = motors.forces[F];
+	r.forces[1] = motors.forces[H];
+	r.depth = current[V];
+	r.check[0] = navigation.state[0];
+	r.check[1] = navigation.state[3];
+	uint8_t buf[NAV_RECORD_LEN];
+	size_t n = r.pack(buf);
+	telemetry.bytes('e', buf, n, topside);
+	nav_flags = 0;
+}
 
-	Kalman kalman;
-	float state[N] = { 0.000, 0.000, 0.000, 0.000, 0.000, 0.000 };
-	float covar[N*N] = {	
-		1.000, 0.000, 0.000, 0.000, 0.000, 0.000,
-		0.000, 1.000, 0.000, 0.000, 0.000, 0.000,
-		0.000, 0.000, 1.000, 0.000, 0.000, 0.000,
-		0.000, 0.000, 0.000, 1.000, 0.000, 0.000,
-		0.000, 0.000, 0.000, 0.000, 1.000, 0.000,
-		0.000, 0.000, 0.000, 0.000, 0.000, 1.000,
-	};
+// Sends the innovations of each correction made this tick that topside asked
+// for.
+static void log_innovations()
+{
+	Kalman &kalman = navigation.kalman;
+	uint8_t due = kalman.updated & innov_mask;
+	kalman.updated = 0;
+	for (int k = 0; k < NUM_INNOV; k++)
+	{
+		if (!(due & (1 << k)))
+			continue;
+		const Innovation &in = kalman.innov[k];
+		float v[1 + 3*M + 1];
+		int n = 0;
+		v[n++] = in.count;
+		for (int m = 0; m < M; m++)
+			v[n++] = in.y[m];
+		for (int m = 0; m < M; m++)
+			v[n++] = in.s[m];
+		for (int m = 0; m < M; m++)
+			v[n++] = in.r[m];
+		v[n++] = in.nis;
+		telemetry.values('i', millis(), k, v, n, topside);
+	}
+}
 
-	float current[DOF] = { 0., 0., 0., 0., 0., 0. };
-	float desired[DOF] = { 0., 0., 0., 0., 0., 0. };
-	float altitude;
-	float desired_altitude = -1.;
+// Keeps track of how long the DVL has been out and how far the position may
+// have drifted since, as the growth of its standard deviation, and of the
+// accelerometer bias.
+static void track_nav()
+{
+	static float sigma_start;
+	const Kalman &kalman = navigation.kalman;
+	SymRef<N, const float> covar(navigation.covar);
+	float sigma = sqrt(covar(0, 0) + covar(3, 3));
+	if (!kalman.dropout())
+	{
+		nav[0] = 0.;
+		nav[1] = 0.;
+		sigma_start = sigma;
+	}
+	else
+	{
+		nav[0] = (kalman.time - kalman.valid)/1000000.;
+		nav[1] = sigma - sigma_start;
+	}
+	nav[2] = sigma;
+	nav[3] = navigation.state[6];
+	nav[4] = navigation.state[7];
+}
 
-	float dstate[DOF] = { 0., 0., 0., 0., 0., 0. };
-	float daltitude;
+static void task_control(float dt)
+{
+	PROFILE_CONTROL_BEGIN();
+	alive_state_prev = alive_state;
+	alive_state = alive();
 
-	uint32_t ktime = micros();
-	uint32_t mtime = micros();
+	// Enough time has elapsed for motors to start up. Don't forget to reset
+	// time so the time difference for the first set of velocities from the
+	// DVL are correct.
+	if (pause && millis() - pause_time > PAUSE_TIME && !SIM)
+	{
+		pause = false;
+		dvl.restart(micros64());
+		navigation.kalman.restart(micros64());
+		log_state();
+	}
 
-	while (true)
+	// Kill switch has just been switched from alive to dead. Pause motor
+	// communications. Until the sub has been set back to alive, none of
+	// these "if" statements will run.
+	if (alive_state_prev && !alive_state && !SIM)
 	{
-		if (!SIM) ahrs_att_update();
+		motors.pause();
+		// Serial << "Desired states being reset." << endl;
+	}
 
-		if (DVL_ON && !SIM) dvl_data_update();
+	// Kill switch has just been switched from dead to alive. Reset all
+	// values, including states and initial headings. Pause so motors have
+	// time to start up. 
+	if (!alive_state_prev && alive_state && !SIM)
+	{ 
+		navigation.zero();
+		desired[F] = 0.;
+		desired[H] = 0.;
+		desired[V] = 0.;
+		desired[Y] = 0.;
+		for (int i = 0; i < DOF; i++)
+			target[i] = desired[i];
+		trajectory.stop();
+		desired_altitude = -1.;
+		current[F] = 0.;
+		current[H] = 0.;
+		current[Y] = 0.;
+		if (USE_INITIAL_HEADING)
+			INITIAL_YAW = ahrs_att((enum att_axis) (YAW));
+		else 
+			INITIAL_YAW = FAR ? 225. : 340.;
+		INITIAL_PITCH = ahrs_att((enum att_axis) (PITCH));
+		INITIAL_ROLL = ahrs_att((enum att_axis) (ROLL));
+		att.fresh = true;
+		navigation.history.clear();
+		nav_flags |= NAV_ZERO | NAV_CLEAR;
+		mission.restart();
+		pause = true;
+		pause_time = millis();
+		// Serial << "Current states being reset." << endl;
+	}
 
-		if (Serial.available() > 0)
+	// Motors are done starting up and the sub is alive. Run the sub as
+	// intended.
+	if (SIM || (!pause && alive_state))
+	{
+		// Compute depth from pressure sensor, and angles from AHRS if it has
+		// sent anything new.
+		if (!SIM && adc_count(ADC_DEPTH) != depth_count)
 		{
-			char c = Serial.read();
+			depth_count = adc_count(ADC_DEPTH);
+			depth_adc = adc_read(ADC_DEPTH);
+			current[V] = depth_screen.add((depth_adc-230.)/65.);
+		}
+		bool ahrs_fresh = !SIM && att.take();
+		if (ahrs_fresh)
+		{
+			current[Y] = ahrs_att((enum att_axis) (YAW)) - INITIAL_YAW;
+			// current[P] = ahrs_att((enum att_axis) (PITCH)) - INITIAL_PITCH;
+			// current[R] = ahrs_att((enum att_axis) (ROLL)) - INITIAL_ROLL;
+			current[P] = ahrs_att((enum att_axis) (PITCH));
+			current[R] = ahrs_att((enum att_axis) (ROLL));
 
-			if (c == 'a')
-			{
-				Serial << alive() << '\n';
-			}
-			else if (c == 'c')
-			{
-				for (int i = 0; i < DOF; i++)
-					Serial << _FLOAT(current[i], 6) << ' '; Serial << '\n';
-			}
-			else if (c == 'd')
-			{
-				for (int i = 0; i < DOF; i++)
-					Serial << _FLOAT(desired[i], 6) << ' '; Serial << '\n';
-			}
-			else if (c == 'p')
-			{
-				motors.p = Serial.parseFloat();
-				if (motors.p < 0.05)
-				{
-					for (int i = 0; i < NUM_MOTORS; i++)
-					{
-						motors.thrust[i] = 0.;
-						motors.buttons[i] = 0;
-					}
-				}
-			}
-			else if (c == 's')
-			{
-				for (int i = 0; i < DOF; i++)
-					desired[i] = Serial.parseFloat();
-			}
-			else if (c == 'z')
-			{
-				desired_altitude = Serial.parseFloat();
-			}
-			else if (c == 'w')
-			{
-				Serial << altitude << '\n';
-			}
-			else if (c == 'r')
-			{
-				for (int i = 0; i < DOF; i++)
-					desired[i] = current[i];
-				float temp1[3];
-				float temp2[3] = {current[Y], current[P], current[R]};
-				for (int i = 0; i < BODY_DOF; i++)
-					temp1[i] = Serial.parseFloat();
-				float temp[3];
-				body_to_inertial(temp1, temp2, temp);
-				for (int i = 0; i < BODY_DOF; i++)
-					desired[i] += temp[i];
-				for (int i = BODY_DOF; i < GYRO_DOF; i++)
-					desired[i] = angle_add(current[i], Serial.parseFloat());
-			}
-			else if (c == 'h' && !SIM)
-			{
-				Serial << ahrs_att((enum att_axis) (YAW)) << '\n';
-			}
-			else if (c == 'x' && !SIM)
-			{
-				state[0] = 0.;
-				state[3] = 0.;
-				desired[F] = 0.;
-				desired[H] = 0.;
-				desired[V] = 0.;
-				desired[Y] = 0.;
-				current[F] = 0.;
-				current[H] = 0.;
-				current[Y] = 0.;
-				INITIAL_YAW = ahrs_att((enum att_axis) (YAW));
-			}
-			else if (c == 'f')
-			{
-				for (int i = 0; i < DOF; i++)
-					Serial << _FLOAT(motors.forces[i], 6) << ' '; Serial << '\n';
-			}
-			else if (c == 'v') 
-			{
-				float v = voltage();
-				Serial << v << '\n';
-			}
-			else if (c == 'w')
-			{
-				for (int i = 0; i < NUM_MOTORS; i++)
-					motors.buttons[i] = Serial.parseInt();
-				if (motors.p > 0.01) 
-				{
-					// Relative distance of 10 ensures max speed is used.
-					float temp1[3] = {0, 0, 0};
-					float temp2[3] = {current[Y], current[P], current[R]};
-					if (motors.buttons[0] == 1)
-						temp1[0] = 10.;
-					if (motors.buttons[1] == 1)
-						temp1[1] = -10.;
-					if (motors.buttons[2] == 1)
-						temp1[0] = -10.;
-					if (motors.buttons[3] == 1)
-						temp1[1] = 10.;
-					if (motors.buttons[4] == 1)
-						desired[Y] = angle_add(desired[Y], -10.);
-					if (motors.buttons[5] == 1)
-						desired[Y] = angle_add(desired[Y], 10.);
-					float temp[3];
-					body_to_inertial(temp1, temp2, temp);
-					desired[F] = current[F] + temp[0];
-					desired[H] = current[H] + temp[1];
-				}
-			}
-			else if (c == 'g')
-			{
-				int idx = Serial.parseInt();
-				int val = Serial.parseInt();
-				drop(idx, val);
-			}
-			else if (c == 't')
-			{
-				for (int i = 0; i < 8; i++)
-					Serial << _FLOAT(motors.thrust[i], 6) << " "; Serial << '\n';
-			}
+			// Handle angle overflow/underflow.
+			for (int i = BODY_DOF; i < GYRO_DOF; i++)
+				current[i] += (current[i] > 180.) ? -360. : (current[i] < -180.) ? 360. : 0.;
 		}
+		float temp[3] = { current[Y], current[P], current[R] };
 
-		alive_state_prev = alive_state;
-		alive_state = alive();
+		// Kalman filter removes noise from measurements and estimates the new
+		// state. Assume angle is 100% correct so no need for EKF or UKF. It
+		// is predicted up to each new AHRS or DVL sample and corrected with
+		// it, so every sample is used exactly once. Samples are taken in the
+		// order they were true, which their times say, not the order they
+		// were noticed in.
+		PROFILE_BEGIN(PROF_KALMAN);
+		bool dvl_fresh = dvl.take();
+		if (dvl_fresh && DVL_ON)
+			altitude = range_screen.add(dvl_get_range_to_bottom()/10000.);
+		navigation.fuse(ahrs_fresh, att, temp, dvl_fresh, dvl);
+		track_nav();
+		PROFILE_END(PROF_KALMAN);
+		log_innovations();
 
-		// Enough time has elapsed for motors to start up. Don't forget to reset
-		// time so the time difference for the first set of velocities from the
-		// DVL are correct.
-		if (pause && millis() - pause_time > PAUSE_TIME && !SIM)
+		// Use KF for N and E components of state. The state is as of the
+		// newest sample, which is already some time old, so carry it forward
+		// to now for the controller.
+		const float *state = navigation.state;
+		float age = (int64_t)(micros64() - navigation.kalman.time)/1000000.;
+		if (age < 0.)
+			age = 0.;
+		float xy[2];
+		navigation.position(xy);
+		current[F] = xy[0] + (state[1] + state[2]*age/2.)*age;
+		current[H] = xy[1] + (state[4] + state[5]*age/2.)*age;
+
+		// Follow the mission, if there is one, and tell topside whenever a
+		// waypoint is done with: its number, 1 if it was reached or 0 if it
+		// timed out, and how many are left.
+		int result = mission.update(current, target, millis());
+		if (result != MISSION_NONE)
 		{
-			pause = false;
-			mtime = micros();
-			ktime = micros();
+			float v[3] = { (float)(mission.index - 1),
+				(float)(result == MISSION_REACHED), (float)mission.count };
+			telemetry.push('m', v, 3, 0, topside);
 		}
 
-		// Kill switch has just been switched from alive to dead. Pause motor
-		// communications. Until the sub has been set back to alive, none of
-		// these "if" statements will run.
-		if (alive_state_prev && !alive_state && !SIM)
+		// Change heading if desired state is far. Turned off for now
+		// because we want to rely on DVL > AHRS.
+		/*
+		if (fabs(desired[F]-current[F]) > 3. || fabs(desired[H]-current[H] > 3.))
+			desired[Y] = atan2(desired[H]-current[H], desired[F]-current[F]) * R2D;
+		desired[Y] += (desired[Y] > 360.) ? -360. : (desired[Y] < 0.) ? 360. : 0.;
+		*/
+
+		// Move the desired state along its trajectory towards the target.
+		trajectory.step(target, desired, dt);
+
+		// Compute the state difference. Change heading first if the error 
+		// is high. Make depth changes regardless. 
+		for (int i = 0; i < DOF; i++)
+			dstate[i] = 0.;
+		float d0 = desired[F] - current[F];
+		float d1 = desired[H] - current[H];
+		float i0 = d0*cos(D2R*current[Y]) + d1*sin(D2R*current[Y]);
+		float i1 = d1*cos(D2R*current[Y]) - d0*sin(D2R*current[Y]);
+		if (fabs(angle_difference(desired[Y], current[Y])) > 5.)
 		{
-			motors.pause();
-			// Serial << "Desired states being reset." << endl;
+			dstate[Y] = angle_difference(desired[Y], current[Y]);
 		}
-
-		// Kill switch has just been switched from dead to alive. Reset all
-		// values, including states and initial headings. Pause so motors have
-		// time to start up. 
-		if (!alive_state_prev && alive_state && !SIM)
-		{ 
-			state[0] = 0.;
-			state[3] = 0.;
-			desired[F] = 0.;
-			desired[H] = 0.;
-			desired[V] = 0.;
-			desired[Y] = 0.;
-			desired_altitude = -1.;
-			current[F] = 0.;
-			current[H] = 0.;
-			current[Y] = 0.;
-			if (USE_INITIAL_HEADING)
-				INITIAL_YAW = ahrs_att((enum att_axis) (YAW));
-			else 
-				INITIAL_YAW = FAR ? 225. : 340.;
-			INITIAL_PITCH = ahrs_att((enum att_axis) (PITCH));
-			INITIAL_ROLL = ahrs_att((enum att_axis) (ROLL));
-			pause = true;
-			pause_time = millis();
-			// Serial << "Current states being reset." << endl;
+		else if (fabs(i1) > 2.)
+		{
+			dstate[Y] = angle_difference(desired[Y], current[Y]);
+			dstate[F] = i0 < i1/3. ? i0 : i1/3.;
+			dstate[H] = i1; 
 		}
-
-		// Motors are done starting up and the sub is alive. Run the sub as
-		// intended.
-		if (SIM || (!pause && alive_state))
+		else 
 		{
-			// Compute angles from AHRS and depth from pressure sensor.
-			if (!SIM)
-			{
-				current[V] = (analogRead(DEPTH_PIN)-230.)/65.;
-				current[Y] = ahrs_att((enum att_axis) (YAW)) - INITIAL_YAW;
-				// current[P] = ahrs_att((enum att_axis) (PITCH)) - INITIAL_PITCH;
-				// current[R] = ahrs_att((enum att_axis) (ROLL)) - INITIAL_ROLL;
-				current[P] = ahrs_att((enum att_axis) (PITCH));
-				current[R] = ahrs_att((enum att_axis) (ROLL));
-				if (DVL_ON)
-					altitude = dvl_get_range_to_bottom()/10000.;
-
-				// Handle angle overflow/underflow.
-				for (int i = BODY_DOF; i < GYRO_DOF; i++)
-					current[i] += (current[i] > 180.) ? -360. : (current[i] < -180.) ? 360. : 0.;
-			}
-			float temp[3] = { current[Y], current[P], current[R] };
-
-			// Kalman filter removes noise from measurements and estimates the new
-			// state. Assume angle is 100% correct so no need for EKF or UKF.
-			ktime = kalman.compute(state, covar, temp, ktime);
-
-			// Use KF for N and E components of state. 
-			current[F] = state[0];
-			current[H] = state[3];
-
-			// Change heading if desired state is far. Turned off for now
-			// because we want to rely on DVL > AHRS.
-			/*
-			if (fabs(desired[F]-current[F]) > 3. || fabs(desired[H]-current[H] > 3.))
-				desired[Y] = atan2(desired[H]-current[H], desired[F]-current[F]) * R2D;
-			desired[Y] += (desired[Y] > 360.) ? -360. : (desired[Y] < 0.) ? 360. : 0.;
-			*/
-
-			// Compute the state difference. Change heading first if the error 
-			// is high. Make depth changes regardless. 
-			for (int i = 0; i < DOF; i++)
-				dstate[i] = 0.;
-			float d0 = desired[F] - current[F];
-			float d1 = desired[H] - current[H];
-			float i0 = d0*cos(D2R*current[Y]) + d1*sin(D2R*current[Y]);
-			float i1 = d1*cos(D2R*current[Y]) - d0*sin(D2R*current[Y]);
-			if (fabs(angle_difference(desired[Y], current[Y])) > 5.)
-			{
-				dstate[Y] = angle_difference(desired[Y], current[Y]);
-			}
-			else if (fabs(i1) > 2.)
-			{
-				dstate[Y] = angle_difference(desired[Y], current[Y]);
-				dstate[F] = i0 < i1/3. ? i0 : i1/3.;
-				dstate[H] = i1; 
-			}
-			else 
-			{
-				dstate[Y] = angle_difference(desired[Y], current[Y]);
-				dstate[F] = i0;
-				dstate[H] = i1;
-			}
-			dstate[V] = desired[V] - current[V];
-			daltitude = desired_altitude > 0. ? desired_altitude-altitude : -9999.;
-
-			// Compute PID within motors and set thrust.
-			mtime = motors.run(dstate, daltitude, temp, mtime);
+			dstate[Y] = angle_difference(desired[Y], current[Y]);
+			dstate[F] = i0;
+			dstate[H] = i1;
 		}
+		dstate[V] = desired[V] - current[V];
+		daltitude = desired_altitude > 0. ? desired_altitude-altitude : -9999.;
+
+		// Compute PID within motors and set thrust.
+		PROFILE_BEGIN(PROF_PID);
+		motors.run(dstate, daltitude, temp, dt);
+		PROFILE_END(PROF_PID);
+		uint32_t force_time = micros();
+		navigation.force(force_time, motors.forces);
+		if (nav_log)
+			log_tick(ahrs_fresh, dvl_fresh, temp, force_time);
 	}
+
+	take_snapshot();
+	telemetry.record(snapshot, topside);
+	PROFILE_CONTROL_END(sched.tasks[control_task].late);
+}
+
+static void task_telemetry(float)
+{
+	telemetry.flush(topside);
+}
+
+static void tick()
+{
+	sched.tick(micros());
 }
 
 void setup()
 {
-	Serial.begin(9600);
-	run();
+	topside.begin();
+
+	if (!SIM) io();
+	if (!SIM) ahrs_att_update();
+
+	if (USE_INITIAL_HEADING)
+		INITIAL_YAW = ahrs_att((enum att_axis) (YAW));
+	else 
+		INITIAL_YAW = FAR ? 225. : 340.;
+	INITIAL_PITCH = ahrs_att((enum att_axis) (PITCH));
+	INITIAL_ROLL = ahrs_att((enum att_axis) (ROLL));
+
+	alive_state = alive();
+	alive_state_prev = alive_state;
+	dvl.restart(micros64());
+	navigation.kalman.restart(micros64());
+
+	// Tasks run in the order they are added when several are due on the same
+	// tick, so fresh sensor data is picked up before the controller runs.
+	sched.add("attitude", task_attitude, ATTITUDE_HZ);
+	sched.add("dvl", task_dvl, DVL_HZ);
+	control_task = sched.add("control", task_control, CONTROL_HZ);
+	sched.add("command", task_command, COMMAND_HZ);
+	sched.add("telemetry", task_telemetry, TELEMETRY_HZ);
+	PROFILE_INIT();
+	io_sched_start(SCHED_HZ, tick);
+}
+
+void loop() 
+{
+	sched.run();
 }
-void loop() {}
@@ -0,0 +1,128 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+#include <Arduino.h>
+#include "config.h"
+#include "util.hpp"
+#include "mission.hpp"
+
+
+// Longest wait in seconds that still fits in milliseconds in 32 bits.
+#define WAIT_MAX 4000000.
+
+// A dwell or timeout from topside, kept within what update() can count. A
+// negative one, or NaN, is no wait at all rather than one of 50 days.
+static float wait(float seconds)
+{
+	if (!(seconds > 0.))
+		return 0.;
+	return seconds < WAIT_MAX ? seconds : WAIT_MAX;
+}
+
+Mission::Mission()
+{
+	this->head = 0;
+	this->count = 0;
+	this->index = 0;
+	this->started = false;
+	this->start = 0;
+	this->within = false;
+	this->arrival = 0;
+}
+
+bool Mission::add(const float *args)
+{
+	if (count == MISSION_MAX)
+		return false;
+	if (count == 0)
+	{
+		index = 0;
+		started = false;
+	}
+	Waypoint &w = queue[(head + count) % MISSION_MAX];
+	for (int i = 0; i < DOF; i++)
+		w.target[i] = args[i];
+	w.tolerance = args[DOF];
+	w.heading_tolerance = args[DOF+1];
+	w.dwell = wait(args[DOF+2]);
+	w.timeout = wait(args[DOF+3]);
+	count++;
+	return true;
+}
+
+uint8_t Mission::clear()
+{
+	uint8_t n = count;
+	head = 0;
+	count = 0;
+	started = false;
+	return n;
+}
+
+void Mission::restart()
+{
+	started = false;
+}
+
+int Mission::update(const float *current, float *target, uint32_t now)
+{
+	if (count == 0)
+		return MISSION_NONE;
+
+	const Waypoint &w = queue[head];
+	if (!started)
+	{
+		started = true;
+		start = now;
+		within = false;
+	}
+	for (int i = 0; i < DOF; i++)
+		target[i] = w.target[i];
+
+	float d0 = target[F] - current[F];
+	float d1 = target[H] - current[H];
+	float d2 = target[V] - current[V];
+	bool in = sqrt(d0*d0 + d1*d1 + d2*d2) <= w.tolerance &&
+		fabs(angle_difference(target[Y], current[Y])) <= w.heading_tolerance;
+
+	// The dwell has to be spent within tolerance without leaving it.
+	if (in && !within)
+		arrival = now;
+	within = in;
+
+	int result = MISSION_NONE;
+	if (within && now - arrival >= (uint32_t)(1000.*w.dwell))
+		result = MISSION_REACHED;
+	else if (w.timeout > 0. && now - start >= (uint32_t)(1000.*w.timeout))
+		result = MISSION_TIMEOUT;
+
+	if (result != MISSION_NONE)
+	{
+		head = (head + 1) % MISSION_MAX;
+		count--;
+		index++;
+		started = false;
+	}
+	return result;
+}
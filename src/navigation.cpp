@@ -0,0 +1,293 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+#include <Arduino.h>
+#include "config.h"
+#include "navigation.hpp"
+
+
+Navigation::Navigation()
+{
+	// The accelerometer bias starts out unknown, to about 0.2 m/s^2.
+	for (int i = 0; i < N; i++)
+		this->state[i] = 0.;
+	for (int i = 0, n = 0; i < N; i++)
+		for (int j = i; j < N; j++)
+			this->covar[n++] = i != j ? 0. : i < 6 ? 1. : 0.04;
+	for (int i = 0; i < FORCE_LOG; i++)
+	{
+		this->force_log[i][0] = 0.;
+		this->force_log[i][1] = 0.;
+		this->force_log_time[i] = 0;
+	}
+	this->force_log_head = 0;
+	this->origin[0] = 0;
+	this->origin[1] = 0;
+}
+
+void Navigation::zero()
+{
+	this->state[0] = 0.;
+	this->state[3] = 0.;
+	this->origin[0] = 0;
+	this->origin[1] = 0;
+}
+
+void Navigation::position(float *xy) const
+{
+	xy[0] = this->origin[0] + this->state[0];
+	xy[1] = this->origin[1] + this->state[3];
+}
+
+void Navigation::fuse(bool ahrs_fresh, const Sensor &att, float *angles,
+		bool dvl_fresh, const Sensor &dvl)
+{
+	if (ahrs_fresh)
+		history.record(att.time, angles);
+	bool ahrs_first = ahrs_fresh && !(dvl_fresh && dvl.time < att.time);
+	if (ahrs_first)
+		fuse_ahrs(att, angles);
+	if (dvl_fresh)
+		fuse_dvl(dvl, angles);
+	if (ahrs_fresh && !ahrs_first)
+		fuse_ahrs(att, angles);
+	recenter();
+}
+
+void Navigation::recenter()
+{
+	// Taking a whole number off a float this size is exact, so nothing is
+	// lost moving it over.
+	for (int k = 0; k < 2; k++)
+	{
+		float whole = floor(state[3*k] + 0.5);
+		if (whole == 0.)
+			continue;
+		origin[k] += (int32_t)whole;
+		state[3*k] -= whole;
+	}
+}
+
+void Navigation::force(uint32_t t, const float *forces)
+{
+	force_log_head = (force_log_head + 1) % FORCE_LOG;
+	force_log[force_log_head][0] = forces[F];
+	force_log[force_log_head][1] = forces[H];
+	force_log_time[force_log_head] = t;
+}
+
+// Averages the logged motor forces between two times.
+void Navigation::average_forces(uint32_t from, uint32_t to, float *forces) const
+{
+	int32_t span = to - from;
+	if (span <= 0)
+		return;
+	float sum[2] = { 0., 0. };
+	uint32_t end = to;
+	uint8_t i = force_log_head;
+	for (int n = 0; n < FORCE_LOG; n++)
+	{
+		// Clip the time this tick's forces were held to the window.
+		uint32_t start = force_log_time[i];
+		if ((int32_t)(start - from) < 0)
+			start = from;
+		int32_t held = end - start;
+		if (held > 0)
+		{
+			sum[0] += force_log[i][0]*held;
+			sum[1] += force_log[i][1]*held;
+			end = start;
+		}
+		if (end == from)
+			break;
+		i = (i + FORCE_LOG - 1) % FORCE_LOG;
+	}
+	forces[F] = sum[0]/span;
+	forces[H] = sum[1]/span;
+}
+
+void Navigation::fuse_ahrs(const Sensor &att, float *angles)
+{
+	kalman.predict(state, covar, att.time);
+	kalman.accel(state, covar, angles);
+
+	// Without the DVL, dead reckon with what the motors are pushing with.
+	// The thrust changes every tick, so the motion model has to see its
+	// average over the same time the accelerometer sample does rather than
+	// whatever it is right then.
+	if (kalman.dropout())
+	{
+		float forces[DOF] = { 0., 0., 0., 0., 0., 0. };
+		average_forces(att.prev, att.time, forces);
+		float rates[3];
+		history.rate(rates);
+		kalman.model(state, covar, forces, angles, rates[0]);
+	}
+}
+
+void Navigation::fuse_dvl(const Sensor &dvl, float *angles)
+{
+	// The DVL velocity is an average over the ping that ended at dvl.time,
+	// so it was true about half an interval before, and the state may
+	// already be past dvl.time from a newer AHRS sample. It is in the body
+	// frame, so rotate it with the attitude from the middle of the ping.
+	float a[3] = { angles[0], angles[1], angles[2] };
+	history.at(dvl.time - (dvl.time - dvl.prev)/2, a);
+	kalman.predict(state, covar, dvl.time);
+	float lag = dvl.interval()/2. + (kalman.time - dvl.time)/1000000.;
+	kalman.velocity(state, covar, a, lag);
+}
+
+static void put_u32(uint8_t *&p, uint32_t v)
+{
+	for (int i = 0; i < 4; i++)
+		*p++ = v >> 8*i;
+}
+
+static uint32_t get_u32(const uint8_t *&p)
+{
+	uint32_t v = 0;
+	for (int i = 0; i < 4; i++)
+		v |= (uint32_t)*p++ << 8*i;
+	return v;
+}
+
+// Floats go out as their bits, so a replay sees exactly what the filter did.
+static void put_float(uint8_t *&p, float v)
+{
+	uint32_t u;
+	memcpy(&u, &v, 4);
+	put_u32(p, u);
+}
+
+static float get_float(const uint8_t *&p)
+{
+	uint32_t u = get_u32(p);
+	float v;
+	memcpy(&v, &u, 4);
+	return v;
+}
+
+size_t NavRecord::pack(uint8_t *out) const
+{
+	uint8_t *p = out;
+	*p++ = flags;
+	if (flags & NAV_STATE)
+	{
+		put_u32(p, kalman_time);
+		put_u32(p, kalman_valid);
+		*p++ = kalman_blend;
+		for (int i = 0; i < N; i++)
+			put_float(p, state[i]);
+		for (int i = 0; i < N*(N+1)/2; i++)
+			put_float(p, covar[i]);
+		return p - out;
+	}
+	put_u32(p, time);
+	if (flags & NAV_AHRS)
+	{
+		put_u32(p, ahrs_time);
+		put_u32(p, ahrs_prev);
+		for (int i = 0; i < 3; i++)
+			put_float(p, angles[i]);
+		for (int i = 0; i < 3; i++)
+			put_float(p, accel[i]);
+	}
+	if (flags & NAV_DVL)
+	{
+		put_u32(p, dvl_time);
+		put_u32(p, dvl_prev);
+		put_u32(p, dvl_vel[0]);
+		put_u32(p, dvl_vel[1]);
+		put_u32(p, dvl_range);
+	}
+	if (flags & NAV_FORCE)
+	{
+		put_u32(p, force_time);
+		put_float(p, forces[0]);
+		put_float(p, forces[1]);
+	}
+	put_float(p, depth);
+	put_float(p, check[0]);
+	put_float(p, check[1]);
+	return p - out;
+}
+
+bool NavRecord::unpack(const uint8_t *in, size_t len)
+{
+	if (len < 1)
+		return false;
+	const uint8_t *p = in;
+	flags = *p++;
+	if (flags & NAV_STATE)
+	{
+		if (len != NAV_RECORD_LEN)
+			return false;
+		kalman_time = get_u32(p);
+		kalman_valid = get_u32(p);
+		kalman_blend = *p++;
+		for (int i = 0; i < N; i++)
+			state[i] = get_float(p);
+		for (int i = 0; i < N*(N+1)/2; i++)
+			covar[i] = get_float(p);
+		return true;
+	}
+	size_t want = 1 + 4 + 12;
+	if (flags & NAV_AHRS)
+		want += 32;
+	if (flags & NAV_DVL)
+		want += 20;
+	if (flags & NAV_FORCE)
+		want += 12;
+	if (len != want)
+		return false;
+	time = get_u32(p);
+	if (flags & NAV_AHRS)
+	{
+		ahrs_time = get_u32(p);
+		ahrs_prev = get_u32(p);
+		for (int i = 0; i < 3; i++)
+			angles[i] = get_float(p);
+		for (int i = 0; i < 3; i++)
+			accel[i] = get_float(p);
+	}
+	if (flags & NAV_DVL)
+	{
+		dvl_time = get_u32(p);
+		dvl_prev = get_u32(p);
+		dvl_vel[0] = get_u32(p);
+		dvl_vel[1] = get_u32(p);
+		dvl_range = get_u32(p);
+	}
+	if (flags & NAV_FORCE)
+	{
+		force_time = get_u32(p);
+		forces[0] = get_float(p);
+		forces[1] = get_float(p);
+	}
+	depth = get_float(p);
+	check[0] = get_float(p);
+	check[1] = get_float(p);
+	return true;
+}
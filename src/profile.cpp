@@ -0,0 +1,128 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+#ifdef PROFILE
+
+#include <Arduino.h>
+#include "streaming.h"
+#include "profile.hpp"
+
+
+static const char *const names[NUM_PROF_STAGES] = {
+	"ahrs",
+	"dvl",
+	"command",
+	"kalman",
+	"pid",
+	"power"
+};
+
+static ProfStage stages[NUM_PROF_STAGES];
+
+// Control task runs since the statistics were cleared, when they were
+// cleared, the start of the previous run, the longest gap between two starts
+// and the worst latency from release to finish.
+static uint32_t runs;
+static uint32_t since;
+static uint32_t last;
+static uint32_t gap;
+static uint32_t latency;
+
+
+static void clear()
+{
+	for (int i = 0; i < NUM_PROF_STAGES; i++)
+	{
+		stages[i].count = 0;
+		stages[i].min = 0xFFFFFFFFUL;
+		stages[i].max = 0;
+		stages[i].sum = 0;
+		for (int b = 0; b < PROF_BINS; b++)
+			stages[i].hist[b] = 0;
+	}
+	runs = 0;
+	gap = 0;
+	latency = 0;
+	since = io_profile_cycles();
+	last = since;
+}
+
+void profile_init()
+{
+	io_profile_start();
+	clear();
+}
+
+void profile_record(enum prof_stage s, uint32_t cycles)
+{
+	ProfStage &p = stages[s];
+	p.count++;
+	p.sum += cycles;
+	if (cycles < p.min)
+		p.min = cycles;
+	if (cycles > p.max)
+		p.max = cycles;
+
+	uint8_t b = 0;
+	while (cycles >>= 1)
+		b++;
+	if (b >= PROF_BINS)
+		b = PROF_BINS - 1;
+	if (p.hist[b] != 0xFFFF)
+		p.hist[b]++;
+}
+
+void profile_control(uint32_t start, uint32_t late)
+{
+	uint32_t now = io_profile_cycles();
+	if (runs && start - last > gap)
+		gap = start - last;
+	last = start;
+	runs++;
+
+	uint32_t l = late*(F_CPU/1000000UL) + (now - start);
+	if (l > latency)
+		latency = l;
+}
+
+void profile_print(Print &out)
+{
+	for (int i = 0; i < NUM_PROF_STAGES; i++)
+	{
+		ProfStage &p = stages[i];
+		uint32_t mean = p.count ? p.sum/p.count : 0;
+		out << names[i] << ' ' << p.count << ' ' << (p.count ? p.min : 0) <<
+			' ' << mean << ' ' << p.max;
+		for (int b = 0; b < PROF_BINS; b++)
+			out << ' ' << p.hist[b];
+		out << '\n';
+	}
+
+	uint32_t elapsed = io_profile_cycles() - since;
+	float hz = elapsed ? runs*(float)F_CPU/elapsed : 0.;
+	out << "control " << hz << ' ' << gap << ' ' << latency << '\n';
+	clear();
+}
+
+#endif
@@ -0,0 +1,183 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+#include <string.h>
+#include "protocol.hpp"
+
+extern "C" {
+#include "ahrs/crc_xmodem.h"
+}
+
+
+/*
+ * COBS replaces every zero with the distance to the next zero (or the end of
+ * the block), and starts each block with such a code byte. A code of 0xFF
+ * means 254 data bytes without a zero following them. The overhead is one
+ * byte per 254, which for our message sizes is always exactly one byte.
+ */
+static size_t cobs_encode(const uint8_t *in, size_t n, uint8_t *out)
+{
+	size_t code_idx = 0;
+	size_t o = 1;
+	uint8_t code = 1;
+	for (size_t i = 0; i < n; i++)
+	{
+		if (in[i] == 0)
+		{
+			out[code_idx] = code;
+			code_idx = o++;
+			code = 1;
+			continue;
+		}
+		out[o++] = in[i];
+		if (++code == 0xFF)
+		{
+			out[code_idx] = code;
+			code_idx = o++;
+			code = 1;
+		}
+	}
+	out[code_idx] = code;
+	return o;
+}
+
+// Decodes in place, which works because the output is never longer than the
+// input. Returns the decoded length, or -1 on a malformed block.
+static int cobs_decode(uint8_t *buf, size_t n)
+{
+	size_t i = 0;
+	size_t o = 0;
+	while (i < n)
+	{
+		uint8_t code = buf[i++];
+		if (code == 0 || i + code - 1 > n)
+			return -1;
+		for (uint8_t k = 1; k < code; k++)
+			buf[o++] = buf[i++];
+		if (code != 0xFF && i < n)
+			buf[o++] = 0;
+	}
+	return o;
+}
+
+size_t proto_encode(uint8_t id, uint8_t seq, const void *payload, size_t len,
+		uint8_t *out)
+{
+	if (len > PROTO_MAX_PAYLOAD)
+		return 0;
+
+	// Assemble the raw message at the tail of out, so it can be encoded
+	// towards the front without a second buffer. The encoded message is at
+	// most one byte longer than the raw one (plus the delimiter), so the
+	// write position never overtakes the read position.
+	size_t n = len + PROTO_OVERHEAD;
+	uint8_t *raw = out + PROTO_MAX_FRAME - n;
+	raw[0] = id;
+	raw[1] = seq;
+	if (len)
+		memcpy(raw + 2, payload, len);
+
+	uint16_t crc = CRC_XMODEM_INIT_VAL;
+	for (size_t i = 0; i < n - 2; i++)
+		crc = crc_xmodem_update(crc, raw[i]);
+	raw[n-2] = crc >> 8;
+	raw[n-1] = crc & 0xFF;
+
+	size_t m = cobs_encode(raw, n, out);
+	out[m++] = 0;
+	return m;
+}
+
+ProtoDecoder::ProtoDecoder()
+{
+	this->errors = 0;
+	this->overflows = 0;
+	reset();
+}
+
+void ProtoDecoder::reset()
+{
+	this->len = 0;
+	this->payload = NULL;
+	this->size = 0;
+}
+
+bool ProtoDecoder::feed(uint8_t c)
+{
+	if (c != 0)
+	{
+		if (len < sizeof(buf))
+			buf[len] = c;
+		len++;
+		return false;
+	}
+
+	// Delimiter. Empty frames are just padding between frames.
+	size_t n = len;
+	len = 0;
+	if (n == 0)
+		return false;
+	if (n > sizeof(buf))
+	{
+		overflows++;
+		return false;
+	}
+
+	int m = cobs_decode(buf, n);
+	if (m < PROTO_OVERHEAD)
+	{
+		errors++;
+		return false;
+	}
+
+	// The crc of a message with its crc appended is 0.
+	uint16_t crc = CRC_XMODEM_INIT_VAL;
+	for (int i = 0; i < m; i++)
+		crc = crc_xmodem_update(crc, buf[i]);
+	if (crc != 0)
+	{
+		errors++;
+		return false;
+	}
+
+	id = buf[0];
+	seq = buf[1];
+	payload = buf + 2;
+	size = m - PROTO_OVERHEAD;
+	return true;
+}
+
+float proto_get_float(const uint8_t *p)
+{
+	// Both the avr and every topside machine we use are little endian, so
+	// this is just a copy. memcpy avoids breaking aliasing rules.
+	float v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+void proto_put_float(uint8_t *p, float v)
+{
+	memcpy(p, &v, sizeof(v));
+}
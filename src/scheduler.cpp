@@ -0,0 +1,153 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+#include <Arduino.h>
+#include "streaming.h"
+#include "scheduler.hpp"
+
+
+Scheduler::Scheduler()
+{
+	this->num = 0;
+	this->ticks = 0;
+	this->tick_time = 0;
+}
+
+int Scheduler::add(const char *name, void (*fn)(float dt), uint16_t hz)
+{
+	if (num >= SCHED_MAX_TASKS || hz == 0 || hz > SCHED_HZ)
+		return -1;
+
+	Task &t = tasks[num];
+	t.name = name;
+	t.fn = fn;
+	t.period = SCHED_HZ/hz;
+
+	// First due at the next tick rather than this one, which may not have
+	// come yet if the timer hasn't started, and then there is no time for
+	// the lateness to be measured from.
+	t.release = now() + 1;
+	t.prev = t.release - t.period;
+	t.runs = 0;
+	t.overruns = 0;
+	t.late_max = 0;
+	t.late_sum = 0;
+	t.exec_max = 0;
+	t.late = 0;
+	return num++;
+}
+
+void Scheduler::tick(uint32_t us)
+{
+	ticks++;
+	tick_time = us;
+}
+
+uint32_t Scheduler::now()
+{
+	noInterrupts();
+	uint32_t n = ticks;
+	interrupts();
+	return n;
+}
+
+void Scheduler::run()
+{
+	for (uint8_t i = 0; i < num; i++)
+	{
+		Task &t = tasks[i];
+
+		// The tick count and its timestamp have to be read together, otherwise
+		// the lateness could be off by a whole tick.
+		noInterrupts();
+		uint32_t n = ticks;
+		uint32_t last = tick_time;
+		interrupts();
+
+		// Signed difference so the comparison survives the tick counter
+		// wrapping around.
+		if ((int32_t)(n - t.release) < 0)
+			continue;
+
+		// If the task fell more than a period behind, skip the releases it
+		// missed instead of running it several times back to back. Otherwise
+		// a single long stall would make every task burst afterwards.
+		uint32_t missed = (n - t.release)/t.period;
+		t.overruns += missed;
+		t.release += missed*t.period;
+
+		uint32_t start = micros();
+		uint32_t late = (n - t.release)*SCHED_TICK_US + (start - last);
+		t.late = late;
+		t.late_sum += late;
+		if (late > t.late_max)
+			t.late_max = late;
+
+		// dt is measured between release ticks rather than with micros(), so
+		// it is exactly one period unless releases were skipped.
+		float dt = (t.release - t.prev)/(float)SCHED_HZ;
+		t.prev = t.release;
+		t.release += t.period;
+		t.fn(dt);
+
+		uint32_t exec = micros() - start;
+		if (exec > t.exec_max)
+			t.exec_max = exec;
+		t.runs++;
+	}
+}
+
+void Scheduler::restart()
+{
+	// From the next tick, as in add().
+	uint32_t n = now() + 1;
+	for (uint8_t i = 0; i < num; i++)
+	{
+		tasks[i].release = n;
+		tasks[i].prev = n - tasks[i].period;
+	}
+}
+
+void Scheduler::reset_stats()
+{
+	for (uint8_t i = 0; i < num; i++)
+	{
+		tasks[i].runs = 0;
+		tasks[i].overruns = 0;
+		tasks[i].late_max = 0;
+		tasks[i].late_sum = 0;
+		tasks[i].exec_max = 0;
+	}
+}
+
+void Scheduler::print(Print &out)
+{
+	for (uint8_t i = 0; i < num; i++)
+	{
+		Task &t = tasks[i];
+		uint32_t mean = t.runs ? t.late_sum/t.runs : 0;
+		out << t.name << ' ' << t.runs << ' ' << t.overruns << ' ' << mean <<
+			' ' << t.late_max << ' ' << t.exec_max << '\n';
+	}
+}
@@ -23,33 +23,45 @@
  * ========================================================================== */
 
 #include <Arduino.h>
-#include "config.h"
-#include "rotation.h"
+#include "screen.hpp"
 
 
-void body_to_inertial(float *input, float *angles, float *output)
+Screen::Screen(float limit)
 {
-	// Pre-compute trig functions.
-	float spsi = sin(angles[0]*D2R);
-	float sthe = sin(angles[1]*D2R);
-	float sphi = sin(angles[2]*D2R);
-	float cpsi = cos(angles[0]*D2R);
-	float cthe = cos(angles[1]*D2R);
-	float cphi = cos(angles[2]*D2R);
+	this->limit = limit;
+	this->rejected = 0;
+	clear();
+}
+
+void Screen::clear()
+{
+	this->head = 0;
+	this->num = 0;
+}
+
+float Screen::add(float x)
+{
+	this->window[this->head] = x;
+	this->head = (this->head + 1) % SCREEN_LEN;
+	if (this->num < SCREEN_LEN)
+		this->num++;
 
-	// Calculate rotation matrix for Euler transformation.
-	float r11 =  cthe*cpsi;
-	float r12 = -cphi*spsi + sphi*sthe*cpsi;
-	float r13 = -sphi*spsi + cphi*sthe*cpsi;
-	float r21 =  cthe*spsi;
-	float r22 =  cphi*cpsi + sphi*sthe*spsi;
-	float r23 =  sphi*cpsi + cphi*sthe*spsi;
-	float r31 = -sthe;
-	float r32 =  sphi*cthe;
-	float r33 =  cphi*cthe;
+	// Insertion sort a copy, which for a handful of samples is as quick as
+	// anything.
+	float sorted[SCREEN_LEN];
+	for (int i = 0; i < this->num; i++)
+	{
+		float v = this->window[i];
+		int j = i;
+		for (; j > 0 && sorted[j-1] > v; j--)
+			sorted[j] = sorted[j-1];
+		sorted[j] = v;
+	}
 
-	// Calculate matrix.
-	output[0] = r11*input[0] + r12*input[1] + r13*input[2];
-	output[1] = r21*input[0] + r22*input[1] + r23*input[2];
-	output[2] = r31*input[0] + r32*input[1] + r33*input[2];
+	// With an even number kept, while filling, the lower of the middle two.
+	float median = sorted[(this->num - 1)/2];
+	if (fabs(x - median) <= this->limit)
+		return x;
+	this->rejected++;
+	return median;
 }
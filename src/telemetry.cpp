@@ -0,0 +1,308 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+#include <Arduino.h>
+#include "streaming.h"
+#include "protocol.hpp"
+#include "telemetry.hpp"
+
+
+// Longest a float can get when printed with 6 decimals, plus a space. Anything
+// past 2^32 prints as "ovf".
+#define TEXT_FLOAT_LEN 20
+
+// Longest the "l <ms> <mask>" prefix and newline can get.
+#define TEXT_PREFIX_LEN 20
+
+// Longest a binary record can get: time, tag, and the values.
+#define BINARY_LEN (5 + 4*TLM_MAX_VALUES)
+
+static_assert(2 + TEXT_PREFIX_LEN + TEXT_FLOAT_LEN*TLM_MAX_VALUES <= TLM_BUFFER,
+		"a record of every field might never fit in TLM_BUFFER");
+static_assert(BINARY_LEN <= PROTO_MAX_PAYLOAD,
+		"a record of every field doesn't fit in a frame");
+
+
+Telemetry::Telemetry()
+{
+	for (int i = 0; i < NUM_TLM_FIELDS; i++)
+	{
+		this->decim[i] = 0;
+		this->count[i] = 0;
+	}
+	this->head = 0;
+	this->tail = 0;
+	this->used = 0;
+	this->pending = 0;
+	this->dropped = 0;
+	this->modes = 0;
+}
+
+void Telemetry::subscribe(uint8_t mask, uint16_t decim)
+{
+	for (int i = 0; i < NUM_TLM_FIELDS; i++)
+	{
+		if (mask & (1U << i))
+		{
+			this->decim[i] = decim;
+			this->count[i] = 0;
+		}
+	}
+}
+
+// Points to the values of a field inside a snapshot.
+static const float *field(const Snapshot &s, int f, uint8_t *len)
+{
+	switch (f)
+	{
+		case TLM_CURRENT:
+			*len = DOF;
+			return s.current;
+		case TLM_DESIRED:
+			*len = DOF;
+			return s.desired;
+		case TLM_PID:
+			*len = DOF;
+			return s.pid;
+		case TLM_THRUST:
+			*len = NUM_MOTORS;
+			return s.thrust;
+		case TLM_RAW:
+			*len = TLM_RAW_LEN;
+			return s.raw;
+		case TLM_NAV:
+			*len = TLM_NAV_LEN;
+			return s.nav;
+		case TLM_REJECT:
+			*len = TLM_REJECT_LEN;
+			return s.reject;
+	}
+	*len = 0;
+	return NULL;
+}
+
+size_t Telemetry::write(uint8_t c)
+{
+	buf[head] = c;
+	head = (head + 1) % TLM_BUFFER;
+	used++;
+	return 1;
+}
+
+// Throws away what was formatted for a mode the link has since left, which
+// would otherwise go out in the middle of the new mode's stream, and at its
+// baud rate.
+void Telemetry::sync(Link &link)
+{
+	if (modes == link.modes)
+		return;
+	modes = link.modes;
+	if (pending)
+	{
+		tail = (tail + pending) % TLM_BUFFER;
+		used -= pending;
+		pending = 0;
+		dropped++;
+	}
+	while (used)
+	{
+		uint16_t len = buf[tail] | (uint16_t)buf[(tail + 1) % TLM_BUFFER] << 8;
+		tail = (tail + 2 + len) % TLM_BUFFER;
+		used -= 2 + len;
+		dropped++;
+	}
+}
+
+void Telemetry::record(const Snapshot &s, Link &link)
+{
+	// Work out which fields are due this tick.
+	uint8_t mask = 0;
+	for (int i = 0; i < NUM_TLM_FIELDS; i++)
+	{
+		if (decim[i] && ++count[i] >= decim[i])
+		{
+			count[i] = 0;
+			mask |= 1U << i;
+		}
+	}
+	if (!mask)
+		return;
+
+	float v[TLM_MAX_VALUES];
+	int n = 0;
+	for (int i = 0; i < NUM_TLM_FIELDS; i++)
+	{
+		if (!(mask & (1U << i)))
+			continue;
+		uint8_t len;
+		const float *f = field(s, i, &len);
+		for (int j = 0; j < len; j++)
+			v[n++] = f[j];
+	}
+	values('l', s.time, mask, v, n, link);
+}
+
+void Telemetry::values(char id, uint32_t time, uint8_t tag, const float *v, int n,
+		Link &link)
+{
+	sync(link);
+	if (link.binary)
+	{
+		uint8_t payload[BINARY_LEN];
+		size_t k = 0;
+		payload[k++] = time & 0xFF;
+		payload[k++] = (time >> 8) & 0xFF;
+		payload[k++] = (time >> 16) & 0xFF;
+		payload[k++] = time >> 24;
+		payload[k++] = tag;
+		for (int j = 0; j < n; j++, k += 4)
+			proto_put_float(payload + k, v[j]);
+		bytes(id, payload, k, link);
+		return;
+	}
+
+	// The length of a text record isn't known until it has been printed, so
+	// check for room a value at a time, as if it printed as long as it could,
+	// and take the record back out if the buffer runs out partway.
+	if (TLM_BUFFER - used < TEXT_PREFIX_LEN + 2)
+	{
+		dropped++;
+		return;
+	}
+	uint16_t len_idx = head, was = used;
+	write((uint8_t)0);
+	write((uint8_t)0);
+	uint16_t start = used;
+	*this << id << ' ' << time << ' ' << tag;
+	for (int j = 0; j < n; j++)
+	{
+		if (TLM_BUFFER - used < TEXT_FLOAT_LEN + 1)
+		{
+			head = len_idx;
+			used = was;
+			dropped++;
+			return;
+		}
+		*this << ' ' << _FLOAT(v[j], 6);
+	}
+	*this << '\n';
+	uint16_t m = used - start;
+	buf[len_idx] = m & 0xFF;
+	buf[(len_idx + 1) % TLM_BUFFER] = m >> 8;
+}
+
+void Telemetry::bytes(char id, const uint8_t *payload, size_t len, Link &link)
+{
+	sync(link);
+	if (link.binary)
+	{
+		uint8_t frame[PROTO_MAX_FRAME];
+		size_t m = proto_encode(id, link.push_seq++, payload, len, frame);
+		if (m == 0 || (size_t)(TLM_BUFFER - used) < m + 2)
+		{
+			dropped++;
+			return;
+		}
+		write(m & 0xFF);
+		write(m >> 8);
+		write(frame, m);
+		return;
+	}
+
+	static const char HEX_DIGITS[] = "0123456789abcdef";
+	size_t m = 2 + 2*len + 1;
+	if ((size_t)(TLM_BUFFER - used) < m + 2)
+	{
+		dropped++;
+		return;
+	}
+	write(m & 0xFF);
+	write(m >> 8);
+	write(id);
+	write(' ');
+	for (size_t i = 0; i < len; i++)
+	{
+		write(HEX_DIGITS[payload[i] >> 4]);
+		write(HEX_DIGITS[payload[i] & 0xF]);
+	}
+	write('\n');
+}
+
+void Telemetry::push(char id, const float *v, uint8_t n, int digits,
+		Link &link)
+{
+	sync(link);
+	if (link.binary)
+	{
+		uint8_t payload[4*CMD_MAX_ARGS];
+		for (int i = 0; i < n; i++)
+			proto_put_float(payload + 4*i, v[i]);
+		bytes(id, payload, 4*n, link);
+		return;
+	}
+
+	// Few enough values that the room is checked for all of them at once.
+	if (TLM_BUFFER - used < 2 + 2 + TEXT_FLOAT_LEN*n)
+	{
+		dropped++;
+		return;
+	}
+	uint16_t len_idx = head;
+	write((uint8_t)0);
+	write((uint8_t)0);
+	uint16_t start = used;
+	*this << id;
+	for (int i = 0; i < n; i++)
+		*this << ' ' << _FLOAT(v[i], digits);
+	*this << '\n';
+	uint16_t m = used - start;
+	buf[len_idx] = m & 0xFF;
+	buf[(len_idx + 1) % TLM_BUFFER] = m >> 8;
+}
+
+void Telemetry::flush(Link &link)
+{
+	sync(link);
+	// Frames the link has queued go first, so nothing lands in their middle.
+	if (!link.pump())
+		return;
+	int room = link.port->availableForWrite();
+	while (room > 0 && (pending || used))
+	{
+		if (!pending)
+		{
+			// Start the next record.
+			pending = buf[tail];
+			pending |= (uint16_t)buf[(tail + 1) % TLM_BUFFER] << 8;
+			tail = (tail + 2) % TLM_BUFFER;
+			used -= 2;
+			continue;
+		}
+		link.port->write(buf[tail]);
+		tail = (tail + 1) % TLM_BUFFER;
+		used--;
+		pending--;
+		room--;
+	}
+}
@@ -0,0 +1,81 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+#include <Arduino.h>
+#include "config.h"
+#include "util.hpp"
+#include "trajectory.hpp"
+
+
+Trajectory::Trajectory()
+{
+	stop();
+}
+
+void Trajectory::stop()
+{
+	for (int i = 0; i < DOF; i++)
+		this->vel[i] = 0.;
+}
+
+void Trajectory::step(const float *target, float *desired, float dt)
+{
+	for (int i = 0; i < DOF; i++)
+	{
+		float vmax = TRAJECTORY[i][0];
+		float amax = TRAJECTORY[i][1];
+		bool angle = i >= BODY_DOF;
+		float e = angle ? angle_difference(target[i], desired[i]) :
+			target[i] - desired[i];
+
+		// No limits means steps, as if there were no trajectory.
+		if (!SHAPE_SETPOINTS || vmax <= 0. || amax <= 0.)
+		{
+			desired[i] = target[i];
+			vel[i] = 0.;
+			continue;
+		}
+
+		// Fastest speed that can still stop on the target, which is the
+		// deceleration side of the trapezoid. Speed changes are limited to
+		// the acceleration, which gives the acceleration side.
+		float v = sqrt(2.*amax*fabs(e));
+		if (v > vmax)
+			v = vmax;
+		if (e < 0.)
+			v = -v;
+		vel[i] += limit(v - vel[i], -amax*dt, amax*dt);
+
+		// Land on the target instead of stepping over it.
+		if (e*vel[i] >= 0. && fabs(e) <= fabs(vel[i])*dt)
+		{
+			desired[i] = target[i];
+			vel[i] = 0.;
+		}
+		else if (angle)
+			desired[i] = angle_add(desired[i], vel[i]*dt);
+		else
+			desired[i] += vel[i]*dt;
+	}
+}
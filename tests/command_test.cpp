@@ -0,0 +1,184 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+
+/**
+ * Feeds the console lexer input split, run together and garbled the ways it
+ * comes off the serial port, then drains it through a Link the way the
+ * command task does and checks that a drain never waits for more input.
+ */
+#include <Arduino.h>
+#include <string.h>
+#include "command.hpp"
+#include "link.hpp"
+#include "sim.h"
+#include "check.h"
+
+// Commands that came out, as their letter and arguments, eg "p 0.5 ".
+static char out[256];
+
+static void got(const Command &cmd)
+{
+	size_t n = strlen(out);
+	n += snprintf(out + n, sizeof(out) - n, "%c", cmd.op);
+	for (int i = 0; i < cmd.argc; i++)
+		n += snprintf(out + n, sizeof(out) - n, " %g", cmd.args[i]);
+	snprintf(out + n, sizeof(out) - n, ";");
+}
+
+// Feeds s to lexer, as one chunk and then flushed the way Link::poll() does
+// once the port is empty.
+static void feed(CommandLexer &lexer, const char *s)
+{
+	for (; *s; s++)
+		if (lexer.feed(*s))
+			got(lexer.cmd);
+	if (lexer.flush())
+		got(lexer.cmd);
+}
+
+// What a fresh lexer makes of s.
+static const char *lex(const char *s)
+{
+	CommandLexer lexer;
+	out[0] = '\0';
+	feed(lexer, s);
+	return out;
+}
+
+static void split()
+{
+	// Every place a command can be cut in two, with the second half coming
+	// in a later poll.
+	const char *s = "s 1. -2 3.5 4 +5 6\n";
+	for (size_t i = 0; i < strlen(s); i++)
+	{
+		char a[32];
+		memcpy(a, s, i);
+		a[i] = '\0';
+		CommandLexer lexer;
+		out[0] = '\0';
+		feed(lexer, a);
+		CHECK(out[0] == '\0');
+		feed(lexer, s + i);
+		CHECK(!strcmp(out, "s 1 -2 3.5 4 5 6;"));
+	}
+
+	// One byte a poll.
+	CommandLexer lexer;
+	out[0] = '\0';
+	for (const char *p = "p 0.5c z 2\n"; *p; p++)
+	{
+		char b[2] = { *p, '\0' };
+		feed(lexer, b);
+	}
+	CHECK(!strcmp(out, "p 0.5;c;z 2;"));
+}
+
+static void together()
+{
+	// A command letter ending the last argument starts a command of its own.
+	CHECK(!strcmp(lex("p 0.5c"), "p 0.5;c;"));
+	CHECK(!strcmp(lex("z -1.5p2\n"), "z -1.5;p 2;"));
+	CHECK(!strcmp(lex("p 1s1 2 3 4 5 6c"), "p 1;s 1 2 3 4 5 6;c;"));
+	CHECK(!strcmp(lex("i 1e 0\n"), "i 1;e 0;"));
+	CHECK(!strcmp(lex("cdf"), "c;d;f;"));
+
+	// Stray numbers and unknown letters between commands are ignored.
+	CHECK(!strcmp(lex("12 q p 3\n"), "p 3;"));
+}
+
+static void garbled()
+{
+	// A command cut short by the next one is dropped, not run.
+	CommandLexer lexer;
+	out[0] = '\0';
+	feed(lexer, "s 1 2 c p 3\n");
+	CHECK(!strcmp(out, "c;p 3;"));
+	CHECK(lexer.dropped == 1);
+
+	// So is one with a number too long to be sane, up to the next command.
+	out[0] = '\0';
+	feed(lexer, "p 1234567890123456789 c z 1\n");
+	CHECK(!strcmp(out, "c;z 1;"));
+	CHECK(lexer.dropped == 2);
+
+	// reset() forgets a held command letter too.
+	out[0] = '\0';
+	for (const char *p = "p 2c"; *p; p++)
+		if (lexer.feed(*p))
+			got(lexer.cmd);
+	lexer.reset();
+	CHECK(!lexer.flush());
+	CHECK(!strcmp(out, "p 2;"));
+}
+
+static void drain()
+{
+	// Fill the receive buffer with commands, a half command at the end, and
+	// drain it the way task_command() does. Nothing in the link may wait on
+	// the clock: in the sim the clock only moves when told to, so a wait
+	// would never return, and the clock has to be where it started.
+	Link link(Serial);
+	link.begin();
+	sim_clock_set(5000000);
+
+	char buf[256];
+	size_t n = 0;
+	while (n + 16 < sizeof(buf))
+		n += snprintf(buf + n, sizeof(buf) - n, "s 1 2 3 4 5 6\nc");
+	n += snprintf(buf + n, sizeof(buf) - n, "p 0.");
+	Serial.receive(buf, n);
+	int queued = Serial.available();
+	CHECK(queued > 200);
+
+	Command cmd;
+	int polls = 0, runs = 0;
+	out[0] = '\0';
+	while (link.poll(cmd))
+	{
+		polls++;
+		if (cmd.op == 's' && cmd.argc == 6 && cmd.args[5] == 6.f)
+			runs++;
+		else if (cmd.op == 'c')
+			runs++;
+	}
+	CHECK(Serial.available() == 0);
+	CHECK(sim_clock() == 5000000);
+	CHECK(runs == polls && polls == 2*(int)((n - 4)/15));
+
+	// The half command waits in the lexer, not in poll().
+	CHECK(!link.poll(cmd));
+	Serial.receive("25\n", 3);
+	CHECK(link.poll(cmd) && cmd.op == 'p' && cmd.args[0] == 0.25f);
+	CHECK(!link.poll(cmd));
+}
+
+void test_command()
+{
+	split();
+	together();
+	garbled();
+	drain();
+}
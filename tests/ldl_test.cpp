@@ -0,0 +1,164 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+/**
+ * Factors a set of badly conditioned and broken matrices with ldl() in float
+ * and checks what it reports for each, and that the ones it takes as
+ * positive definite solve to within rounding.
+ */
+#include <math.h>
+#include <stdlib.h>
+#include <Arduino.h>
+#include "matrix.hpp"
+#include "check.h"
+
+// Smallest pivot kept, as SOLVE_TOL in kalman.hpp.
+#define TOL 1e-5f
+
+// Largest relative residual taken as rounding.
+#define RESIDUAL 1e-5
+
+template <int n>
+static void spd(double *A)
+{
+	// B*B' + I, with B from a fixed seed.
+	double B[n*n];
+	srand(5);
+	for (int i = 0; i < n*n; i++)
+		B[i] = rand()/(double)RAND_MAX - 0.5;
+	for (int i = 0; i < n; i++)
+		for (int j = 0; j < n; j++)
+		{
+			A[i*n+j] = i == j ? 1. : 0.;
+			for (int k = 0; k < n; k++)
+				A[i*n+j] += B[i*n+k]*B[j*n+k];
+		}
+}
+
+template <int n>
+static void scaled(double *A)
+{
+	// Variances from 1e-6 to 1e6, like meters against a bias.
+	spd<n>(A);
+	for (int i = 0; i < n; i++)
+		for (int j = 0; j < n; j++)
+			A[i*n+j] *= pow(10., 12.*i/(n - 1) - 6.)*pow(10., 12.*j/(n - 1) - 6.);
+}
+
+template <int n>
+static void singular(double *A)
+{
+	// The first two rows and columns the same.
+	spd<n>(A);
+	for (int j = 0; j < n; j++)
+		A[n+j] = A[j*n+1] = A[j];
+	A[n+1] = A[0];
+}
+
+template <int n>
+static void indefinite(double *A)
+{
+	spd<n>(A);
+	A[(n/2)*n+n/2] = -A[(n/2)*n+n/2];
+}
+
+template <int n>
+static void zero_diagonal(double *A)
+{
+	spd<n>(A);
+	A[0] = 0.;
+}
+
+template <int n>
+static void not_finite(double *A)
+{
+	spd<n>(A);
+	A[1] = A[n] = NAN;
+}
+
+// Factors A in float and solves A*x = b for the x of 1, 2, 3... Returns what
+// ldl() reported, and the relative residual |A*x - b|/|b| in r.
+template <int n>
+static int solve(const double *A, double *r)
+{
+	double b[n];
+	float L[n*(n+1)/2], x[n];
+	for (int i = 0; i < n; i++)
+	{
+		b[i] = 0.;
+		for (int j = 0; j < n; j++)
+			b[i] += A[i*n+j]*(j + 1.);
+		x[i] = b[i];
+	}
+	for (int i = 0, k = 0; i < n; i++)
+		for (int j = i; j < n; j++)
+			L[k++] = A[i*n+j];
+	SymRef<n> LD(L);
+	int result = ldl(LD, TOL);
+	*r = NAN;
+	if (result == LDL_NOT_FINITE)
+		return result;
+	ldl_solve(LD, Ref<n, 1>(x));
+	double rr = 0., bb = 0.;
+	for (int i = 0; i < n; i++)
+	{
+		double e = -b[i];
+		for (int j = 0; j < n; j++)
+			e += A[i*n+j]*x[j];
+		rr += e*e;
+		bb += b[i]*b[i];
+	}
+	*r = sqrt(rr/bb);
+	return result;
+}
+
+template <int n>
+static void cases()
+{
+	double A[n*n], r;
+
+	spd<n>(A);
+	CHECK(solve<n>(A, &r) == LDL_OK && r < RESIDUAL);
+	scaled<n>(A);
+	CHECK(solve<n>(A, &r) == LDL_OK && r < RESIDUAL);
+
+	// Pivots that are rounding or negative are dropped and reported.
+	singular<n>(A);
+	CHECK(solve<n>(A, &r) == LDL_DEFICIENT);
+	indefinite<n>(A);
+	CHECK(solve<n>(A, &r) == LDL_DEFICIENT);
+	zero_diagonal<n>(A);
+	CHECK(solve<n>(A, &r) == LDL_DEFICIENT);
+
+	// A NaN is never taken as a pivot too small to keep.
+	not_finite<n>(A);
+	CHECK(solve<n>(A, &r) == LDL_NOT_FINITE);
+}
+
+void test_ldl()
+{
+	// The sizes of a measurement and of the state.
+	cases<2>();
+	cases<8>();
+}
@@ -0,0 +1,138 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+
+/**
+ * Checks the link's baud rate switch, its fall back to the old rate when
+ * nothing valid comes in at the new one, and that binary frames and the
+ * switch behind them wait on the transmit buffer without blocking.
+ */
+#include <Arduino.h>
+#include "link.hpp"
+#include "protocol.hpp"
+#include "sim.h"
+#include "check.h"
+
+// Receives a binary command frame as if topside had sent it.
+static void receive(char id, const float *v, int n)
+{
+	uint8_t payload[4*CMD_MAX_ARGS] = { 0 }, frame[PROTO_MAX_FRAME];
+	for (int i = 0; i < n; i++)
+		proto_put_float(payload + 4*i, v[i]);
+	size_t m = proto_encode(id, 1, payload, 4*n, frame);
+	Serial.receive((const char *)frame, m);
+}
+
+static void later(uint32_t ms)
+{
+	sim_clock_set(sim_clock() + 1000ULL*ms);
+}
+
+static void modes(Link &link)
+{
+	Command cmd;
+
+	// Only rates the link supports are taken.
+	CHECK(!link_baud_ok(0) && !link_baud_ok(12345) && link_baud_ok(115200));
+	CHECK(!link.set_mode(12345, true));
+	CHECK(link.baud == LINK_BAUD && !link.binary && !link.trial);
+
+	// With nothing coming in at the new rate, it goes back to the old one
+	// once LINK_FALLBACK_MS is up, and not before.
+	CHECK(link.set_mode(115200, true));
+	CHECK(link.baud == 115200 && link.binary);
+	later(LINK_FALLBACK_MS - 1);
+	CHECK(!link.poll(cmd));
+	CHECK(link.baud == 115200 && link.binary);
+	later(1);
+	CHECK(!link.poll(cmd));
+	CHECK(link.baud == LINK_BAUD && !link.binary);
+
+	// A frame that doesn't decode doesn't count.
+	CHECK(link.set_mode(115200, true));
+	Serial.receive("\x05junk\0", 6);
+	CHECK(!link.poll(cmd));
+	later(LINK_FALLBACK_MS);
+	CHECK(!link.poll(cmd));
+	CHECK(link.baud == LINK_BAUD && !link.binary);
+
+	// A valid command keeps the new rate for good.
+	CHECK(link.set_mode(115200, true));
+	later(100);
+	receive('c', NULL, 0);
+	CHECK(link.poll(cmd) && cmd.op == 'c');
+	later(10*LINK_FALLBACK_MS);
+	CHECK(!link.poll(cmd));
+	CHECK(link.baud == 115200 && link.binary && !link.trial);
+
+	// And back to console mode, which a typed command confirms.
+	CHECK(link.set_mode(57600, false));
+	Serial.receive("c\n", 2);
+	CHECK(link.poll(cmd) && cmd.op == 'c');
+	later(10*LINK_FALLBACK_MS);
+	CHECK(!link.poll(cmd));
+	CHECK(link.baud == 57600 && !link.binary);
+}
+
+static void queue(Link &link)
+{
+	// At 9600 baud replies come faster than they go out. send() must leave
+	// what doesn't fit in the transmit buffer in its queue, and throw frames
+	// away once that is full, without the clock moving.
+	CHECK(link.set_mode(9600, true));
+	float v[6] = { 1., 2., 3., 4., 5., 6. };
+	uint64_t t = sim_clock();
+	for (int i = 0; i < 20; i++)
+		link.push('c', v, 6, 6);
+	CHECK(sim_clock() == t);
+	CHECK(Serial.availableForWrite() == 0);
+	CHECK(link.queued > 0 && link.queued <= LINK_QUEUE);
+	CHECK(link.unsent > 0 && link.unsent < 20);
+	CHECK(!link.pump());
+
+	// A switch waits for them to go out at the old rate, again without the
+	// clock moving, and nothing is read until it is made.
+	Command cmd;
+	CHECK(link.set_mode(115200, true));
+	CHECK(sim_clock() == t);
+	CHECK(link.baud == 9600 && link.next_baud == 115200);
+	receive('c', NULL, 0);
+	CHECK(!link.poll(cmd));
+
+	// It drains as the port catches up, and then the rate changes.
+	for (int i = 0; i < 100 && !link.pump(); i++)
+		later(10);
+	CHECK(link.queued == 0);
+	CHECK(link.baud == 115200 && link.next_baud == 0);
+	CHECK(link.poll(cmd) && cmd.op == 'c');
+}
+
+void test_link()
+{
+	Link link(Serial);
+	link.begin();
+	sim_clock_set(1000000);
+	modes(link);
+	queue(link);
+}
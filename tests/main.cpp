@@ -0,0 +1,52 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+
+/**
+ * Host tests of the parts of the firmware that don't need the sub, built by
+ * the test env (make test). Prints what fails and exits nonzero if anything
+ * did.
+ */
+#include <stdio.h>
+#include "check.h"
+
+int failures = 0;
+
+int main()
+{
+	// The sim's serial port writes what the sub sends to stdout, which is
+	// of no use here.
+	freopen("/dev/null", "w", stdout);
+
+	test_scheduler();
+	test_command();
+	test_telemetry();
+	test_link();
+	test_ldl();
+	if (failures)
+		fprintf(stderr, "%d checks failed\n", failures);
+	else
+		fprintf(stderr, "all checks passed\n");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+
+/**
+ * Drives the scheduler off the simulator's clock, a tick a millisecond as
+ * the timer would, and checks that tasks run at their rates with the dt
+ * they should get, and that lateness, stalls and overruns are counted as
+ * they happen.
+ */
+#include <Arduino.h>
+#include "scheduler.hpp"
+#include "sim.h"
+#include "check.h"
+
+// What each task saw.
+struct Seen
+{
+	uint32_t runs;
+	float dt_min, dt_max;
+};
+
+static Scheduler *sched;
+static Seen seen[4];
+
+// Run of task 1 that stalls, and for how many ticks.
+static uint32_t stall_at;
+static int stall_ticks;
+
+// The timer raising one tick.
+static void tick()
+{
+	sim_clock_set(sim_clock() + SCHED_TICK_US);
+	sched->tick(micros());
+}
+
+template <int i>
+static void task(float dt)
+{
+	Seen &s = seen[i];
+	s.dt_min = s.runs ? fmin(s.dt_min, dt) : dt;
+	s.dt_max = s.runs ? fmax(s.dt_max, dt) : dt;
+	s.runs++;
+	if (i == 1 && s.runs == stall_at)
+		for (int k = 0; k < stall_ticks; k++)
+			tick();
+}
+
+// Ticks n times, with loop() coming round after us microseconds each time.
+static void run(int n, uint32_t us)
+{
+	for (int k = 0; k < n; k++)
+	{
+		tick();
+		sim_clock_set(sim_clock() + us);
+		sched->run();
+		sim_clock_set(sim_clock() - us);
+	}
+}
+
+// A new scheduler with its tick count at ticks.
+static void start(uint32_t ticks)
+{
+	delete sched;
+	sched = new Scheduler();
+	sched->ticks = ticks;
+	sim_clock_set(1000000);
+	for (int i = 0; i < 4; i++)
+		seen[i].runs = 0;
+	stall_at = 0;
+	stall_ticks = 0;
+}
+
+static void rates()
+{
+	// 10 s with loop() keeping up, then 10 s with it 300 us behind each
+	// tick. The first release is the tick after add().
+	static const uint16_t HZ[4] = { 1000, 100, 50, 8 };
+	start(0);
+	sched->add("a", task<0>, HZ[0]);
+	sched->add("b", task<1>, HZ[1]);
+	sched->add("c", task<2>, HZ[2]);
+	sched->add("d", task<3>, HZ[3]);
+	run(10*SCHED_HZ, 0);
+	for (int i = 0; i < 4; i++)
+	{
+		const Task &t = sched->tasks[i];
+		CHECK(seen[i].runs == 10U*HZ[i]);
+		CHECK(t.runs == seen[i].runs);
+		CHECK(seen[i].dt_min == 1.f/HZ[i] && seen[i].dt_max == 1.f/HZ[i]);
+		CHECK(t.overruns == 0);
+		CHECK(t.late_max == 0);
+	}
+
+	sched->reset_stats();
+	run(10*SCHED_HZ, 300);
+	for (int i = 0; i < 4; i++)
+	{
+		const Task &t = sched->tasks[i];
+		CHECK(t.runs == 10U*HZ[i]);
+		CHECK(t.overruns == 0);
+		CHECK(t.late_max == 300 && t.late_sum == 300*t.runs);
+	}
+}
+
+static void stall()
+{
+	// Task 1 stalls for 35 ticks on its 10th run, at tick 181. Task 0 ran
+	// just before it, so when the scheduler next comes round at tick 217
+	// its release at 191 is 26 ticks late: two releases are skipped and the
+	// run for 211 is six ticks late, 30 ms after the last. Task 1's own
+	// release at 201 is 16 ticks late.
+	start(0);
+	sched->add("a", task<0>, 100);
+	sched->add("b", task<1>, 50);
+	stall_at = 10;
+	stall_ticks = 35;
+	run(1000, 0);
+	const Task &a = sched->tasks[0], &b = sched->tasks[1];
+	CHECK(a.overruns == 2);
+	CHECK(a.late_max == 6000);
+	CHECK(seen[0].dt_min == 0.01f && seen[0].dt_max == 0.03f);
+	CHECK(b.overruns == 0);
+	CHECK(b.late_max == 16000);
+	CHECK(b.exec_max == 35000);
+	CHECK(seen[1].dt_max == 0.02f);
+}
+
+static void wrap()
+{
+	// The tick count wraps around partway through.
+	start(0xFFFFFFFFUL - 500);
+	sched->add("a", task<0>, 100);
+	run(2000, 0);
+	const Task &a = sched->tasks[0];
+	CHECK(seen[0].runs == 200);
+	CHECK(a.overruns == 0 && a.late_max == 0);
+	CHECK(seen[0].dt_min == 0.01f && seen[0].dt_max == 0.01f);
+}
+
+static void pause()
+{
+	// Ticks go by for half a second without loop() running, then the
+	// scheduler is restarted as it is after a pause, so nothing is counted
+	// as missed and dt is one period.
+	start(0);
+	sched->add("a", task<0>, 100);
+	run(100, 0);
+	for (int k = 0; k < 500; k++)
+		tick();
+	sched->restart();
+	run(100, 0);
+	const Task &a = sched->tasks[0];
+	CHECK(seen[0].runs == 20);
+	CHECK(a.overruns == 0 && a.late_max == 0);
+	CHECK(seen[0].dt_max == 0.01f);
+}
+
+void test_scheduler()
+{
+	rates();
+	stall();
+	wrap();
+	pause();
+}
@@ -0,0 +1,130 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2019 AVBotz
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * ========================================================================== */
+
+
+/**
+ * Queues telemetry records of every size into the ring buffer and checks
+ * that the biggest still fit, that a record that runs out of room partway
+ * is taken back out whole and counted, that pushed messages queue like
+ * records, and that a change of mode throws away what was queued before.
+ */
+#include <string.h>
+#include <Arduino.h>
+#include "telemetry.hpp"
+#include "check.h"
+
+// Walks the records in the buffer, checking each is one whole line. Returns
+// how many there are, or -1 if any isn't.
+static int records(const Telemetry &t)
+{
+	int n = 0;
+	uint16_t i = t.tail, left = t.used;
+	while (left)
+	{
+		if (left < 2)
+			return -1;
+		uint16_t len = t.buf[i] | (uint16_t)t.buf[(i + 1) % TLM_BUFFER] << 8;
+		if (len == 0 || len > left - 2)
+			return -1;
+		for (uint16_t k = 0; k < len; k++)
+		{
+			char c = t.buf[(i + 2 + k) % TLM_BUFFER];
+			if ((c == '\n') != (k == len - 1))
+				return -1;
+		}
+		i = (i + 2 + len) % TLM_BUFFER;
+		left -= 2 + len;
+		n++;
+	}
+	return n;
+}
+
+void test_telemetry()
+{
+	Link link(Serial);
+	float v[TLM_MAX_VALUES];
+	for (int i = 0; i < TLM_MAX_VALUES; i++)
+		v[i] = -123.456789f*(i + 1);
+
+	// Every field at once goes into an empty buffer.
+	Telemetry *t = new Telemetry();
+	t->values('l', 4294967295UL, 127, v, TLM_MAX_VALUES, link);
+	CHECK(t->dropped == 0);
+	CHECK(records(*t) == 1);
+
+	// Keep adding until they stop fitting. The one that doesn't fit is taken
+	// back out and the ones before it are left as they were.
+	int kept = 1;
+	while (t->dropped == 0)
+	{
+		uint16_t used = t->used, head = t->head;
+		t->values('l', 1000, 15, v, 3*DOF + NUM_MOTORS, link);
+		if (t->dropped)
+		{
+			CHECK(t->used == used && t->head == head);
+			break;
+		}
+		kept++;
+	}
+	CHECK(kept > 1);
+	CHECK(records(*t) == kept);
+
+	// Small records still go into what room is left, if there is enough for
+	// the length, the prefix and one value as long as telemetry.cpp allows
+	// for each.
+	bool room = TLM_BUFFER - t->used >= 2 + 20 + 20;
+	t->values('i', 1000, 1, v, 1, link);
+	CHECK(t->dropped == (room ? 1 : 2));
+	CHECK(records(*t) == kept + room);
+	delete t;
+
+	// A pushed message goes in as a record of its own, in the same form as
+	// Link::push() would have written it.
+	t = new Telemetry();
+	float m[3] = { 2., 1., 3. };
+	t->push('m', m, 3, 0, link);
+	CHECK(t->dropped == 0 && records(*t) == 1);
+	CHECK(t->used == 2 + 8 && memcmp(t->buf + 2, "m 2 1 3\n", 8) == 0);
+	delete t;
+
+	// Records still queued when the link changes mode are thrown away and
+	// counted, rather than going out in the middle of the new mode's stream.
+	t = new Telemetry();
+	t->values('l', 1000, 1, v, DOF, link);
+	t->push('m', m, 3, 0, link);
+	CHECK(records(*t) == 2);
+	CHECK(link.set_mode(115200, true));
+	t->flush(link);
+	CHECK(t->dropped == 2 && t->used == 0 && t->pending == 0);
+	CHECK(t->head == t->tail);
+	delete t;
+	CHECK(link.set_mode(LINK_BAUD, false));
+
+	// And every field at once fits in one frame in binary mode.
+	t = new Telemetry();
+	link.binary = true;
+	t->values('l', 1000, 127, v, TLM_MAX_VALUES, link);
+	CHECK(t->dropped == 0 && t->used > 4*TLM_MAX_VALUES);
+	delete t;
+}
@@ -0,0 +1,291 @@
+import os
+import re
+import sys
+
+
+# Works out the Kalman filter's steady state gains for include/kalman_gains.h,
+# eg
+#
+#     python gains.py > ../include/kalman_gains.h
+#
+# from the Qk, R and H tables in include/kalman.hpp, or the file given. Rerun
+# it whenever those change.
+#
+# With the AHRS and DVL at steady rates, the covariance settles into the same
+# pattern every half second whatever the state is, so the gains do too, and
+# the sub doesn't need to work them out over again. This runs the covariance
+# recursion of src/kalman.cpp on its own, with the sub facing north, until it
+# has settled, and keeps the gain and innovation covariance of each
+# correction by how long it had been since the last DVL correction, which is
+# what decides how much the velocity has wandered. The model is the same
+# along X and Y, so at any other heading the gains are these turned, which
+# the filter does as it goes. To cover the DVL missing pings, the run is
+# branched after every DVL correction into one where no more come until the
+# dropout. The covariance at that point is kept too, for the full filter to
+# start from when the DVL drops out.
+#
+# The position is never measured, so its variance never settles but grows at
+# a steady rate, which is kept as well.
+header = sys.argv[1] if len(sys.argv) > 1 else \
+    os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'include',
+                 'kalman.hpp')
+M = 2
+
+# Sensor rates the tables are for, in Hz, as the AHRS and DVL are set up.
+AHRS_HZ = 30.
+DVL_HZ = 8.
+
+# Number of bins of time since the last DVL correction, up to the dropout.
+BINS = 30
+
+# Seconds to let the covariance settle before keeping anything, and to keep
+# for.
+SETTLE = 120.
+KEEP = 10.
+
+# At 30 and 8 Hz, the pings fall on a grid of 1/120 s from the AHRS samples.
+# They are offset by these fractions of it to spread the times between them
+# over the bins.
+GRID = 1./120.
+PHASES = [0.1, 0.35, 0.6, 0.85]
+
+text = open(header).read()
+N = int(re.search(r'const int N = (\d+);', text).group(1))
+tables = {}
+for name, body in re.findall(r'static float (\w+)\[[^]]*\] = \{([^}]*)\}', text):
+    tables[name] = [float(x) for x in body.replace(',', ' ').split()]
+DROPOUT = int(re.search(r'#define DROPOUT_TIME (\d+)', text).group(1))/1e6
+BIN = DROPOUT/BINS
+
+
+def zeros(r, c):
+    return [[0.]*c for _ in range(r)]
+
+
+def mul(A, B):
+    Bt = list(zip(*B))
+    return [[sum(a*b for a, b in zip(row, col) if a) for col in Bt] for row in A]
+
+
+def T(A):
+    return [list(r) for r in zip(*A)]
+
+
+def rows(flat, r, c):
+    return [flat[i*c:(i + 1)*c] for i in range(r)]
+
+
+Q = rows(tables['Qk'], N, N)
+
+
+def predict(P, dt):
+    F = zeros(N, N)
+    for i in range(N):
+        F[i][i] = 1.
+    for k in (0, 3):
+        F[k][k + 1] = dt
+        F[k][k + 2] = dt*dt/2.
+        F[k + 1][k + 2] = dt
+    P = mul(mul(F, P), T(F))
+    return [[P[i][j] + Q[i][j]*dt for j in range(N)] for i in range(N)]
+
+
+# Rows for the accelerometer and DVL with the sub facing north, as
+# bias_rows() and Kalman::velocity() fill them in.
+Ha = rows(list(tables['Ha']), M, N)
+Ha[0][6] = 1.
+Ha[1][7] = 1.
+Hk = rows(list(tables['Hk']), M, N)
+Hk[0][2] = -0.5/DVL_HZ
+Hk[1][5] = -0.5/DVL_HZ
+Ra = rows(tables['Ra'], M, M)
+Rk = rows(tables['Rk'], M, M)
+
+
+# Gain and innovation covariance of a correction, and the covariance after it
+# in Joseph form.
+def correct(P, H, R):
+    PHt = mul(P, T(H))
+    S = mul(H, PHt)
+    S = [[S[i][j] + (R[i][j] if i == j else 0.) for j in range(M)]
+         for i in range(M)]
+    det = S[0][0]*S[1][1] - S[0][1]*S[1][0]
+    Si = [[S[1][1]/det, -S[0][1]/det], [-S[1][0]/det, S[0][0]/det]]
+    K = mul(PHt, Si)
+    IKH = [[(1. if i == j else 0.) - v for j, v in enumerate(row)]
+           for i, row in enumerate(mul(K, H))]
+    R = [[R[i][j] if i == j else 0. for j in range(M)] for i in range(M)]
+    P = mul(mul(IKH, P), T(IKH))
+    KRK = mul(mul(K, R), T(K))
+    P = [[P[i][j] + KRK[i][j] for j in range(N)] for i in range(N)]
+    return K, S, P
+
+
+def bin_of(since):
+    return min(int(since/BIN), BINS - 1)
+
+
+sums = {'accel': [None]*BINS, 'dvl': [None]*BINS}
+counts = {'accel': [0]*BINS, 'dvl': [0]*BINS}
+
+
+def keep(kind, since, K, S):
+    b = bin_of(since)
+    flat = [v for row in K for v in row] + [v for row in S for v in row]
+    if sums[kind][b] is None:
+        sums[kind][b] = flat
+    else:
+        sums[kind][b] = [a + v for a, v in zip(sums[kind][b], flat)]
+    counts[kind][b] += 1
+
+
+def events(phase, start, end, dvl=True):
+    # AHRS samples and DVL pings in time order, the AHRS first on a tie.
+    out = []
+    i = int(start*AHRS_HZ)
+    while i/AHRS_HZ < end:
+        if i/AHRS_HZ > start:
+            out.append((i/AHRS_HZ, 0))
+        i += 1
+    if dvl:
+        j = int(start*DVL_HZ) - 1
+        while True:
+            t = j/DVL_HZ + phase*GRID
+            if t >= end:
+                break
+            if t > start:
+                out.append((t, 1))
+            j += 1
+    return sorted(out)
+
+
+# Runs on from P at time t, after a DVL correction, with no more DVL until the
+# dropout. Returns the covariance then.
+def branch(P, t, phase):
+    last = t
+    for when, kind in events(phase, t, t + DROPOUT + BIN):
+        P = predict(P, when - last)
+        last = when
+        since = when - t
+        if since >= DROPOUT:
+            return P
+        if kind == 0:
+            K, S, P = correct(P, Ha, Ra)
+            keep('accel', since, K, S)
+        else:
+            # The gain the ping would have had, had it come.
+            K, S, _ = correct(P, Hk, Rk)
+            keep('dvl', since, K, S)
+    return P
+
+
+dropout = None
+dropouts = 0
+rates = []
+for phase in PHASES:
+    P = zeros(N, N)
+    for i in range(N):
+        P[i][i] = 1. if i < 6 else 0.04
+    last = 0.
+    valid = 0.
+    first = None
+    for when, kind in events(phase, 0., SETTLE + KEEP):
+        P = predict(P, when - last)
+        last = when
+        since = when - valid
+        if kind == 0:
+            K, S, P = correct(P, Ha, Ra)
+        else:
+            K, S, P = correct(P, Hk, Rk)
+            valid = when
+        if when < SETTLE:
+            continue
+        if first is None:
+            first = (when, P[0][0])
+        keep('accel' if kind == 0 else 'dvl', since, K, S)
+        if kind == 1:
+            D = branch(P, when, phase)
+            dropout = D if dropout is None else \
+                [[a + b for a, b in zip(r, s)] for r, s in zip(dropout, D)]
+            dropouts += 1
+    rates.append((P[0][0] - first[1])/(last - first[0]))
+
+
+# Averages each bin, filling empty ones in from the nearest on either side.
+def table(kind):
+    out = [None]*BINS
+    for b in range(BINS):
+        if counts[kind][b]:
+            out[b] = [v/counts[kind][b] for v in sums[kind][b]]
+    full = [b for b in range(BINS) if out[b] is not None]
+    for b in range(BINS):
+        if out[b] is not None:
+            continue
+        lo = max([x for x in full if x < b], default=None)
+        hi = min([x for x in full if x > b], default=None)
+        if lo is None or hi is None:
+            out[b] = out[hi if lo is None else lo]
+        else:
+            w = (b - lo)/float(hi - lo)
+            out[b] = [a + w*(c - a) for a, c in zip(out[lo], out[hi])]
+    return out
+
+
+def num(x):
+    return '%.6e' % x
+
+
+def emit(name, values, width, per_row):
+    print('static const float %s[STEADY_BINS][%s] PROGMEM = {' % (name, width))
+    lines = []
+    for v in values:
+        body = [', '.join(num(x) for x in v[i:i + per_row])
+                for i in range(0, len(v), per_row)]
+        lines.append('\t{\n\t\t' + ',\n\t\t'.join(body) + '\n\t}')
+    print(',\n'.join(lines))
+    print('};')
+    print()
+
+
+accel = table('accel')
+dvl = table('dvl')
+dropout = [[v/dropouts for v in r] for r in dropout]
+
+# The license at the top of kalman.hpp goes at the top of this too.
+print(text[:text.index('*/') + 2] + '\n')
+print('''/** @file kalman_gains.h
+ *  @brief Steady state gains of the Kalman filter, from tuning/gains.py.
+ *
+ *  Generated, so rerun the tool rather than editing by hand. Worked out with
+ *  the sub facing north, for the AHRS at %g Hz and the DVL at %g Hz. Each
+ *  table has a row for every %d us since the last DVL correction, up to the
+ *  dropout. See STEADY_GAINS.
+ */
+#ifndef KALMAN_GAINS_H
+#define KALMAN_GAINS_H
+
+#include <Arduino.h>
+
+/** Number of rows in each table, and microseconds of time since the last DVL
+ *  correction each covers. */
+#define STEADY_BINS %d
+#define STEADY_BIN %dUL
+
+/** Rate the variance of X and of Y grows at, in m^2/s. */
+#define STEADY_POSITION_RATE %s
+''' % (AHRS_HZ, DVL_HZ, int(round(BIN*1e6)), BINS, int(round(BIN*1e6)),
+       num(sum(rates)/len(rates))))
+
+print('/** Gains of the accelerometer correction, N by M, then the covariance of '
+      'its\n *  innovations, M by M. */')
+emit('STEADY_ACCEL', accel, 'N*M + M*M', M)
+print('/** Gains and innovation covariance of the DVL correction. */')
+emit('STEADY_DVL', dvl, 'N*M + M*M', M)
+print('/** Covariance of the state at the dropout, for the full filter to start\n'
+      ' *  from, as its upper triangle by rows. */')
+print('static const float STEADY_DROPOUT[N*(N+1)/2] PROGMEM = {')
+print(',\n'.join('\t' + ', '.join(num(x) for x in r[i:])
+                 for i, r in enumerate(dropout)))
+print('};')
+print()
+print('#endif')
@@ -0,0 +1,136 @@
+import struct
+import sys
+
+
+# Topside end of the binary protocol in include/protocol.hpp: CRC-XMODEM
+# checked messages, COBS encoded, each frame ending in a zero byte. As a
+# script it switches the sub to binary mode and prints what it sends in the
+# same format as console mode, so the other tools here can read the log, eg
+#
+#     python link.py /dev/ttyACM0 115200 'l 1 50' 'i 7' > run.txt
+#
+# Each command after the baud rate is sent as a frame once the switch is
+# made. A 'c' goes first, since the sub goes back to 9600 baud and console
+# mode if nothing valid reaches it at the new rate within 3 seconds.
+def crc_xmodem(data):
+    crc = 0
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = (crc << 1) ^ 0x1021 if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_idx = 0
+    code = 1
+    for b in data:
+        if b == 0:
+            out[code_idx] = code
+            code_idx = len(out)
+            out.append(0)
+            code = 1
+            continue
+        out.append(b)
+        code += 1
+        if code == 0xFF:
+            out[code_idx] = code
+            code_idx = len(out)
+            out.append(0)
+            code = 1
+    out[code_idx] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > len(data):
+            return None
+        out += data[i:i + code - 1]
+        i += code - 1
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode(id, seq, payload=b''):
+    msg = bytes([ord(id) if isinstance(id, str) else id, seq]) + payload
+    crc = crc_xmodem(msg)
+    return cobs_encode(msg + bytes([crc >> 8, crc & 0xFF])) + b'\0'
+
+
+def command(op, args, seq=0):
+    return encode(op, seq, struct.pack('<%df' % len(args), *args))
+
+
+class Decoder:
+    # Feed it bytes as they come in, and it gives back every message that
+    # decoded with a good crc as (id, seq, payload). Bad frames are counted
+    # in errors and dropped, the same as on the sub.
+    def __init__(self):
+        self.buf = bytearray()
+        self.errors = 0
+
+    def feed(self, data):
+        msgs = []
+        for b in data:
+            if b != 0:
+                self.buf.append(b)
+                continue
+            raw = cobs_decode(bytes(self.buf))
+            empty = not self.buf
+            self.buf = bytearray()
+            if empty:
+                continue
+            if raw is None or len(raw) < 4 or crc_xmodem(raw) != 0:
+                self.errors += 1
+                continue
+            msgs.append((chr(raw[0]), raw[1], raw[2:-2]))
+        return msgs
+
+
+def text(id, payload):
+    # The line console mode would have sent for a message.
+    if id == 'e':
+        return 'e ' + payload.hex()
+    if id in 'li' and len(payload) >= 5 and (len(payload) - 5) % 4 == 0:
+        time, tag = struct.unpack('<IB', payload[:5])
+        v = struct.unpack('<%df' % ((len(payload) - 5)//4), payload[5:])
+        return '%s %d %d' % (id, time, tag) + ''.join(' %f' % x for x in v)
+    v = struct.unpack('<%df' % (len(payload)//4), payload[:len(payload)//4*4])
+    return id + ''.join(' %f' % x for x in v)
+
+
+if __name__ == '__main__':
+    import serial
+
+    if len(sys.argv) < 3:
+        print('usage: link.py port baud [command ...]')
+        sys.exit(1)
+
+    baud = int(sys.argv[2])
+    port = serial.Serial(sys.argv[1], 9600, timeout=1)
+    port.write(b'b %d 1\n' % baud)
+    reply = port.readline().split()
+    if not reply or float(reply[0]) != baud:
+        print('the sub won\'t switch to %d baud: %r' % (baud, reply))
+        sys.exit(1)
+    port.baudrate = baud
+
+    seq = 0
+    for c in ['c'] + sys.argv[3:]:
+        f = c.split()
+        port.write(command(f[0], [float(x) for x in f[1:]], seq))
+        seq = (seq + 1) & 0xFF
+
+    decoder = Decoder()
+    while True:
+        for id, _, payload in decoder.feed(port.read(port.in_waiting or 1)):
+            print(text(id, payload))
+            sys.stdout.flush()
@@ -5,7 +5,12 @@ out = open("data.txt", "w")
 state = 's 3. 0. 0. 0. 0. 0.\n'
 port = serial.Serial('/dev/ttyACM0', 9600)
 port.write(state.encode())
+
+# Subscribe to the current state (field mask 1) at 10 Hz once, then just
+# read the records as they are pushed. Records look like "l <ms> <mask> ...".
+port.write(b'l 1 10\n')
 while True:
-    port.write(b'c\n')
-    temp = port.readline().decode('utf-8')
-    out.write(temp)
+    temp = port.readline().decode('utf-8').split()
+    if len(temp) < 3 or temp[0] != 'l':
+        continue
+    out.write(' '.join(temp[3:]) + '\n')
@@ -0,0 +1,132 @@
+import math
+import os
+import re
+import sys
+
+
+# Fits the Kalman filter's noise values from a log of its innovations, eg
+#
+#     python noise.py run.txt
+#
+# where run.txt holds the "i" records the sub sends after "i 7" in console
+# mode, as the simulator prints them. The Qk and R values the log was taken
+# with are read from include/kalman.hpp, or the file given after the log.
+#
+# Each correction gives the innovations y, the variance s the filter expected
+# them to have, and the r that was part of it, so s - r is the share of the
+# state. R is fitted by covariance matching: y^2 averages s - r plus the true
+# R, whatever r was used. Qk is fitted from how far each correction moved the
+# state it measures. With gain k = (s - r)/s onto that state, the Qk per
+# second that would have explained the corrections is the one used plus
+# k^2*(y^2 - s) summed over them, over the time they span. That leaves out
+# the gain onto the other states, so it is only close. The two depend on
+# each other, so rerun with the new values and fit again until they settle,
+# which takes a few runs in the simulator. A value that comes out negative
+# can't be fitted this way, which means the rest of the filter is off, and is
+# left as it was.
+if len(sys.argv) < 2:
+    print('usage: noise.py log [kalman.hpp]')
+    sys.exit(1)
+
+header = sys.argv[2] if len(sys.argv) > 2 else \
+    os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'include',
+                 'kalman.hpp')
+M = 2
+
+# Tables from kalman.hpp, by name, as lists of floats.
+text = open(header).read()
+N = int(re.search(r'const int N = (\d+);', text).group(1))
+tables = {}
+for name, body in re.findall(r'static float (\w+)\[[^]]*\] = \{([^}]*)\}', text):
+    tables[name] = [float(x) for x in body.replace(',', ' ').split()]
+
+# Kind of correction, its R table, and the state each row measures (for the
+# accelerometer and DVL, whose Qk is fitted).
+KINDS = [('accel', 'Ra', [2, 5]), ('dvl', 'Rk', [1, 4]), ('model', 'Rm', None)]
+
+# Chi-square with M = 2 degrees of freedom is above this 5% of the time.
+CHI2_95 = -2.*math.log(0.05)
+
+# Seconds at the start of the log to skip while the filter settles from its
+# first guess.
+SETTLE = 5.
+
+records = [[] for _ in KINDS]
+for line in open(sys.argv[1]):
+    f = line.split()
+    if len(f) != 4 + 3*M + 1 or f[0] != 'i':
+        continue
+    try:
+        v = [float(x) for x in f[1:]]
+    except ValueError:
+        continue
+    kind = int(v[1])
+    if 0 <= kind < len(KINDS):
+        records[kind].append(v)
+first = min([r[0][0] for r in records if r] or [0.])
+records = [[v for v in r if v[0] >= first + SETTLE*1000.] for r in records]
+
+Q = list(tables['Qk'])
+R = {}
+for kind, (name, table, states) in enumerate(KINDS):
+    recs = records[kind]
+    if not recs:
+        continue
+    R[table] = list(tables[table])
+
+    # Records dropped on a full link leave gaps in the count, so the time
+    # they span is cut down to the share that arrived.
+    counts = [int(v[2]) for v in recs]
+    sent = 1 + sum((b - a) % 65536 for a, b in zip(counts, counts[1:]))
+    span = (recs[-1][0] - recs[0][0])/1000.*len(recs)/sent
+
+    nis = [v[-1] for v in recs]
+    print('%s: %d corrections (%d dropped) over %.0f s' %
+          (name, len(recs), sent - len(recs), span))
+    print('  nis mean %.2f (should be %d), above %.2f %.1f%% (should be 5%%)' %
+          (sum(nis)/len(nis), M, CHI2_95,
+           100.*sum(1 for x in nis if x > CHI2_95)/len(nis)))
+    shift = 0.
+    for m in range(M):
+        y = [v[3 + m] for v in recs]
+        s = [v[3 + M + m] for v in recs]
+        r = [v[3 + 2*M + m] for v in recs]
+        fit = sum(a*a - (b - c) for a, b, c in zip(y, s, r))/len(y)
+        print('  row %d: innovation mean %+.4f, R %.3g -> %.3g' %
+              (m, sum(y)/len(y), R[table][m*M + m], fit))
+        if fit > 0.:
+            R[table][m*M + m] = fit
+        else:
+            print('    the state alone has more variance than this row, so Qk '
+                  'is too large, kept')
+        if states and span > 0.:
+            shift += sum(((b - c)/b)**2*(a*a - b)
+                         for a, b, c in zip(y, s, r) if b > 0.)/span
+    if states:
+        # Both rows measure the same kind of state, one along each axis, and
+        # share a value of Qk.
+        i = states[0]
+        fit = Q[i*N + i] + shift/M
+        print('  Qk %.3g -> %.3g' % (Q[i*N + i], fit))
+        if fit > 0.:
+            for i in states:
+                Q[i*N + i] = fit
+        else:
+            print('    the corrections are smaller than r alone explains, so R '
+                  'is too large, kept')
+
+
+def table(name, values, n):
+    def num(x):
+        return '%.3f' % x if x == 0. or abs(x) >= 0.001 else '%.0e' % x
+    rows = [', '.join(num(x) for x in values[i*n:(i + 1)*n]) for i in range(n)]
+    print('static float %s[%s*%s] = {' % (name, 'N' if n == N else 'M',
+                                         'N' if n == N else 'M'))
+    print(',\n'.join('\t' + row for row in rows))
+    print('};')
+
+
+print()
+table('Qk', Q, N)
+for name, values in sorted(R.items()):
+    table(name, values, M)
@@ -0,0 +1,46 @@
+import csv
+import sys
+
+
+# Step response of one column of the simulator's truth log (sim -l), eg
+#
+#     python settle.py truth.csv north 30 3 0.1
+#
+# for a step to 3 m north sent at 30 s, settled once within 0.1 m for good.
+if len(sys.argv) < 5:
+    print('usage: settle.py truth.csv column step_time target [band]')
+    sys.exit(1)
+
+column = sys.argv[2]
+start = float(sys.argv[3])
+target = float(sys.argv[4])
+band = float(sys.argv[5]) if len(sys.argv) > 5 else 0.05*abs(target)
+
+t = []
+err = []
+for row in csv.DictReader(open(sys.argv[1])):
+    if float(row['time']) < start:
+        continue
+    e = float(row[column]) - target
+    if column in ('yaw', 'pitch', 'roll'):
+        e = (e + 180.) % 360. - 180.
+    t.append(float(row['time']))
+    err.append(e)
+step = -err[0]
+sign = 1. if step > 0. else -1.
+
+# Rise time from 10% to 90% of the step, overshoot past the target in the
+# direction of the step, and settling time once the error stays in the band.
+begun = next((x for x, e in zip(t, err) if abs(e) <= 0.9*abs(step)), None)
+done = next((x for x, e in zip(t, err) if abs(e) <= 0.1*abs(step)), None)
+rise = done - begun if done is not None else float('nan')
+overshoot = max([0.] + [e*sign for e in err])
+outside = [i for i, e in enumerate(err) if abs(e) > band]
+if not outside:
+    settle = 0.
+elif outside[-1] == len(t) - 1:
+    settle = float('nan')
+else:
+    settle = t[outside[-1] + 1] - start
+
+print('rise %.2f s  overshoot %.3f  settle %.2f s' % (rise, overshoot, settle))